@@ -0,0 +1,109 @@
+#include "stdbool.h"
+#include "string.h"
+#include "rle565.h"
+
+static inline bool pixel_equal(const uint8_t *src, uint32_t a, uint32_t b)
+{
+	return (src[a * 2] == src[b * 2]) && (src[a * 2 + 1] == src[b * 2 + 1]);
+}
+
+void rle565_decoder_init(rle565_decoder_t *decoder, const uint8_t *data)
+{
+	decoder->src = data;
+	decoder->num_left = 0;
+	decoder->is_repeat = 0;
+}
+
+void rle565_decode(rle565_decoder_t *decoder, uint8_t *dst, uint32_t num_pixel)
+{
+	while (num_pixel > 0)
+	{
+		/* Start next packet */
+		if (decoder->num_left == 0)
+		{
+			uint8_t header = *decoder->src++;
+			decoder->num_left = (header & 0x7F) + 1;
+			decoder->is_repeat = header & 0x80;
+			if (decoder->is_repeat)
+			{
+				decoder->color[0] = decoder->src[0];
+				decoder->color[1] = decoder->src[1];
+				decoder->src += 2;
+			}
+		}
+
+		uint32_t num = (decoder->num_left < num_pixel) ? decoder->num_left : num_pixel;
+
+		/* Skipping only moves past literal pixels */
+		if (decoder->is_repeat)
+		{
+			for (uint32_t idx = 0; (dst != NULL) && (idx < num); idx++)
+			{
+				dst[idx * 2] = decoder->color[0];
+				dst[idx * 2 + 1] = decoder->color[1];
+			}
+		}
+		else
+		{
+			if (dst != NULL)
+			{
+				memcpy(dst, decoder->src, num * 2);
+			}
+			decoder->src += num * 2;
+		}
+
+		if (dst != NULL)
+		{
+			dst += num * 2;
+		}
+		decoder->num_left -= num;
+		num_pixel -= num;
+	}
+}
+
+uint32_t rle565_encode(const uint8_t *src, uint32_t num_pixel, uint8_t *dst)
+{
+	uint32_t size = 0;
+	uint32_t idx = 0;
+
+	while (idx < num_pixel)
+	{
+		/* Pixels equal to the first one */
+		uint32_t run = 1;
+		while ((idx + run < num_pixel) && (run < RLE565_MAX_RUN) && pixel_equal(src, idx, idx + run))
+		{
+			run++;
+		}
+
+		if (run >= 2)
+		{
+			if (dst != NULL)
+			{
+				dst[size] = 0x80 | (run - 1);
+				dst[size + 1] = src[idx * 2];
+				dst[size + 2] = src[idx * 2 + 1];
+			}
+			size += 3;
+			idx += run;
+			continue;
+		}
+
+		/* Literal pixels up to where the next run starts */
+		run = 1;
+		while ((idx + run < num_pixel) && (run < RLE565_MAX_RUN) &&
+		       !((idx + run + 1 < num_pixel) && pixel_equal(src, idx + run, idx + run + 1)))
+		{
+			run++;
+		}
+
+		if (dst != NULL)
+		{
+			dst[size] = run - 1;
+			memcpy(dst + size + 1, src + idx * 2, run * 2);
+		}
+		size += 1 + run * 2;
+		idx += run;
+	}
+
+	return size;
+}
@@ -0,0 +1,91 @@
+// MIT License
+
+// Copyright (c) 2023 phonght32
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TFT_DRIVER_RLE565__
+#define __TFT_DRIVER_RLE565__
+
+#include "err_code.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * RLE565 stream. Pixels of the whole image in row order are split into
+ * packets, a packet may continue on the next row. Every packet starts with
+ * one header byte:
+ *  - Bit 7 set: (header & 0x7F) + 1 copies of the one pixel that follows.
+ *  - Bit 7 clear: header + 1 pixels follow as they are.
+ * Pixels are 2 bytes, byte swapped RGB565 as the panel expects it.
+ */
+
+#define RLE565_MAX_RUN      128         /*!< Pixels per packet */
+
+/**
+ * @struct  Decoder state, position in the stream and in its current packet.
+ */
+typedef struct {
+    const uint8_t   *src;               /*!< Next byte of the stream */
+    uint8_t         num_left;           /*!< Pixels left in current packet */
+    uint8_t         is_repeat;          /*!< Current packet repeats color */
+    uint8_t         color[2];           /*!< Repeated pixel */
+} rle565_decoder_t;
+
+/*
+ * @brief   Start decoding a stream from its first pixel.
+ *
+ * @param   decoder Decoder state.
+ * @param   data Stream, read in place.
+ *
+ * @return  None.
+ */
+void rle565_decoder_init(rle565_decoder_t *decoder, const uint8_t *data);
+
+/*
+ * @brief   Decode next pixels.
+ *
+ * @param   decoder Decoder state.
+ * @param   dst Destination pixels in panel byte order, NULL to skip pixels.
+ * @param   num_pixel Number of pixels.
+ *
+ * @return  None.
+ */
+void rle565_decode(rle565_decoder_t *decoder, uint8_t *dst, uint32_t num_pixel);
+
+/*
+ * @brief   Encode pixels into a stream.
+ *
+ * @note    Worst case size is num_pixel * 2 + num_pixel / RLE565_MAX_RUN + 1 bytes.
+ *
+ * @param   src Source pixels in panel byte order.
+ * @param   num_pixel Number of pixels.
+ * @param   dst Stream, NULL to only compute its size.
+ *
+ * @return  Bytes of stream.
+ */
+uint32_t rle565_encode(const uint8_t *src, uint32_t num_pixel, uint8_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TFT_DRIVER_RLE565__ */
@@ -0,0 +1,147 @@
+#include "string.h"
+#include "color_convert.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define COLOR_CONVERT_NEON
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define COLOR_CONVERT_SSSE3
+#endif
+
+/* Word loads pay off on MCUs. x86 loads bytes as fast and vectorizes the plain
+   loop, tests define COLOR_CONVERT_WORD there to check the kernel */
+#if !defined(COLOR_CONVERT_WORD) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && \
+    !defined(__x86_64__) && !defined(__i386__)
+#define COLOR_CONVERT_WORD
+#endif
+
+static inline uint16_t convert_pixel(const uint8_t *p)
+{
+	uint16_t color_565 = (((uint16_t)p[0] & 0x00F8) << 8) |
+	                     (((uint16_t)p[1] & 0x00FC) << 3) |
+	                     ((uint16_t)p[2] >> 3);
+
+	return ((color_565 << 8) & 0xFF00) | ((color_565 >> 8) & 0x00FF);
+}
+
+#ifdef COLOR_CONVERT_WORD
+static inline uint32_t convert_channels(uint32_t r, uint32_t g, uint32_t b)
+{
+	/* First output byte is R5 G3 high, second one is G3 low B5 */
+	return (r & 0xF8) | ((g >> 5) & 0x07) | ((g & 0x1C) << 11) | ((b & 0xF8) << 5);
+}
+#endif
+
+#ifdef COLOR_CONVERT_NEON
+static uint32_t convert_neon(const uint8_t *src, uint16_t *dst, uint32_t num_pixel)
+{
+	uint32_t done = 0;
+
+	/* 16 pixels per step, loads de-interleave R, G and B */
+	for (; done + 16 <= num_pixel; done += 16) {
+		uint8x16x3_t rgb = vld3q_u8(src + done * 3);
+		uint8x16x2_t out;
+
+		out.val[0] = vorrq_u8(vandq_u8(rgb.val[0], vdupq_n_u8(0xF8)), vshrq_n_u8(rgb.val[1], 5));
+		out.val[1] = vorrq_u8(vandq_u8(vshlq_n_u8(rgb.val[1], 3), vdupq_n_u8(0xE0)), vshrq_n_u8(rgb.val[2], 3));
+
+		vst2q_u8((uint8_t *)(dst + done), out);
+	}
+
+	return done;
+}
+#endif
+
+#ifdef COLOR_CONVERT_SSSE3
+static uint32_t convert_ssse3(const uint8_t *src, uint16_t *dst, uint32_t num_pixel)
+{
+	/* Gather one channel of 16 pixels out of 48 bytes, 0x80 clears the lane */
+	const __m128i r0 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i r1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+	const __m128i r2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+	const __m128i g0 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i g1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+	const __m128i g2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+	const __m128i b0 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i b1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+	const __m128i b2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+	const __m128i mask_r = _mm_set1_epi8((char)0xF8);
+	const __m128i mask_g_hi = _mm_set1_epi8(0x07);
+	const __m128i mask_g_lo = _mm_set1_epi8((char)0xE0);
+	const __m128i mask_b = _mm_set1_epi8(0x1F);
+	uint32_t done = 0;
+
+	for (; done + 16 <= num_pixel; done += 16) {
+		const uint8_t *p = src + done * 3;
+		__m128i v0 = _mm_loadu_si128((const __m128i *)(p + 0));
+		__m128i v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+		__m128i v2 = _mm_loadu_si128((const __m128i *)(p + 32));
+
+		__m128i r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, r0), _mm_shuffle_epi8(v1, r1)), _mm_shuffle_epi8(v2, r2));
+		__m128i g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, g0), _mm_shuffle_epi8(v1, g1)), _mm_shuffle_epi8(v2, g2));
+		__m128i b = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, b0), _mm_shuffle_epi8(v1, b1)), _mm_shuffle_epi8(v2, b2));
+
+		/* There is no byte shift, shift 16-bit lanes and drop bits crossing bytes */
+		__m128i hi = _mm_or_si128(_mm_and_si128(r, mask_r),
+		                          _mm_and_si128(_mm_srli_epi16(g, 5), mask_g_hi));
+		__m128i lo = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(g, 3), mask_g_lo),
+		                          _mm_and_si128(_mm_srli_epi16(b, 3), mask_b));
+
+		_mm_storeu_si128((__m128i *)(dst + done), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i *)(dst + done + 8), _mm_unpackhi_epi8(hi, lo));
+	}
+
+	return done;
+}
+#endif
+
+#ifdef COLOR_CONVERT_WORD
+static uint32_t convert_word(const uint8_t *src, uint16_t *dst, uint32_t num_pixel)
+{
+	uint32_t done = 0;
+
+	/* 12 bytes hold exactly 4 pixels: R0 G0 B0 R1 | G1 B1 R2 G2 | B2 R3 G3 B3 */
+	for (; done + 4 <= num_pixel; done += 4) {
+		uint32_t w[3];
+		uint32_t out[2];
+
+		memcpy(w, src + done * 3, sizeof(w));
+
+		out[0] = convert_channels(w[0], w[0] >> 8, w[0] >> 16) |
+		         (convert_channels(w[0] >> 24, w[1], w[1] >> 8) << 16);
+		out[1] = convert_channels(w[1] >> 16, w[1] >> 24, w[2]) |
+		         (convert_channels(w[2] >> 8, w[2] >> 16, w[2] >> 24) << 16);
+
+		memcpy(dst + done, out, sizeof(out));
+	}
+
+	return done;
+}
+#endif
+
+void color_convert_rgb888_to_rgb565(const uint8_t *src, uint16_t *dst, uint32_t num_pixel)
+{
+	uint32_t done = 0;
+
+#if defined(COLOR_CONVERT_NEON)
+	done = convert_neon(src, dst, num_pixel);
+#elif defined(COLOR_CONVERT_SSSE3)
+	done = convert_ssse3(src, dst, num_pixel);
+#endif
+
+#ifdef COLOR_CONVERT_WORD
+	done += convert_word(src + done * 3, dst + done, num_pixel - done);
+#endif
+
+	/* Remaining pixels */
+	color_convert_rgb888_to_rgb565_ref(src + done * 3, dst + done, num_pixel - done);
+}
+
+void color_convert_rgb888_to_rgb565_ref(const uint8_t *src, uint16_t *dst, uint32_t num_pixel)
+{
+	for (uint32_t idx = 0; idx < num_pixel; idx++) {
+		dst[idx] = convert_pixel(src);
+		src += 3;
+	}
+}
@@ -0,0 +1,64 @@
+// MIT License
+
+// Copyright (c) 2023 phonght32
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TFT_DRIVER_COLOR_CONVERT__
+#define __TFT_DRIVER_COLOR_CONVERT__
+
+#include "err_code.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief   Convert RGB888 pixels to byte swapped RGB565 pixels.
+ *
+ * @note    Uses the widest kernel available for the build target: NEON,
+ *          SSSE3 or 32-bit words of 4 pixels. Result is bit exact with
+ *          color_convert_rgb888_to_rgb565_ref.
+ *
+ * @param   src Source pixels, R, G, B byte order.
+ * @param   dst Destination pixels in panel byte order.
+ * @param   num_pixel Number of pixels.
+ *
+ * @return  None.
+ */
+void color_convert_rgb888_to_rgb565(const uint8_t *src, uint16_t *dst, uint32_t num_pixel);
+
+/*
+ * @brief   Convert RGB888 pixels to byte swapped RGB565 pixels, one by one.
+ *
+ * @note    Portable reference for the optimized kernels.
+ *
+ * @param   src Source pixels, R, G, B byte order.
+ * @param   dst Destination pixels in panel byte order.
+ * @param   num_pixel Number of pixels.
+ *
+ * @return  None.
+ */
+void color_convert_rgb888_to_rgb565_ref(const uint8_t *src, uint16_t *dst, uint32_t num_pixel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TFT_DRIVER_COLOR_CONVERT__ */
@@ -0,0 +1,610 @@
+#include "stdbool.h"
+#include "string.h"
+#include "tft_console.h"
+
+#define ESC_MAX_PARAM 			4
+#define ESC_MAX_VALUE 			999 	/*!< Larger parameters stop growing */
+#define TAB_WIDTH 				8
+#define CELL_UNKNOWN 			0 		/*!< Character of a drawn cell whose content is not known */
+
+/**
+ * @enum  Escape sequence parser state.
+ */
+typedef enum {
+	ESC_STATE_NONE = 0,
+	ESC_STATE_ESC, 					/*!< ESC received */
+	ESC_STATE_CSI, 					/*!< ESC [ received, reading parameters */
+} esc_state_t;
+
+/**
+ * @struct  Character cell.
+ */
+typedef struct {
+	uint8_t chr;
+	uint8_t attr; 					/*!< Foreground palette index in low bits, background in high bits */
+} cell_t;
+
+/**
+ * @struct  TFT console structure.
+ */
+typedef struct tft_console {
+	tft_driver_handle_t 	driver;
+	font_size_t 			font_size;
+	uint16_t 				x;
+	uint16_t 				y;
+	uint16_t 				num_col;
+	uint16_t 				num_row;
+	uint8_t 				cell_width;
+	uint8_t 				cell_height;
+	uint32_t 				palette[TFT_CONSOLE_NUM_COLOR];
+	uint8_t 				default_attr;
+	uint8_t 				attr; 			/*!< Colors of characters written from now on */
+	uint8_t 				use_hw_scroll;
+	cell_t 					*cells; 		/*!< Text rows, a ring starting at top_row */
+	cell_t 					*shown; 		/*!< Cells as last drawn, in screen row order */
+	uint8_t 				*row_dirty; 	/*!< Screen rows with cells to compare against shown ones */
+	uint16_t 				top_row;
+	uint16_t 				col; 			/*!< Cursor, num_col when the next character wraps */
+	uint16_t 				row;
+	uint16_t 				num_scroll; 	/*!< Lines scrolled since the last draw */
+	esc_state_t 			esc_state;
+	uint16_t 				esc_param[ESC_MAX_PARAM + 1]; /*!< One more, counted past the last kept parameter */
+	uint8_t 				esc_num_param;
+} tft_console_t;
+
+/* Standard VGA text mode colors */
+static const uint32_t ansi_palette[TFT_CONSOLE_NUM_COLOR] = {
+	0x000000, 0xAA0000, 0x00AA00, 0xAA5500, 0x0000AA, 0xAA00AA, 0x00AAAA, 0xAAAAAA,
+	0x555555, 0xFF5555, 0x55FF55, 0xFFFF55, 0x5555FF, 0xFF55FF, 0x55FFFF, 0xFFFFFF,
+};
+
+static cell_t *cell_at(tft_console_handle_t handle, uint16_t col, uint16_t row)
+{
+	uint16_t line = (handle->top_row + row) % handle->num_row;
+
+	return &handle->cells[line * handle->num_col + col];
+}
+
+static bool cell_same(cell_t a, cell_t b)
+{
+	/* Blank cells only show their background */
+	if ((a.chr == ' ') && (b.chr == ' '))
+	{
+		return (a.attr & 0xF0) == (b.attr & 0xF0);
+	}
+
+	return (a.chr == b.chr) && (a.attr == b.attr);
+}
+
+static void clear_cells(tft_console_handle_t handle, uint16_t row, uint16_t col_start, uint16_t col_end)
+{
+	cell_t *cell = cell_at(handle, 0, row);
+	for (uint16_t col = col_start; col <= col_end; col++)
+	{
+		cell[col].chr = ' ';
+		cell[col].attr = handle->attr;
+	}
+	handle->row_dirty[row] = true;
+}
+
+static void clear_all(tft_console_handle_t handle)
+{
+	for (uint16_t row = 0; row < handle->num_row; row++)
+	{
+		clear_cells(handle, row, 0, handle->num_col - 1);
+	}
+}
+
+static void line_feed(tft_console_handle_t handle)
+{
+	handle->col = 0;
+	if (handle->row + 1 < handle->num_row)
+	{
+		handle->row++;
+		return;
+	}
+
+	/* Scroll up by moving the start of the ring, the old top row becomes the last one */
+	handle->top_row = (handle->top_row + 1) % handle->num_row;
+	clear_cells(handle, handle->num_row - 1, 0, handle->num_col - 1);
+	memset(handle->row_dirty, true, handle->num_row);
+	handle->num_scroll++;
+}
+
+static void put_char(tft_console_handle_t handle, uint8_t chr)
+{
+	/* Wrap is deferred so a full line does not leave an empty one below */
+	if (handle->col >= handle->num_col)
+	{
+		line_feed(handle);
+	}
+
+	cell_t *cell = cell_at(handle, handle->col, handle->row);
+	cell->chr = chr;
+	cell->attr = handle->attr;
+	handle->row_dirty[handle->row] = true;
+	handle->col++;
+}
+
+static void move_cursor(tft_console_handle_t handle, int32_t col, int32_t row)
+{
+	if (col < 0) col = 0;
+	if (row < 0) row = 0;
+	if (col >= handle->num_col) col = handle->num_col - 1;
+	if (row >= handle->num_row) row = handle->num_row - 1;
+
+	handle->col = col;
+	handle->row = row;
+}
+
+static void set_colors(tft_console_handle_t handle)
+{
+	uint8_t fg = handle->attr & 0x0F;
+	uint8_t bg = handle->attr >> 4;
+
+	/* Select graphic rendition, no parameter resets colors */
+	if (handle->esc_num_param == 0)
+	{
+		handle->attr = handle->default_attr;
+		return;
+	}
+
+	for (uint8_t idx = 0; (idx < handle->esc_num_param) && (idx < ESC_MAX_PARAM); idx++)
+	{
+		uint16_t param = handle->esc_param[idx];
+		if (param == 0)
+		{
+			fg = handle->default_attr & 0x0F;
+			bg = handle->default_attr >> 4;
+		}
+		else if ((param >= 30) && (param <= 37))
+		{
+			fg = param - 30;
+		}
+		else if ((param >= 90) && (param <= 97))
+		{
+			fg = param - 90 + 8;
+		}
+		else if (param == 39)
+		{
+			fg = handle->default_attr & 0x0F;
+		}
+		else if ((param >= 40) && (param <= 47))
+		{
+			bg = param - 40;
+		}
+		else if ((param >= 100) && (param <= 107))
+		{
+			bg = param - 100 + 8;
+		}
+		else if (param == 49)
+		{
+			bg = handle->default_attr >> 4;
+		}
+	}
+
+	handle->attr = (bg << 4) | fg;
+}
+
+static void exec_csi(tft_console_handle_t handle, uint8_t final)
+{
+	/* Missing parameters are 0, moves treat 0 as 1 */
+	uint16_t n = handle->esc_param[0];
+	uint16_t count = (n > 0) ? n : 1;
+	int32_t col = (handle->col < handle->num_col) ? handle->col : handle->num_col - 1;
+
+	switch (final)
+	{
+	case 'A':
+		move_cursor(handle, col, (int32_t)handle->row - count);
+		break;
+	case 'B':
+		move_cursor(handle, col, (int32_t)handle->row + count);
+		break;
+	case 'C':
+		move_cursor(handle, col + count, handle->row);
+		break;
+	case 'D':
+		move_cursor(handle, col - count, handle->row);
+		break;
+	case 'H':
+	case 'f':
+		move_cursor(handle, (int32_t)handle->esc_param[1] - 1, (int32_t)n - 1);
+		break;
+	case 'J':
+		if (n == 0)
+		{
+			clear_cells(handle, handle->row, col, handle->num_col - 1);
+			for (uint16_t row = handle->row + 1; row < handle->num_row; row++)
+			{
+				clear_cells(handle, row, 0, handle->num_col - 1);
+			}
+		}
+		else if (n == 2)
+		{
+			clear_all(handle);
+		}
+		break;
+	case 'K':
+		if (n == 0)
+		{
+			clear_cells(handle, handle->row, col, handle->num_col - 1);
+		}
+		else if (n == 2)
+		{
+			clear_cells(handle, handle->row, 0, handle->num_col - 1);
+		}
+		break;
+	case 'm':
+		set_colors(handle);
+		break;
+	default:
+		break;
+	}
+}
+
+static void parse_csi(tft_console_handle_t handle, uint8_t chr)
+{
+	if ((chr >= '0') && (chr <= '9'))
+	{
+		/* First digit opens a parameter */
+		if (handle->esc_num_param == 0)
+		{
+			handle->esc_num_param = 1;
+		}
+
+		/* Parameters past the last one kept are dropped */
+		uint16_t *param = &handle->esc_param[handle->esc_num_param - 1];
+		if ((handle->esc_num_param <= ESC_MAX_PARAM) && (*param <= ESC_MAX_VALUE))
+		{
+			*param = *param * 10 + (chr - '0');
+		}
+	}
+	else if (chr == ';')
+	{
+		/* Empty parameters count as 0 */
+		if (handle->esc_num_param == 0)
+		{
+			handle->esc_num_param = 1;
+		}
+		if (handle->esc_num_param <= ESC_MAX_PARAM)
+		{
+			handle->esc_num_param++;
+		}
+	}
+	else if ((chr >= 0x40) && (chr <= 0x7E))
+	{
+		exec_csi(handle, chr);
+		handle->esc_state = ESC_STATE_NONE;
+	}
+}
+
+static void write_byte(tft_console_handle_t handle, uint8_t chr)
+{
+	if (handle->esc_state == ESC_STATE_ESC)
+	{
+		/* Only control sequence introducer is known, other escapes are dropped */
+		if (chr == '[')
+		{
+			memset(handle->esc_param, 0, sizeof(handle->esc_param));
+			handle->esc_num_param = 0;
+			handle->esc_state = ESC_STATE_CSI;
+		}
+		else
+		{
+			handle->esc_state = ESC_STATE_NONE;
+		}
+		return;
+	}
+	if (handle->esc_state == ESC_STATE_CSI)
+	{
+		parse_csi(handle, chr);
+		return;
+	}
+
+	switch (chr)
+	{
+	case 0x1B:
+		handle->esc_state = ESC_STATE_ESC;
+		break;
+	case '\n':
+		line_feed(handle);
+		break;
+	case '\r':
+		handle->col = 0;
+		break;
+	case '\b':
+		if (handle->col > 0)
+		{
+			handle->col--;
+		}
+		break;
+	case '\t':
+		handle->col = (handle->col / TAB_WIDTH + 1) * TAB_WIDTH;
+		if (handle->col >= handle->num_col)
+		{
+			handle->col = handle->num_col - 1;
+		}
+		break;
+	case '\f':
+		clear_all(handle);
+		handle->col = 0;
+		handle->row = 0;
+		break;
+	default:
+		/* Other control characters are dropped */
+		if (chr >= ' ')
+		{
+			put_char(handle, chr);
+		}
+		break;
+	}
+}
+
+static err_code_t draw_cell(tft_console_handle_t handle, uint16_t col, uint16_t row, cell_t cell)
+{
+	uint16_t x = handle->x + col * handle->cell_width;
+	uint16_t y = handle->y + row * handle->cell_height;
+	uint32_t bg_color = handle->palette[cell.attr >> 4];
+
+	/* Blank or unknown characters are the background only */
+	font_t font;
+	if ((cell.chr == ' ') || (get_font(cell.chr, handle->font_size, &font) <= 0))
+	{
+		return tft_driver_fill_rectangle(handle->driver, x, y, handle->cell_width, handle->cell_height, bg_color);
+	}
+
+	/* Glyph rows are mono bitmaps, one blit writes foreground and background of the cell */
+	tft_driver_image_t image = {
+		.data = font.data,
+		.width = (font.width < handle->cell_width) ? font.width : handle->cell_width,
+		.height = (font.height < handle->cell_height) ? font.height : handle->cell_height,
+		.stride = font.data_len / font.height,
+		.format = TFT_DRIVER_IMAGE_FORMAT_MONO,
+		.color = handle->palette[cell.attr & 0x0F],
+		.bg_color = bg_color,
+	};
+	err_code_t err = tft_driver_blit(handle->driver, x, y, &image);
+	if (err != ERR_CODE_SUCCESS)
+	{
+		return err;
+	}
+
+	/* Smaller glyphs leave the rest of the cell in background */
+	if (image.width < handle->cell_width)
+	{
+		err = tft_driver_fill_rectangle(handle->driver, x + image.width, y,
+		                                handle->cell_width - image.width, handle->cell_height, bg_color);
+	}
+	if ((err == ERR_CODE_SUCCESS) && (image.height < handle->cell_height))
+	{
+		err = tft_driver_fill_rectangle(handle->driver, x, y + image.height,
+		                                image.width, handle->cell_height - image.height, bg_color);
+	}
+
+	return err;
+}
+
+static void scroll_shown(tft_console_handle_t handle)
+{
+	uint16_t num_line = handle->num_scroll;
+	handle->num_scroll = 0;
+
+	/* Everything scrolled out, or cells are to be redrawn in place */
+	if (!handle->use_hw_scroll || (num_line >= handle->num_row))
+	{
+		return;
+	}
+	if (tft_driver_scroll(handle->driver, num_line * handle->cell_height) != ERR_CODE_SUCCESS)
+	{
+		handle->use_hw_scroll = false;
+		return;
+	}
+
+	/* Panel moved drawn cells up with the text, rows scrolled in are cleared by the driver */
+	uint32_t num_keep = (uint32_t)(handle->num_row - num_line) * handle->num_col;
+	memmove(handle->shown, handle->shown + num_line * handle->num_col, num_keep * sizeof(cell_t));
+	memset(handle->shown + num_keep, CELL_UNKNOWN, (uint32_t)num_line * handle->num_col * sizeof(cell_t));
+}
+
+tft_console_handle_t tft_console_init(void)
+{
+	tft_console_handle_t handle = calloc(1, sizeof(tft_console_t));
+
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return NULL;
+	}
+
+	return handle;
+}
+
+err_code_t tft_console_config(tft_console_handle_t handle, tft_console_cfg_t config)
+{
+	/* Check if handle structure is NULL */
+	if ((handle == NULL) || (config.driver == NULL))
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	if ((config.num_col == 0) || (config.num_row == 0) ||
+	    (config.fg_color >= TFT_CONSOLE_NUM_COLOR) || (config.bg_color >= TFT_CONSOLE_NUM_COLOR))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Fonts are monospaced, cell size is taken from a digit */
+	font_t font;
+	if (get_font('0', config.font_size, &font) <= 0)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Allocate memory for text and for cells as drawn, nothing is drawn yet */
+	uint32_t num_cell = (uint32_t)config.num_col * config.num_row;
+	handle->cells = calloc(num_cell, sizeof(cell_t));
+	handle->shown = calloc(num_cell, sizeof(cell_t));
+	handle->row_dirty = calloc(config.num_row, sizeof(uint8_t));
+	if ((handle->cells == NULL) || (handle->shown == NULL) || (handle->row_dirty == NULL))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Update handle structure */
+	handle->driver = config.driver;
+	handle->font_size = config.font_size;
+	handle->x = config.x;
+	handle->y = config.y;
+	handle->num_col = config.num_col;
+	handle->num_row = config.num_row;
+	handle->cell_width = font.width;
+	handle->cell_height = font.height;
+	memcpy(handle->palette, (config.palette != NULL) ? config.palette : ansi_palette, sizeof(handle->palette));
+	handle->default_attr = (config.bg_color << 4) | config.fg_color;
+	handle->attr = handle->default_attr;
+	handle->use_hw_scroll = config.use_hw_scroll;
+	handle->top_row = 0;
+	handle->col = 0;
+	handle->row = 0;
+	handle->num_scroll = 0;
+	handle->esc_state = ESC_STATE_NONE;
+
+	clear_all(handle);
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_console_write(tft_console_handle_t handle, const uint8_t *data, uint32_t len)
+{
+	/* Check if handle structure is NULL */
+	if ((handle == NULL) || (data == NULL))
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	for (uint32_t idx = 0; idx < len; idx++)
+	{
+		write_byte(handle, data[idx]);
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_console_set_cursor(tft_console_handle_t handle, uint16_t col, uint16_t row)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	move_cursor(handle, col, row);
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_console_get_cursor(tft_console_handle_t handle, uint16_t *col, uint16_t *row)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Deferred wrap keeps the cursor on the last column */
+	*col = (handle->col < handle->num_col) ? handle->col : handle->num_col - 1;
+	*row = handle->row;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_console_set_color(tft_console_handle_t handle, uint8_t fg_color, uint8_t bg_color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	if ((fg_color >= TFT_CONSOLE_NUM_COLOR) || (bg_color >= TFT_CONSOLE_NUM_COLOR))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	handle->attr = (bg_color << 4) | fg_color;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_console_clear(tft_console_handle_t handle)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	clear_all(handle);
+	handle->col = 0;
+	handle->row = 0;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_console_draw(tft_console_handle_t handle)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	scroll_shown(handle);
+
+	/* Only rows written since the last draw are compared, only changed cells drawn */
+	for (uint16_t row = 0; row < handle->num_row; row++)
+	{
+		if (!handle->row_dirty[row])
+		{
+			continue;
+		}
+
+		const cell_t *cell = cell_at(handle, 0, row);
+		cell_t *shown = &handle->shown[row * handle->num_col];
+		for (uint16_t col = 0; col < handle->num_col; col++)
+		{
+			if ((shown[col].chr != CELL_UNKNOWN) && cell_same(cell[col], shown[col]))
+			{
+				continue;
+			}
+
+			err_code_t err = draw_cell(handle, col, row, cell[col]);
+			if (err != ERR_CODE_SUCCESS)
+			{
+				return err;
+			}
+			shown[col] = cell[col];
+		}
+		handle->row_dirty[row] = false;
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_console_refresh(tft_console_handle_t handle)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	err_code_t err = tft_console_draw(handle);
+	if (err != ERR_CODE_SUCCESS)
+	{
+		return err;
+	}
+
+	return tft_driver_screen_refresh(handle->driver);
+}
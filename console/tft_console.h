@@ -0,0 +1,201 @@
+// MIT License
+
+// Copyright (c) 2023 phonght32
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TFT_CONSOLE_H__
+#define __TFT_CONSOLE_H__
+
+#include "err_code.h"
+#include "fonts.h"
+#include "tft_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Character cell console drawn through TFT driver. Written text goes into a
+ * grid of cells, each holding a character and foreground and background
+ * palette indices. Refresh draws only the cells which changed since they
+ * were last drawn.
+ *
+ * Control characters:
+ *  - '\n' moves to the start of the next line, '\r' to the start of the line.
+ *  - '\b' moves one cell back, '\t' to the next multiple of 8 columns.
+ *  - '\f' clears the console and moves to the top left cell.
+ *
+ * Escape sequences, parameters default to 0 or 1 as in ANSI terminals:
+ *  - ESC [ n A, B, C, D move n cells up, down, forward, back.
+ *  - ESC [ row ; col H moves to the cell, counted from 1.
+ *  - ESC [ n J clears to the end of console for 0, the whole console for 2.
+ *  - ESC [ n K clears to the end of line for 0, the whole line for 2.
+ *  - ESC [ n ; ... m sets colors, 0 resets them, 30-37 and 90-97 select
+ *    foreground, 40-47 and 100-107 background, 39 and 49 the default ones.
+ */
+
+#define TFT_CONSOLE_NUM_COLOR       16          /*!< Palette entries, ANSI colors then their bright versions */
+
+/**
+ * @struct  TFT console handle structure.
+ */
+typedef struct tft_console* tft_console_handle_t;
+
+/**
+ * @struct  TFT console configuration structure.
+ */
+typedef struct {
+    tft_driver_handle_t         driver;         /*!< Configured driver to draw into */
+    font_size_t                 font_size;      /*!< Font, cell size is the size of its glyphs */
+    uint16_t                    x;              /*!< Top left corner on screen */
+    uint16_t                    y;
+    uint16_t                    num_col;
+    uint16_t                    num_row;
+    const uint32_t              *palette;       /*!< TFT_CONSOLE_NUM_COLOR colors in driver color format, NULL for ANSI colors */
+    uint8_t                     fg_color;       /*!< Default foreground palette index */
+    uint8_t                     bg_color;       /*!< Default background palette index */
+    uint8_t                     use_hw_scroll;  /*!< Console covers the whole screen, scroll it with tft_driver_scroll when possible */
+} tft_console_cfg_t;
+
+/*
+ * @brief   Initialize TFT console with default parameters.
+ *
+ * @note    This function must be called first before any APIs.
+ *
+ * @param   None.
+ *
+ * @return
+ *      - TFT console handle structure.
+ *      - NULL: Fail.
+ */
+tft_console_handle_t tft_console_init(void);
+
+/*
+ * @brief   Configure TFT console.
+ *
+ * @note    Every cell is drawn on the first refresh.
+ *
+ * @param   handle Handle structure.
+ * @param   config Config structure.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_console_config(tft_console_handle_t handle, tft_console_cfg_t config);
+
+/*
+ * @brief   Write characters at cursor.
+ *
+ * @note    Cursor wraps to the next line at the end of a line, the console
+ *          scrolls up one line when the cursor moves past the last one.
+ *          Nothing is drawn until refresh.
+ *
+ * @param   handle Handle structure.
+ * @param   data Characters and control sequences.
+ * @param   len Number of bytes.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_console_write(tft_console_handle_t handle, const uint8_t *data, uint32_t len);
+
+/*
+ * @brief   Move cursor.
+ *
+ * @param   handle Handle structure.
+ * @param   col Column, clamped to the console.
+ * @param   row Row, clamped to the console.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_console_set_cursor(tft_console_handle_t handle, uint16_t col, uint16_t row);
+
+/*
+ * @brief   Get cursor.
+ *
+ * @param   handle Handle structure.
+ * @param   col Pointer references to the column.
+ * @param   row Pointer references to the row.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_console_get_cursor(tft_console_handle_t handle, uint16_t *col, uint16_t *row);
+
+/*
+ * @brief   Set colors of characters written from now on.
+ *
+ * @param   handle Handle structure.
+ * @param   fg_color Foreground palette index.
+ * @param   bg_color Background palette index.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_console_set_color(tft_console_handle_t handle, uint8_t fg_color, uint8_t bg_color);
+
+/*
+ * @brief   Clear console with current background color and move cursor to
+ *          the top left cell.
+ *
+ * @param   handle Handle structure.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_console_clear(tft_console_handle_t handle);
+
+/*
+ * @brief   Draw changed cells into the driver.
+ *
+ * @note    Immediate mode sends every cell as its own window right away,
+ *          other modes mark them dirty for the next driver refresh.
+ *
+ * @param   handle Handle structure.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_console_draw(tft_console_handle_t handle);
+
+/*
+ * @brief   Draw changed cells and refresh screen.
+ *
+ * @param   handle Handle structure.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_console_refresh(tft_console_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TFT_CONSOLE_H__ */
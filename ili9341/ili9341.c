@@ -2,6 +2,12 @@
 
 #define ILI3941_RST_ACTIVE_LEVEL 	0
 #define ILI3941_RST_UNACTIVE_LEVEL 	1
+#define ILI9341_COLOR_CHUNK 		256 		/*!< Pixels per transfer when streaming one color */
+#define ILI9341_TRANS_LIST_MAX 		8 			/*!< Transfers sent together in one transfer list */
+#define ILI9341_NUM_LINE 			320 		/*!< Gate lines, vertical scrolling runs along them */
+#define ILI9341_MADCTL_LANDSCAPE 	0x28 		/*!< MV=1, BGR=1 */
+#define ILI9341_MADCTL_PORTRAIT 	0x48 		/*!< MX=1, BGR=1 */
+#define ILI9341_RTNA_BASE 			0x10 		/*!< Clocks per line setting of the first frame rate entry */
 
 /**
  * @struct  LCD configuration structure.
@@ -75,6 +81,14 @@ lcd_init_cmd_t ili_init_cmds[] = {
 	{0, {0}, 0xff},
 };
 
+/**
+ * @brief   Frame rates of frame rate control settings RTNA 0x10 to 0x1F
+ *          with DIVA 0, DIVA 1 halves them.
+ */
+static const uint8_t ili9341_frame_rate[] = {
+	119, 112, 106, 100, 95, 90, 86, 83, 79, 76, 73, 70, 68, 65, 63, 61,
+};
+
 static err_code_t ili9341_write_cmd(tft_driver_spi_trans func_spi_trans,
                                     tft_driver_set_dc func_set_dc,
                                     uint8_t cmd)
@@ -155,6 +169,243 @@ err_code_t ili9341_init(tft_driver_spi_trans func_spi_trans,
 	return ERR_CODE_SUCCESS;
 }
 
+static err_code_t ili9341_send(tft_driver_io_t *io, tft_driver_trans_t *trans, uint32_t num_trans)
+{
+#ifdef TFT_DRIVER_ENABLE_STATS
+	for (uint32_t idx = 0; idx < num_trans; idx++)
+	{
+		TFT_DRIVER_IO_COUNT(io, 1, trans[idx].len);
+	}
+#endif
+
+	/* Transport takes the whole list, DC is switched by the port between transfers */
+	if (io->func_spi_trans_list != NULL)
+	{
+		io->dc_valid = 0;
+		return io->func_spi_trans_list(trans, num_trans);
+	}
+
+	/* Send one by one, DC only changes between command and data */
+	for (uint32_t idx = 0; idx < num_trans; idx++)
+	{
+		TFT_DRIVER_IO_SET_DC(io, trans[idx].dc);
+		io->func_spi_trans(trans[idx].data, trans[idx].len);
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+static uint32_t ili9341_add_trans(tft_driver_trans_t *trans, uint32_t num_trans, uint8_t dc, uint8_t *data, uint32_t len)
+{
+	trans[num_trans].dc = dc;
+	trans[num_trans].data = data;
+	trans[num_trans].len = len;
+
+	return num_trans + 1;
+}
+
+static uint32_t ili9341_add_window(tft_driver_io_t *io,
+                                   tft_driver_trans_t *trans,
+                                   uint32_t num_trans,
+                                   uint8_t *buf,
+                                   uint16_t x_start,
+                                   uint16_t y_start,
+                                   uint16_t x_end,
+                                   uint16_t y_end)
+{
+	static uint8_t cmd_caset = 0x2A;
+	static uint8_t cmd_paset = 0x2B;
+
+	/* Address registers keep their value, only send the ones which change */
+	if (!io->window_valid || (io->x_start != x_start) || (io->x_end != x_end))
+	{
+		buf[0] = x_start >> 8;		/* Start column high */
+		buf[1] = x_start & 0xFF;	/* Start column low */
+		buf[2] = x_end >> 8;		/* End column high */
+		buf[3] = x_end & 0xFF;		/* End column low */
+		num_trans = ili9341_add_trans(trans, num_trans, 0, &cmd_caset, 1);
+		num_trans = ili9341_add_trans(trans, num_trans, 1, &buf[0], 4);
+	}
+
+	if (!io->window_valid || (io->y_start != y_start) || (io->y_end != y_end))
+	{
+		buf[4] = y_start >> 8;		/* Start page high */
+		buf[5] = y_start & 0xFF;	/* Start page low */
+		buf[6] = y_end >> 8;		/* End page high */
+		buf[7] = y_end & 0xFF;		/* End page low */
+		num_trans = ili9341_add_trans(trans, num_trans, 0, &cmd_paset, 1);
+		num_trans = ili9341_add_trans(trans, num_trans, 1, &buf[4], 4);
+	}
+
+	io->x_start = x_start;
+	io->y_start = y_start;
+	io->x_end = x_end;
+	io->y_end = y_end;
+	io->window_valid = 1;
+
+	return num_trans;
+}
+
+static uint32_t ili9341_add_write_start(tft_driver_io_t *io,
+                                        tft_driver_trans_t *trans,
+                                        uint8_t *buf,
+                                        uint16_t x_start,
+                                        uint16_t y_start,
+                                        uint16_t x_end,
+                                        uint16_t y_end)
+{
+	static uint8_t cmd_ramwr = 0x2C;
+
+	/* Limit memory write to the area, memory write restarts at its top left */
+	uint32_t num_trans = ili9341_add_window(io, trans, 0, buf, x_start, y_start, x_end, y_end);
+
+	return ili9341_add_trans(trans, num_trans, 0, &cmd_ramwr, 1);
+}
+
+err_code_t ili9341_set_window(tft_driver_io_t *io,
+                              uint16_t x_start,
+                              uint16_t y_start,
+                              uint16_t x_end,
+                              uint16_t y_end)
+{
+	tft_driver_trans_t trans[4];
+	uint8_t buf[8];
+
+	uint32_t num_trans = ili9341_add_window(io, trans, 0, buf, x_start, y_start, x_end, y_end);
+	if (num_trans == 0)
+	{
+		return ERR_CODE_SUCCESS;
+	}
+
+	return ili9341_send(io, trans, num_trans);
+}
+
+err_code_t ili9341_write_start(tft_driver_io_t *io,
+                               uint16_t x_start,
+                               uint16_t y_start,
+                               uint16_t x_end,
+                               uint16_t y_end)
+{
+	tft_driver_trans_t trans[5];
+	uint8_t buf[8];
+
+	uint32_t num_trans = ili9341_add_write_start(io, trans, buf, x_start, y_start, x_end, y_end);
+
+	return ili9341_send(io, trans, num_trans);
+}
+
+err_code_t ili9341_write_area(tft_driver_io_t *io,
+                              uint16_t x_start,
+                              uint16_t y_start,
+                              uint16_t x_end,
+                              uint16_t y_end,
+                              uint16_t *data)
+{
+	tft_driver_trans_t trans[6];
+	uint8_t buf[8];
+	uint32_t num_pixel = (uint32_t)(x_end - x_start + 1) * (y_end - y_start + 1);
+
+	/* Window, memory write and screen data go out together */
+	uint32_t num_trans = ili9341_add_write_start(io, trans, buf, x_start, y_start, x_end, y_end);
+	num_trans = ili9341_add_trans(trans, num_trans, 1, (uint8_t*)data, num_pixel * sizeof(uint16_t));
+
+	return ili9341_send(io, trans, num_trans);
+}
+
+err_code_t ili9341_write_pixels(tft_driver_io_t *io, uint16_t *data, uint32_t num_pixel)
+{
+	tft_driver_trans_t trans;
+
+	/* Memory write goes on where the previous data stopped */
+	ili9341_add_trans(&trans, 0, 1, (uint8_t*)data, num_pixel * sizeof(uint16_t));
+
+	return ili9341_send(io, &trans, 1);
+}
+
+err_code_t ili9341_write_color(tft_driver_io_t *io, uint16_t color, uint32_t num_pixel)
+{
+	tft_driver_trans_t trans[ILI9341_TRANS_LIST_MAX];
+	uint16_t buf[ILI9341_COLOR_CHUNK];
+	uint32_t len = (num_pixel < ILI9341_COLOR_CHUNK) ? num_pixel : ILI9341_COLOR_CHUNK;
+
+	for (uint32_t idx = 0; idx < len; idx++)
+	{
+		buf[idx] = color;
+	}
+
+	/* Send the same chunk until window is filled, several chunks per transfer list */
+	while (num_pixel > 0)
+	{
+		uint32_t num_trans = 0;
+		while ((num_pixel > 0) && (num_trans < ILI9341_TRANS_LIST_MAX))
+		{
+			len = (num_pixel < ILI9341_COLOR_CHUNK) ? num_pixel : ILI9341_COLOR_CHUNK;
+			num_trans = ili9341_add_trans(trans, num_trans, 1, (uint8_t*)buf, len * sizeof(uint16_t));
+			num_pixel -= len;
+		}
+
+		err_code_t err = ili9341_send(io, trans, num_trans);
+		if (err != ERR_CODE_SUCCESS)
+		{
+			return err;
+		}
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+static err_code_t ili9341_send_cmd(tft_driver_io_t *io, uint8_t cmd, uint8_t *data, uint32_t len)
+{
+	tft_driver_trans_t trans[2];
+
+	/* Command and its parameters go out together */
+	uint32_t num_trans = ili9341_add_trans(trans, 0, 0, &cmd, 1);
+	num_trans = ili9341_add_trans(trans, num_trans, 1, data, len);
+
+	return ili9341_send(io, trans, num_trans);
+}
+
+err_code_t ili9341_set_orientation(tft_driver_io_t *io, uint8_t is_portrait)
+{
+	/* Memory access control, memory rows stay gate lines in both orientations */
+	uint8_t madctl = is_portrait ? ILI9341_MADCTL_PORTRAIT : ILI9341_MADCTL_LANDSCAPE;
+
+	return ili9341_send_cmd(io, 0x36, &madctl, 1);
+}
+
+err_code_t ili9341_set_scroll_area(tft_driver_io_t *io, uint16_t top_fixed, uint16_t scroll_lines)
+{
+	uint8_t buf[6];
+
+	/* Fixed areas and scroll area together must cover all gate lines */
+	if (top_fixed + scroll_lines > ILI9341_NUM_LINE)
+	{
+		return ERR_CODE_FAIL;
+	}
+	uint16_t bottom_fixed = ILI9341_NUM_LINE - top_fixed - scroll_lines;
+
+	/* Command vertical scrolling definition */
+	buf[0] = top_fixed >> 8;		/* Top fixed area high */
+	buf[1] = top_fixed & 0xFF;		/* Top fixed area low */
+	buf[2] = scroll_lines >> 8;		/* Scroll area high */
+	buf[3] = scroll_lines & 0xFF;	/* Scroll area low */
+	buf[4] = bottom_fixed >> 8;		/* Bottom fixed area high */
+	buf[5] = bottom_fixed & 0xFF;	/* Bottom fixed area low */
+
+	return ili9341_send_cmd(io, 0x33, buf, 6);
+}
+
+err_code_t ili9341_set_scroll_start(tft_driver_io_t *io, uint16_t line)
+{
+	uint8_t buf[2];
+
+	/* Command vertical scrolling start address, memory line shown first in scroll area */
+	buf[0] = line >> 8;				/* Start line high */
+	buf[1] = line & 0xFF;			/* Start line low */
+
+	return ili9341_send_cmd(io, 0x37, buf, 2);
+}
+
 err_code_t ili9341_write_lines(tft_driver_spi_trans func_spi_trans,
                                tft_driver_set_dc func_set_dc,
                                uint16_t width,
@@ -162,31 +413,113 @@ err_code_t ili9341_write_lines(tft_driver_spi_trans func_spi_trans,
                                uint16_t parallel_line,
                                uint16_t *lines_data)
 {
-	uint8_t buf[4] = {0, 0, 0, 0};
+	/* Panel window is unknown here, set it in full */
+	tft_driver_io_t io = {
+		.func_spi_trans = func_spi_trans,
+		.func_set_dc = func_set_dc,
+		.func_spi_trans_list = NULL,
+		.window_valid = 0,
+	};
+
+	/* Display full width lines. Window end addresses are inclusive */
+	return ili9341_write_area(&io,
+	                          0,
+	                          ypos,
+	                          width - 1,
+	                          ypos + parallel_line - 1,
+	                          lines_data);
+}
+
+err_code_t ili9341_sleep(tft_driver_io_t *io, uint8_t enable)
+{
+	tft_driver_trans_t trans;
+	uint8_t cmd = enable ? 0x10 : 0x11;
 
-	/* Command set column address */
-	ili9341_write_cmd(func_spi_trans, func_set_dc, 0x2A);
+	/* Command sleep in or sleep out */
+	ili9341_add_trans(&trans, 0, 0, &cmd, 1);
+	err_code_t err = ili9341_send(io, &trans, 1);
+	if (err != ERR_CODE_SUCCESS)
+	{
+		return err;
+	}
 
-	buf[0] = 0;					/* Start column high */
-	buf[1] = 0;					/* Start column low */
-	buf[2] = width >> 8;		/* End column high */
-	buf[3] = width & 0xFF;		/* End column low */
-	ili9341_write_data(func_spi_trans, func_set_dc, buf, 4);
+	/* Supply voltages settle after sleep out, no command is accepted meanwhile */
+	io->func_delay(enable ? 5 : 120);
 
-	/* Command set page address */
-	ili9341_write_cmd(func_spi_trans, func_set_dc, 0x2B);
+	return ERR_CODE_SUCCESS;
+}
 
-	buf[0] = ypos >> 8;							/* Start page high */
-	buf[1] = ypos & 0xFF;						/* Start page low */
-	buf[2] = (ypos + parallel_line) >> 8;		/* End page high */
-	buf[3] = (ypos + parallel_line) & 0xff;		/* End page low */
-	ili9341_write_data(func_spi_trans, func_set_dc, buf, 4);
+err_code_t ili9341_set_tear(tft_driver_io_t *io, uint8_t enable)
+{
+	tft_driver_trans_t trans[2];
+	uint8_t cmd = enable ? 0x35 : 0x34;
+	uint8_t mode = 0x00; 			/* TE on vertical blanking only */
 
-	/* Command set data */
-	ili9341_write_cmd(func_spi_trans, func_set_dc, 0x2C);
+	/* Command tearing effect line on with its mode, or off */
+	uint32_t num_trans = ili9341_add_trans(trans, 0, 0, &cmd, 1);
+	if (enable)
+	{
+		num_trans = ili9341_add_trans(trans, num_trans, 1, &mode, 1);
+	}
 
-	/* Transfer screen data */
-	ili9341_write_data(func_spi_trans, func_set_dc, (uint8_t*)lines_data, width * sizeof(uint16_t) * parallel_line);
+	return ili9341_send(io, trans, num_trans);
+}
 
-	return ERR_CODE_SUCCESS;
-}
\ No newline at end of file
+err_code_t ili9341_set_frame_rate(tft_driver_io_t *io, uint8_t *frame_rate)
+{
+	uint8_t buf[2] = {0x00, 0x1B};
+	uint8_t best_rate = 70;
+	int32_t best_diff = -1;
+
+	/* Nearest rate of oscillator divided by 1 or 2 */
+	for (uint8_t diva = 0; diva < 2; diva++)
+	{
+		for (uint8_t idx = 0; idx < sizeof(ili9341_frame_rate); idx++)
+		{
+			uint8_t rate = ili9341_frame_rate[idx] >> diva;
+			int32_t diff = (rate > *frame_rate) ? rate - *frame_rate : *frame_rate - rate;
+			if ((best_diff < 0) || (diff < best_diff))
+			{
+				best_diff = diff;
+				best_rate = rate;
+				buf[0] = diva;
+				buf[1] = ILI9341_RTNA_BASE + idx;
+			}
+		}
+	}
+
+	*frame_rate = best_rate;
+
+	/* Command frame rate control in normal mode, division ratio and clocks per line */
+	return ili9341_send_cmd(io, 0xB1, buf, 2);
+}
+
+static err_code_t ili9341_panel_init(tft_driver_io_t *io)
+{
+	err_code_t err = ili9341_init(io->func_spi_trans, io->func_set_dc, io->func_set_rst, io->func_delay);
+
+	/* Init sequence sets its own window and DC level */
+	io->window_valid = 0;
+	io->dc_valid = 0;
+
+	return err;
+}
+
+const tft_driver_panel_t ili9341_panel = {
+	.caps = TFT_DRIVER_PANEL_CAP_RGB565 | TFT_DRIVER_PANEL_CAP_HW_SCROLL |
+	        TFT_DRIVER_PANEL_CAP_ROTATION | TFT_DRIVER_PANEL_CAP_SLEEP |
+	        TFT_DRIVER_PANEL_CAP_TEAR,
+	.max_width = 320,
+	.max_height = 240,
+	.init = ili9341_panel_init,
+	.write_start = ili9341_write_start,
+	.write_area = ili9341_write_area,
+	.write_pixels = ili9341_write_pixels,
+	.write_color = ili9341_write_color,
+	.set_rotation = ili9341_set_orientation,
+	.set_scroll_area = ili9341_set_scroll_area,
+	.set_scroll_start = ili9341_set_scroll_start,
+	.sleep = ili9341_sleep,
+	.set_tear = ili9341_set_tear,
+	.set_frame_rate = ili9341_set_frame_rate,
+};
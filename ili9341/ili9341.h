@@ -30,6 +30,11 @@
 extern "C" {
 #endif
 
+/**
+ * @brief   ILI9341 backend, pass it as panel of the configuration.
+ */
+extern const tft_driver_panel_t ili9341_panel;
+
 /*
  * @brief   Initialize ILI9341 with default parameters.
  *
@@ -48,6 +53,186 @@ err_code_t ili9341_init(tft_driver_spi_trans func_spi_trans,
                         tft_driver_delay func_delay);
 
 
+/*
+ * @brief   Set column and page address window for memory write.
+ *
+ * @note    Address commands whose value equals the window cached in io are skipped.
+ *
+ * @param   io Panel IO.
+ * @param   x_start Start column.
+ * @param   y_start Start page.
+ * @param   x_end End column (inclusive).
+ * @param   y_end End page (inclusive).
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_set_window(tft_driver_io_t *io,
+                              uint16_t x_start,
+                              uint16_t y_start,
+                              uint16_t x_end,
+                              uint16_t y_end);
+
+/*
+ * @brief   Start memory write to rectangle area.
+ *
+ * @note    Pixel data must be transferred right after, DC is left low
+ *          for the memory write command. Set it high through
+ *          TFT_DRIVER_IO_SET_DC before sending pixel data directly.
+ *
+ * @param   io Panel IO.
+ * @param   x_start Start column.
+ * @param   y_start Start page.
+ * @param   x_end End column (inclusive).
+ * @param   y_end End page (inclusive).
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_write_start(tft_driver_io_t *io,
+                               uint16_t x_start,
+                               uint16_t y_start,
+                               uint16_t x_end,
+                               uint16_t y_end);
+
+/*
+ * @brief   Stream one color to memory.
+ *
+ * @note    Memory write must be started with ili9341_write_start.
+ *
+ * @param   io Panel IO.
+ * @param   color Color in panel byte order.
+ * @param   num_pixel Number of pixels.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_write_color(tft_driver_io_t *io, uint16_t color, uint32_t num_pixel);
+
+/*
+ * @brief   Continue memory write with pixel data.
+ *
+ * @note    Memory write must be started with ili9341_write_start or
+ *          ili9341_write_area. Panel keeps writing where the previous data
+ *          stopped, so consecutive rows of one window need no new commands.
+ *
+ * @param   io Panel IO.
+ * @param   data Pixel data, packed row by row.
+ * @param   num_pixel Number of pixels.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_write_pixels(tft_driver_io_t *io, uint16_t *data, uint32_t num_pixel);
+
+/*
+ * @brief   Display rectangle area.
+ *
+ * @param   io Panel IO.
+ * @param   x_start Start column.
+ * @param   y_start Start page.
+ * @param   x_end End column (inclusive).
+ * @param   y_end End page (inclusive).
+ * @param   data Display buffer, packed row by row.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_write_area(tft_driver_io_t *io,
+                              uint16_t x_start,
+                              uint16_t y_start,
+                              uint16_t x_end,
+                              uint16_t y_end,
+                              uint16_t *data);
+
+/*
+ * @brief   Set screen orientation.
+ *
+ * @param   io Panel IO.
+ * @param   is_portrait 1 for portrait 240x320, 0 for landscape 320x240.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_set_orientation(tft_driver_io_t *io, uint8_t is_portrait);
+
+/*
+ * @brief   Set vertical scrolling area.
+ *
+ * @note    Scrolling runs along the 320 gate lines, which are screen rows
+ *          only in portrait orientation. Lines below the scroll area are fixed.
+ *
+ * @param   io Panel IO.
+ * @param   top_fixed Number of fixed lines on top.
+ * @param   scroll_lines Number of lines in scroll area.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_set_scroll_area(tft_driver_io_t *io, uint16_t top_fixed, uint16_t scroll_lines);
+
+/*
+ * @brief   Set vertical scrolling start address.
+ *
+ * @param   io Panel IO.
+ * @param   line Memory line shown at the top of scroll area.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_set_scroll_start(tft_driver_io_t *io, uint16_t line);
+
+/*
+ * @brief   Enter or leave sleep mode.
+ *
+ * @note    Waits until the panel accepts commands again.
+ *
+ * @param   io Panel IO.
+ * @param   enable 1 to enter sleep mode, 0 to leave it.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_sleep(tft_driver_io_t *io, uint8_t enable);
+
+/*
+ * @brief   Enable or disable tearing effect output.
+ *
+ * @note    TE pin goes high at the start of vertical blanking, memory written
+ *          from then on at least as fast as the scan is shown without tearing.
+ *
+ * @param   io Panel IO.
+ * @param   enable 1 to enable TE output, 0 to disable it.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_set_tear(tft_driver_io_t *io, uint8_t enable);
+
+/*
+ * @brief   Set frame rate in normal mode.
+ *
+ * @note    Supported rates are 30 to 119 Hz in uneven steps, the nearest one is used.
+ *
+ * @param   io Panel IO.
+ * @param   frame_rate Pointer references to the frame rate, updated to the rate used.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t ili9341_set_frame_rate(tft_driver_io_t *io, uint8_t *frame_rate);
+
 /*
  * @brief   Display multi-lines.
  *
@@ -34,6 +34,94 @@ typedef err_code_t (*tft_driver_set_dc)(uint8_t level);
 typedef err_code_t (*tft_driver_set_rst)(uint8_t level);
 typedef err_code_t (*tft_driver_delay)(uint32_t delay_ms);
 
+/* Queue transfer without waiting. DC level is not changed until the transfer completes */
+typedef err_code_t (*tft_driver_spi_queue_trans)(uint8_t *data, uint32_t len);
+/* Wait oldest queued transfer to complete. Return ERR_CODE_SUCCESS if done within timeout, 0 to poll */
+typedef err_code_t (*tft_driver_spi_wait_trans)(uint32_t timeout_ms);
+
+/* Job run by workers, idx tells which part of the work to do */
+typedef void (*tft_driver_job_t)(void *arg, uint32_t idx);
+/* Run job for idx 0 to num_job - 1 spread over worker threads or tasks, return when all are done */
+typedef err_code_t (*tft_driver_run_parallel)(tft_driver_job_t job, void *arg, uint32_t num_job);
+
+/**
+ * @struct  One transfer of a transfer list.
+ */
+typedef struct {
+    uint8_t     dc;                 /*!< DC level during transfer */
+    uint8_t     *data;
+    uint32_t    len;
+} tft_driver_trans_t;
+
+/* Send transfers back to back, as one DMA chain if possible. Return after the last one completes */
+typedef err_code_t (*tft_driver_spi_trans_list)(tft_driver_trans_t *trans, uint32_t num_trans);
+
+/* Free running microsecond clock, wraps around */
+typedef uint32_t (*tft_driver_get_time_us)(void);
+
+/* Wait next rising edge of panel TE output, edges since the last call count. Return ERR_CODE_SUCCESS if one came within timeout, 0 to poll */
+typedef err_code_t (*tft_driver_wait_te)(uint32_t timeout_ms);
+
+/**
+ * @struct  Panel IO, port functions together with the panel address window last set.
+ */
+typedef struct {
+    tft_driver_spi_trans        func_spi_trans;
+    tft_driver_set_dc           func_set_dc;
+    tft_driver_spi_trans_list   func_spi_trans_list;    /*!< Optional, NULL to send transfers one by one */
+    tft_driver_set_rst          func_set_rst;
+    tft_driver_delay            func_delay;
+    uint16_t                    x_start;
+    uint16_t                    y_start;
+    uint16_t                    x_end;
+    uint16_t                    y_end;
+    uint8_t                     window_valid;           /*!< Window above matches the panel */
+    uint8_t                     dc_level;               /*!< DC level last set */
+    uint8_t                     dc_valid;               /*!< DC level above matches the pin */
+#ifdef TFT_DRIVER_ENABLE_STATS
+    uint32_t                    num_trans;              /*!< Transfers sent */
+    uint64_t                    num_byte;               /*!< Bytes sent */
+#endif
+} tft_driver_io_t;
+
+/* Set DC level of a panel backend, the pin is only written when the level changes */
+#define TFT_DRIVER_IO_SET_DC(io, level)                 do { if (!(io)->dc_valid || ((io)->dc_level != (level))) { (io)->func_set_dc(level); (io)->dc_level = (level); (io)->dc_valid = 1; } } while (0)
+
+/* Count transfers of a panel backend, nothing when statistics are disabled */
+#ifdef TFT_DRIVER_ENABLE_STATS
+#define TFT_DRIVER_IO_COUNT(io, trans_num, byte_num)    do { (io)->num_trans += (trans_num); (io)->num_byte += (byte_num); } while (0)
+#else
+#define TFT_DRIVER_IO_COUNT(io, trans_num, byte_num)    do { } while (0)
+#endif
+
+#define TFT_DRIVER_PANEL_CAP_RGB565     (1 << 0)    /*!< Accepts byte swapped RGB565 pixel data */
+#define TFT_DRIVER_PANEL_CAP_HW_SCROLL  (1 << 1)    /*!< Scrolls screen rows in hardware in portrait rotation */
+#define TFT_DRIVER_PANEL_CAP_ROTATION   (1 << 2)    /*!< Can switch between landscape and portrait */
+#define TFT_DRIVER_PANEL_CAP_SLEEP      (1 << 3)    /*!< Can enter and leave sleep mode */
+#define TFT_DRIVER_PANEL_CAP_TEAR       (1 << 4)    /*!< Drives TE output at vertical blanking and has selectable frame rate */
+
+/**
+ * @struct  Panel controller backend. Window ends are inclusive, rotation is
+ *          0 for landscape and 1 for portrait. Operations a panel does not
+ *          support per its capabilities may be NULL.
+ */
+typedef struct {
+    uint32_t    caps;                   /*!< TFT_DRIVER_PANEL_CAP_* flags */
+    uint16_t    max_width;              /*!< Columns in landscape */
+    uint16_t    max_height;             /*!< Rows in landscape */
+    err_code_t  (*init)(tft_driver_io_t *io);
+    err_code_t  (*write_start)(tft_driver_io_t *io, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end);
+    err_code_t  (*write_area)(tft_driver_io_t *io, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end, uint16_t *data);
+    err_code_t  (*write_pixels)(tft_driver_io_t *io, uint16_t *data, uint32_t num_pixel);
+    err_code_t  (*write_color)(tft_driver_io_t *io, uint16_t color, uint32_t num_pixel);
+    err_code_t  (*set_rotation)(tft_driver_io_t *io, uint8_t rotation);
+    err_code_t  (*set_scroll_area)(tft_driver_io_t *io, uint16_t top_fixed, uint16_t scroll_lines);
+    err_code_t  (*set_scroll_start)(tft_driver_io_t *io, uint16_t line);
+    err_code_t  (*sleep)(tft_driver_io_t *io, uint8_t enable);
+    err_code_t  (*set_tear)(tft_driver_io_t *io, uint8_t enable);
+    err_code_t  (*set_frame_rate)(tft_driver_io_t *io, uint8_t *frame_rate);   /*!< Scan at the supported rate nearest to frame_rate, which is updated to it */
+} tft_driver_panel_t;
+
 
 #ifdef __cplusplus
 }
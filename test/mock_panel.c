@@ -0,0 +1,371 @@
+#include "stdbool.h"
+#include "string.h"
+#include "errno.h"
+#include "pthread.h"
+#include "time.h"
+#include "unistd.h"
+#include "mock_panel.h"
+
+#define MOCK_PANEL_MAX_ARG 		4 		/*!< Parameter bytes decoded per command */
+#define MOCK_PANEL_TRANS_US 	20 		/*!< Wall time a queued transfer takes */
+#define MOCK_PANEL_FOSC_HZ 		615000 	/*!< Internal oscillator frame rate control divides */
+#define MOCK_PANEL_SCAN_LINE 	324 	/*!< Gate lines and porches of one frame */
+
+typedef struct {
+	uint8_t *data;
+	uint32_t len;
+} mock_trans_t;
+
+/**
+ * @struct  Transfers queued to the sending thread. Positions count up,
+ *          queued >= sent >= waited.
+ */
+typedef struct {
+	mock_trans_t trans[MOCK_PANEL_QUEUE_SIZE];
+	uint32_t num_queued;
+	uint32_t num_sent;
+	uint32_t num_waited;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t thread;
+	uint8_t is_started;
+} mock_queue_t;
+
+typedef struct {
+	uint16_t mem[MOCK_PANEL_NUM_ROW][MOCK_PANEL_NUM_COL];
+	uint32_t spi_clock_hz;
+	mock_panel_stats_t stats;
+	uint8_t dc;
+	uint8_t cmd;
+	uint8_t arg[MOCK_PANEL_MAX_ARG];
+	uint8_t num_arg;
+	uint16_t x_start;
+	uint16_t x_end;
+	uint16_t y_start;
+	uint16_t y_end;
+	uint16_t x;
+	uint16_t y;
+	uint8_t byte_lo; 				/*!< First byte of a pixel split across transfers */
+	uint8_t has_byte_lo;
+	uint16_t scroll_start;
+	uint8_t diva; 					/*!< Frame rate control division ratio */
+	uint8_t rtna; 					/*!< Frame rate control clocks per line */
+	uint8_t te_on;
+	uint64_t time_ns; 				/*!< Simulated time, moved on by the test and TE waits */
+	uint64_t next_te_ns;
+	uint64_t last_te_ns;
+	uint32_t num_te_pending; 		/*!< Edges not taken by a TE wait yet */
+} mock_panel_t;
+
+static mock_panel_t panel;
+static mock_queue_t queue = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void write_pixel(uint16_t pixel)
+{
+	/* Memory write wraps inside the window like the controller does */
+	if ((panel.x < MOCK_PANEL_NUM_COL) && (panel.y < MOCK_PANEL_NUM_ROW))
+	{
+		panel.mem[panel.y][panel.x] = pixel;
+	}
+
+	if (panel.x++ >= panel.x_end)
+	{
+		panel.x = panel.x_start;
+		if (panel.y++ >= panel.y_end)
+		{
+			panel.y = panel.y_start;
+		}
+	}
+}
+
+static uint64_t te_period_ns(void)
+{
+	return (uint64_t)panel.rtna * (1 << panel.diva) * MOCK_PANEL_SCAN_LINE * 1000000000 / MOCK_PANEL_FOSC_HZ;
+}
+
+static void set_te(uint8_t enable)
+{
+	/* Scan goes on from now, edges signalled before are gone */
+	panel.te_on = enable;
+	panel.num_te_pending = 0;
+	panel.next_te_ns = panel.time_ns + te_period_ns();
+}
+
+static void advance_time(uint64_t time_ns)
+{
+	panel.time_ns = time_ns;
+	while (panel.te_on && (panel.next_te_ns <= panel.time_ns))
+	{
+		panel.last_te_ns = panel.next_te_ns;
+		panel.next_te_ns += te_period_ns();
+		panel.num_te_pending++;
+		panel.stats.num_te_edge++;
+	}
+}
+
+static void write_arg(uint8_t data)
+{
+	if (panel.num_arg < MOCK_PANEL_MAX_ARG)
+	{
+		panel.arg[panel.num_arg] = data;
+	}
+	panel.num_arg++;
+
+	if ((panel.cmd == 0x2A) && (panel.num_arg == 4))
+	{
+		panel.x_start = (panel.arg[0] << 8) | panel.arg[1];
+		panel.x_end = (panel.arg[2] << 8) | panel.arg[3];
+	}
+	else if ((panel.cmd == 0x2B) && (panel.num_arg == 4))
+	{
+		panel.y_start = (panel.arg[0] << 8) | panel.arg[1];
+		panel.y_end = (panel.arg[2] << 8) | panel.arg[3];
+	}
+	else if ((panel.cmd == 0x37) && (panel.num_arg == 2))
+	{
+		panel.scroll_start = (panel.arg[0] << 8) | panel.arg[1];
+	}
+	else if ((panel.cmd == 0xB1) && (panel.num_arg == 2))
+	{
+		panel.diva = panel.arg[0] & 0x03;
+		panel.rtna = panel.arg[1] & 0x1F;
+		if (panel.te_on)
+		{
+			set_te(1);
+		}
+	}
+}
+
+void mock_panel_reset(uint32_t spi_clock_hz)
+{
+	memset(&panel, 0, sizeof(panel));
+	panel.spi_clock_hz = spi_clock_hz;
+	panel.rtna = 0x1B;
+}
+
+err_code_t mock_panel_spi_trans(uint8_t *data, uint32_t len)
+{
+	panel.stats.num_trans++;
+	panel.stats.num_byte += len;
+	panel.stats.bus_time_ns += MOCK_PANEL_TRANS_OVERHEAD_NS + (uint64_t)len * 8 * 1000000000 / panel.spi_clock_hz;
+
+	/* Command byte, memory write starts at the window origin */
+	if (!panel.dc)
+	{
+		if (len == 0)
+		{
+			return ERR_CODE_SUCCESS;
+		}
+		panel.cmd = data[0];
+		panel.num_arg = 0;
+		panel.has_byte_lo = false;
+		if (panel.cmd == 0x2C)
+		{
+			panel.x = panel.x_start;
+			panel.y = panel.y_start;
+		}
+		else if ((panel.cmd == 0x34) || (panel.cmd == 0x35))
+		{
+			set_te(panel.cmd == 0x35);
+		}
+
+		return ERR_CODE_SUCCESS;
+	}
+
+	for (uint32_t i = 0; i < len; i++)
+	{
+		if ((panel.cmd != 0x2C) && (panel.cmd != 0x3C))
+		{
+			write_arg(data[i]);
+		}
+		else if (!panel.has_byte_lo)
+		{
+			panel.byte_lo = data[i];
+			panel.has_byte_lo = true;
+		}
+		else
+		{
+			/* Memory keeps bytes in the order sent, as the driver's buffers hold them */
+			uint8_t pixel[2] = {panel.byte_lo, data[i]};
+			uint16_t value;
+			memcpy(&value, pixel, sizeof(value));
+			write_pixel(value);
+			panel.has_byte_lo = false;
+		}
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t mock_panel_set_dc(uint8_t level)
+{
+	panel.stats.num_dc_write++;
+	if (level != panel.dc)
+	{
+		panel.stats.num_dc_toggle++;
+	}
+	panel.dc = level;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t mock_panel_set_rst(uint8_t level)
+{
+	(void)level;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t mock_panel_delay(uint32_t delay_ms)
+{
+	(void)delay_ms;
+
+	return ERR_CODE_SUCCESS;
+}
+
+void mock_panel_get_stats(mock_panel_stats_t *stats)
+{
+	*stats = panel.stats;
+}
+
+void mock_panel_reset_stats(void)
+{
+	memset(&panel.stats, 0, sizeof(panel.stats));
+}
+
+uint16_t mock_panel_get_pixel(uint16_t col, uint16_t row)
+{
+	return panel.mem[row][col];
+}
+
+uint16_t mock_panel_get_scroll_start(void)
+{
+	return panel.scroll_start;
+}
+
+err_code_t mock_panel_wait_te(uint32_t timeout_ms)
+{
+	/* Edge which came since the last wait, or the next one if it comes in time */
+	if ((panel.num_te_pending == 0) && (timeout_ms > 0))
+	{
+		uint64_t timeout_ns = panel.time_ns + (uint64_t)timeout_ms * 1000000;
+		advance_time((panel.te_on && (panel.next_te_ns <= timeout_ns)) ? panel.next_te_ns : timeout_ns);
+	}
+	if (panel.num_te_pending == 0)
+	{
+		return ERR_CODE_FAIL;
+	}
+	panel.num_te_pending--;
+
+	return ERR_CODE_SUCCESS;
+}
+
+void mock_panel_advance_time(uint32_t time_us)
+{
+	advance_time(panel.time_ns + (uint64_t)time_us * 1000);
+}
+
+uint64_t mock_panel_get_time_ns(void)
+{
+	return panel.time_ns;
+}
+
+uint64_t mock_panel_get_last_te_ns(void)
+{
+	return panel.last_te_ns;
+}
+
+uint32_t mock_panel_get_scan_rate(void)
+{
+	uint64_t period_ns = te_period_ns();
+
+	return (1000000000 + period_ns / 2) / period_ns;
+}
+
+static void *send_thread(void *arg)
+{
+	(void)arg;
+
+	pthread_mutex_lock(&queue.lock);
+	while (true)
+	{
+		while (queue.num_sent == queue.num_queued)
+		{
+			pthread_cond_wait(&queue.cond, &queue.lock);
+		}
+		mock_trans_t trans = queue.trans[queue.num_sent % MOCK_PANEL_QUEUE_SIZE];
+		pthread_mutex_unlock(&queue.lock);
+
+		/* Data is read when the transfer is over, not when it was queued */
+		usleep(MOCK_PANEL_TRANS_US);
+		mock_panel_spi_trans(trans.data, trans.len);
+
+		pthread_mutex_lock(&queue.lock);
+		queue.num_sent++;
+		pthread_cond_broadcast(&queue.cond);
+	}
+
+	return NULL;
+}
+
+err_code_t mock_panel_queue_trans(uint8_t *data, uint32_t len)
+{
+	pthread_mutex_lock(&queue.lock);
+	if (!queue.is_started)
+	{
+		if (pthread_create(&queue.thread, NULL, send_thread, NULL) != 0)
+		{
+			pthread_mutex_unlock(&queue.lock);
+			return ERR_CODE_FAIL;
+		}
+		pthread_detach(queue.thread);
+		queue.is_started = true;
+	}
+
+	/* Transfers not waited for yet keep their slot */
+	if (queue.num_queued - queue.num_waited >= MOCK_PANEL_QUEUE_SIZE)
+	{
+		pthread_mutex_unlock(&queue.lock);
+		return ERR_CODE_FAIL;
+	}
+
+	queue.trans[queue.num_queued % MOCK_PANEL_QUEUE_SIZE].data = data;
+	queue.trans[queue.num_queued % MOCK_PANEL_QUEUE_SIZE].len = len;
+	queue.num_queued++;
+	pthread_cond_broadcast(&queue.cond);
+	pthread_mutex_unlock(&queue.lock);
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t mock_panel_wait_trans(uint32_t timeout_ms)
+{
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	/* Oldest transfer not waited for yet */
+	pthread_mutex_lock(&queue.lock);
+	while (queue.num_sent == queue.num_waited)
+	{
+		if ((queue.num_waited == queue.num_queued) || (timeout_ms == 0) ||
+		    (pthread_cond_timedwait(&queue.cond, &queue.lock, &deadline) == ETIMEDOUT))
+		{
+			pthread_mutex_unlock(&queue.lock);
+			return ERR_CODE_FAIL;
+		}
+	}
+	queue.num_waited++;
+	pthread_mutex_unlock(&queue.lock);
+
+	return ERR_CODE_SUCCESS;
+}
@@ -0,0 +1,171 @@
+// MIT License
+
+// Copyright (c) 2023 phonght32
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __MOCK_PANEL_H__
+#define __MOCK_PANEL_H__
+
+#include "err_code.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ILI9341 stand-in behind the driver port functions. Column and page
+ * address, memory write and vertical scroll commands are decoded into
+ * panel memory, everything sent is counted together with the time it
+ * would take on the bus.
+ *
+ * Queued transfers are sent by a thread, which reads their data only when
+ * the transfer completes. A buffer changed while its transfer is queued
+ * shows up on the panel as it would with DMA.
+ *
+ * TE output follows tearing effect line on and off and the scan rate set
+ * by frame rate control. Its edges come on a simulated clock, which only
+ * moves when the test moves it or the driver waits for an edge.
+ */
+
+#define MOCK_PANEL_NUM_COL          320         /*!< Panel memory is addressed up to this in both rotations */
+#define MOCK_PANEL_NUM_ROW          320
+#define MOCK_PANEL_TRANS_OVERHEAD_NS 2000       /*!< Setup time of every transfer, chip select and DMA start */
+#define MOCK_PANEL_QUEUE_SIZE       16          /*!< Transfers queued at most */
+
+/**
+ * @struct  Mock panel counters.
+ */
+typedef struct {
+    uint32_t                    num_trans;      /*!< Transfers */
+    uint64_t                    num_byte;       /*!< Bytes, commands included */
+    uint32_t                    num_dc_toggle;  /*!< DC level changes */
+    uint32_t                    num_dc_write;   /*!< DC pin writes, changing the level or not */
+    uint32_t                    num_te_edge;    /*!< TE rising edges signalled */
+    uint64_t                    bus_time_ns;    /*!< Time the transfers take at the SPI clock */
+} mock_panel_stats_t;
+
+/*
+ * @brief   Clear panel memory and counters.
+ *
+ * @param   spi_clock_hz SPI clock bus time is counted at.
+ *
+ * @return  None.
+ */
+void mock_panel_reset(uint32_t spi_clock_hz);
+
+/*
+ * @brief   Port functions for tft_driver_set_func.
+ */
+err_code_t mock_panel_spi_trans(uint8_t *data, uint32_t len);
+err_code_t mock_panel_set_dc(uint8_t level);
+err_code_t mock_panel_set_rst(uint8_t level);
+err_code_t mock_panel_delay(uint32_t delay_ms);
+
+/*
+ * @brief   Port functions for tft_driver_set_func_async.
+ */
+err_code_t mock_panel_queue_trans(uint8_t *data, uint32_t len);
+err_code_t mock_panel_wait_trans(uint32_t timeout_ms);
+
+/*
+ * @brief   Port function for tft_driver_set_func_tear. Waiting moves
+ *          simulated time on to the edge, or by the timeout if none comes.
+ */
+err_code_t mock_panel_wait_te(uint32_t timeout_ms);
+
+/*
+ * @brief   Get counters.
+ *
+ * @param   stats Pointer references to the counters.
+ *
+ * @return  None.
+ */
+void mock_panel_get_stats(mock_panel_stats_t *stats);
+
+/*
+ * @brief   Clear counters, panel memory is kept.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+void mock_panel_reset_stats(void);
+
+/*
+ * @brief   Get pixel of panel memory.
+ *
+ * @param   col Column as addressed by the driver.
+ * @param   row Page as addressed by the driver.
+ *
+ * @return  Pixel as sent, byte swapped RGB565.
+ */
+uint16_t mock_panel_get_pixel(uint16_t col, uint16_t row);
+
+/*
+ * @brief   Get vertical scroll start line.
+ *
+ * @param   None.
+ *
+ * @return  Line shown at the top of the scroll area.
+ */
+uint16_t mock_panel_get_scroll_start(void);
+
+/*
+ * @brief   Move simulated time on, TE edges on the way are signalled.
+ *
+ * @param   time_us Time in microseconds.
+ *
+ * @return  None.
+ */
+void mock_panel_advance_time(uint32_t time_us);
+
+/*
+ * @brief   Get simulated time.
+ *
+ * @param   None.
+ *
+ * @return  Time in nanoseconds since reset.
+ */
+uint64_t mock_panel_get_time_ns(void);
+
+/*
+ * @brief   Get time of the last TE edge.
+ *
+ * @param   None.
+ *
+ * @return  Time in nanoseconds since reset, 0 before the first edge.
+ */
+uint64_t mock_panel_get_last_te_ns(void);
+
+/*
+ * @brief   Get scan rate set by frame rate control.
+ *
+ * @param   None.
+ *
+ * @return  Frames per second, rounded.
+ */
+uint32_t mock_panel_get_scan_rate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MOCK_PANEL_H__ */
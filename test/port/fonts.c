@@ -0,0 +1,37 @@
+#include "fonts.h"
+
+#define FONT_NUM_PATTERN 		32 		/*!< Characters with distinct glyphs, others repeat them */
+
+/* Glyph of character c starts at byte c % FONT_NUM_PATTERN, so glyphs overlap
+   and differ from each other without a table per character */
+static const uint8_t font_pattern[FONT_NUM_PATTERN + 32] = {
+	0x00, 0x38, 0x44, 0x82, 0xFE, 0x82, 0x82, 0x00, 0xFC, 0x42, 0x7C, 0x42, 0xFC, 0x00, 0x3C, 0x40,
+	0x80, 0x80, 0x42, 0x3C, 0x00, 0xF8, 0x44, 0x42, 0x44, 0xF8, 0x00, 0xFE, 0x80, 0xF8, 0x80, 0xFE,
+	0x00, 0x18, 0x24, 0x5A, 0xA5, 0x81, 0x7E, 0x00, 0xE7, 0x66, 0x3C, 0x18, 0x3C, 0x66, 0xE7, 0x00,
+	0x10, 0x30, 0x50, 0x10, 0x10, 0x7C, 0x00, 0xAA, 0x55, 0xAA, 0x55, 0xFF, 0x81, 0xBD, 0xA5, 0xFF,
+};
+
+int get_font(uint8_t chr, font_size_t font_size, font_t *font)
+{
+	/* Control characters have no glyph */
+	if ((chr < ' ') || (font_size >= FONT_SIZE_MAX))
+	{
+		return 0;
+	}
+
+	font->data = &font_pattern[chr % FONT_NUM_PATTERN];
+	if (font_size == FONT_SIZE_8)
+	{
+		font->width = 6;
+		font->height = 8;
+		font->data_len = 8;
+	}
+	else
+	{
+		font->width = 11;
+		font->height = 16;
+		font->data_len = 32;
+	}
+
+	return 1;
+}
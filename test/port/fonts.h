@@ -0,0 +1,74 @@
+// MIT License
+
+// Copyright (c) 2023 phonght32
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __FONTS_H__
+#define __FONTS_H__
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Host stand-in for the fonts component. Glyphs are fixed bit patterns of
+ * the real glyph sizes, enough to exercise text drawing off target.
+ */
+
+/**
+ * @enum    Font size.
+ */
+typedef enum {
+    FONT_SIZE_8 = 0,                            /*!< 6 x 8 glyphs, 1 byte per row */
+    FONT_SIZE_16,                               /*!< 11 x 16 glyphs, 2 bytes per row */
+    FONT_SIZE_MAX,
+} font_size_t;
+
+/**
+ * @struct  Glyph bitmap, rows of most significant bit leftmost bytes.
+ */
+typedef struct {
+    uint8_t                     width;
+    uint8_t                     height;
+    const uint8_t               *data;
+    uint16_t                    data_len;
+} font_t;
+
+/*
+ * @brief   Get glyph of a character.
+ *
+ * @param   chr Character.
+ * @param   font_size Font size.
+ * @param   font Pointer references to the glyph.
+ *
+ * @return
+ *      - 1: Success.
+ *      - 0: No glyph for the character.
+ */
+int get_font(uint8_t chr, font_size_t font_size, font_t *font);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FONTS_H__ */
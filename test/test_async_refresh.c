@@ -0,0 +1,269 @@
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "tft_driver.h"
+#include "mock_panel.h"
+#include "worker_pool.h"
+
+#define TEST_NUM_FRAME 			40
+#define TEST_DL_SIZE 			(64 * 1024)
+
+/**
+ * @struct  Driver setup both refreshes run with.
+ */
+typedef struct {
+	const char *name;
+	tft_driver_render_mode_t render_mode;
+	tft_driver_pixel_format_t pixel_format;
+	tft_driver_rotation_t rotation;
+	uint8_t num_parallel_band;
+	uint8_t num_worker; 			/*!< Workers bands of the asynchronous refresh are prepared on, 0 for none */
+	uint16_t glyph_cache_size;
+	uint8_t is_drawn_during_frame; 	/*!< Draw while the asynchronous frame is on the bus */
+} test_case_t;
+
+static const test_case_t test_case[] = {
+	{"fb888", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB888, TFT_DRIVER_ROTATION_LANDSCAPE, 0, 0, 0, false},
+	{"fb565", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_LANDSCAPE, 0, 0, 0, false},
+	{"fb565 2 bands", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_LANDSCAPE, 2, 2, 0, false},
+	{"fb888 4 bands", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB888, TFT_DRIVER_ROTATION_LANDSCAPE, 4, 4, 0, false},
+	{"index4", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_INDEX4, TFT_DRIVER_ROTATION_LANDSCAPE, 0, 0, 0, false},
+	{"index4 2 bands", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_INDEX4, TFT_DRIVER_ROTATION_LANDSCAPE, 2, 2, 0, false},
+	{"display list", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_LANDSCAPE, 0, 0, 0, false},
+	{"display list 4 bands", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_LANDSCAPE, 4, 4, 4, false},
+	{"display list 3 bands 2 workers", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_LANDSCAPE, 3, 2, 4, false},
+	{"portrait scroll", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_PORTRAIT, 0, 0, 0, false},
+	{"portrait scroll 2 bands", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_PORTRAIT, 2, 2, 0, false},
+	{"fb565 draw during frame", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_LANDSCAPE, 0, 0, 0, true},
+	{"display list draw during frame", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_LANDSCAPE, 0, 0, 0, true},
+	{"display list 2 bands during frame", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, TFT_DRIVER_ROTATION_LANDSCAPE, 2, 2, 4, true},
+};
+
+static uint16_t expected[TEST_NUM_FRAME][MOCK_PANEL_NUM_ROW][MOCK_PANEL_NUM_COL];
+#ifdef TFT_DRIVER_ENABLE_STATS
+static tft_driver_stats_t expected_stats;
+#endif
+static uint32_t test_seed;
+
+static uint32_t test_rand(void)
+{
+	test_seed ^= test_seed << 13;
+	test_seed ^= test_seed >> 17;
+	test_seed ^= test_seed << 5;
+
+	return test_seed;
+}
+
+static void draw_frame(tft_driver_handle_t handle, uint16_t width, uint16_t height, bool is_portrait)
+{
+	static uint8_t text[] = "async";
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		uint16_t x = test_rand() % width;
+		uint16_t y = test_rand() % height;
+		uint16_t w = test_rand() % (width / 2);
+		uint16_t h = test_rand() % (height / 2);
+		uint32_t color = test_rand() & 0xFFFFFF;
+		switch (test_rand() % 5)
+		{
+		case 0:
+			tft_driver_fill_rectangle(handle, x, y, w, h, color);
+			break;
+		case 1:
+			tft_driver_fill_circle(handle, x, y, w / 4, color);
+			break;
+		case 2:
+			tft_driver_write_line(handle, x, y, w * 2, h * 2, color);
+			break;
+		case 3:
+			tft_driver_set_position(handle, x, y);
+			tft_driver_write_string(handle, FONT_SIZE_16, text, color);
+			break;
+		default:
+			if (is_portrait)
+			{
+				tft_driver_scroll(handle, (int16_t)(test_rand() % 33) - 16);
+			}
+			else
+			{
+				tft_driver_write_rectangle(handle, x, y, w, h, color);
+			}
+			break;
+		}
+	}
+}
+
+static void refresh(tft_driver_handle_t handle, bool is_async)
+{
+	if (!is_async)
+	{
+		tft_driver_screen_refresh(handle);
+		return;
+	}
+
+	/* Poll the way a main loop would, never blocking */
+	uint8_t is_done = false;
+	tft_driver_screen_refresh_async(handle);
+	while (!is_done)
+	{
+		tft_driver_refresh_poll(handle, &is_done);
+	}
+}
+
+static int run_case(const test_case_t *tc, bool is_async)
+{
+	bool is_portrait = tc->rotation == TFT_DRIVER_ROTATION_PORTRAIT;
+	tft_driver_cfg_t config = {
+		.height = is_portrait ? 320 : 240,
+		.width = is_portrait ? 240 : 320,
+		.pixel_format = tc->pixel_format,
+		.render_mode = tc->render_mode,
+		.display_list_size = TEST_DL_SIZE,
+		.rotation = tc->rotation,
+		.num_parallel_band = tc->num_parallel_band,
+		.glyph_cache_size = tc->glyph_cache_size,
+	};
+
+	tft_driver_handle_t handle = tft_driver_init();
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	if (is_async)
+	{
+		tft_driver_set_func_async(handle, mock_panel_queue_trans, mock_panel_wait_trans);
+	}
+
+	/* Bands of the synchronous refresh are prepared one after another, it is the reference */
+	if (is_async && (tc->num_worker > 0))
+	{
+		tft_driver_set_func_parallel(handle, worker_pool_run);
+	}
+	mock_panel_reset(40000000);
+	if (tft_driver_config(handle, config) != ERR_CODE_SUCCESS)
+	{
+		printf("%s: config failed\n", tc->name);
+		return 1;
+	}
+
+	int num_bad_frame = 0;
+	test_seed = 12345;
+	for (uint32_t frame = 0; frame < TEST_NUM_FRAME; frame++)
+	{
+		draw_frame(handle, config.width, config.height, is_portrait);
+
+		/* Drawing during the frame goes out with the next one, synchronous
+		   refresh gets it before, so only the frame after can be compared */
+		if (tc->is_drawn_during_frame && is_async)
+		{
+			uint8_t is_done = false;
+			tft_driver_screen_refresh_async(handle);
+			tft_driver_refresh_poll(handle, &is_done);
+			draw_frame(handle, config.width, config.height, is_portrait);
+			tft_driver_refresh_wait(handle);
+			refresh(handle, true);
+		}
+		else if (tc->is_drawn_during_frame)
+		{
+			draw_frame(handle, config.width, config.height, is_portrait);
+			refresh(handle, false);
+		}
+		else
+		{
+			refresh(handle, is_async);
+		}
+
+		if (!is_async)
+		{
+			for (uint16_t row = 0; row < MOCK_PANEL_NUM_ROW; row++)
+			{
+				for (uint16_t col = 0; col < MOCK_PANEL_NUM_COL; col++)
+				{
+					expected[frame][row][col] = mock_panel_get_pixel(col, row);
+				}
+			}
+			continue;
+		}
+
+		uint32_t num_bad = 0;
+		for (uint16_t row = 0; row < MOCK_PANEL_NUM_ROW; row++)
+		{
+			for (uint16_t col = 0; col < MOCK_PANEL_NUM_COL; col++)
+			{
+				num_bad += mock_panel_get_pixel(col, row) != expected[frame][row][col];
+			}
+		}
+		if (num_bad > 0)
+		{
+			printf("%s: frame %u differs from synchronous refresh in %u pixels\n", tc->name, frame, num_bad);
+			num_bad_frame++;
+		}
+	}
+
+	if (is_async && (tc->num_worker > 0) && (worker_pool_get_num_run() == 0))
+	{
+		printf("%s: bands never prepared on workers\n", tc->name);
+		return 1;
+	}
+
+	if (is_portrait && is_async && (mock_panel_get_scroll_start() == 0))
+	{
+		printf("%s: screen never scrolled\n", tc->name);
+		return 1;
+	}
+
+#ifdef TFT_DRIVER_ENABLE_STATS
+	/* Display list bands count drawn pixels into their handle copies, totals
+	   match when the same frames are rendered */
+	tft_driver_stats_t stats;
+	tft_driver_get_stats(handle, &stats);
+	if (!is_async)
+	{
+		expected_stats = stats;
+	}
+	else if (!tc->is_drawn_during_frame)
+	{
+		for (uint8_t prim = 0; prim < TFT_DRIVER_PRIM_MAX; prim++)
+		{
+			if (stats.prim[prim].num_pixel != expected_stats.prim[prim].num_pixel)
+			{
+				printf("%s: primitive %u counted %llu pixels instead of %llu\n", tc->name, prim,
+				       (unsigned long long)stats.prim[prim].num_pixel,
+				       (unsigned long long)expected_stats.prim[prim].num_pixel);
+				return 1;
+			}
+		}
+	}
+#endif
+
+	return num_bad_frame;
+}
+
+int main(int argc, char **argv)
+{
+	/* Usage: test_async_refresh [parallel], cases with workers only */
+	bool is_parallel_only = (argc > 1) && (strcmp(argv[1], "parallel") == 0);
+	int num_fail = 0;
+
+	for (uint32_t i = 0; i < sizeof(test_case) / sizeof(test_case[0]); i++)
+	{
+		if (is_parallel_only && (test_case[i].num_worker == 0))
+		{
+			continue;
+		}
+		run_case(&test_case[i], false);
+		if ((test_case[i].num_worker > 0) && (worker_pool_start(test_case[i].num_worker) != ERR_CODE_SUCCESS))
+		{
+			printf("%s: workers not started\n", test_case[i].name);
+			return 1;
+		}
+		int err = run_case(&test_case[i], true);
+		if (test_case[i].num_worker > 0)
+		{
+			worker_pool_stop();
+		}
+		printf("%-36s %s\n", test_case[i].name, err ? "FAIL" : "ok");
+		num_fail += err != 0;
+	}
+
+	return num_fail ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "tft_driver.h"
+#include "mock_panel.h"
+#include "codec/rle565.h"
+
+#define TEST_NUM_ROUND 			200
+#define TEST_NUM_PRIM 			24
+#define TEST_DL_SIZE 			(64 * 1024)
+#define TEST_WIDTH 				320
+#define TEST_HEIGHT 			240
+#define TEST_IMAGE_WIDTH 		24
+#define TEST_IMAGE_HEIGHT 		16
+
+/**
+ * @struct  Driver setup the primitives are drawn in.
+ */
+typedef struct {
+	const char *name;
+	tft_driver_render_mode_t render_mode;
+	tft_driver_pixel_format_t pixel_format;
+} test_case_t;
+
+static const test_case_t test_case[] = {
+	{"fb565", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565},
+	{"fb888", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB888},
+	{"index4", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_INDEX4},
+	{"display list", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565},
+	{"immediate", TFT_DRIVER_RENDER_MODE_IMMEDIATE, TFT_DRIVER_PIXEL_FORMAT_RGB565},
+};
+
+static uint16_t image_565[TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT];
+static uint8_t image_mono[TEST_IMAGE_WIDTH / 8 * TEST_IMAGE_HEIGHT];
+static uint8_t image_rle[TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT * 2 + TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT / RLE565_MAX_RUN + 1];
+static uint32_t test_seed = 1;
+
+static uint32_t test_rand(void)
+{
+	test_seed ^= test_seed << 13;
+	test_seed ^= test_seed >> 17;
+	test_seed ^= test_seed << 5;
+
+	return test_seed;
+}
+
+static uint16_t rand_coord(uint16_t limit)
+{
+	/* On screen, around the edges, just below the wrap of uint16_t or anywhere */
+	switch (test_rand() % 4)
+	{
+	case 0:
+		return test_rand() % limit;
+	case 1:
+		return limit - 8 + test_rand() % 16;
+	case 2:
+		return 65535 - test_rand() % 64;
+	default:
+		return test_rand();
+	}
+}
+
+static uint16_t rand_size(void)
+{
+	switch (test_rand() % 4)
+	{
+	case 0:
+		return test_rand() % 16;
+	case 1:
+	case 2:
+		return test_rand() % 400;
+	default:
+		return test_rand();
+	}
+}
+
+static void make_images(void)
+{
+	for (uint32_t i = 0; i < TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT; i++)
+	{
+		image_565[i] = (i / 7) * 0x1234;
+	}
+	for (uint32_t i = 0; i < sizeof(image_mono); i++)
+	{
+		image_mono[i] = test_rand();
+	}
+	rle565_encode((const uint8_t *)image_565, TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT, image_rle);
+}
+
+static void draw_blit(tft_driver_handle_t handle, uint16_t x, uint16_t y, bool is_indexed)
+{
+	tft_driver_image_t image = {
+		.data = (const uint8_t *)image_565,
+		.width = TEST_IMAGE_WIDTH,
+		.height = TEST_IMAGE_HEIGHT,
+		.format = TFT_DRIVER_IMAGE_FORMAT_RGB565,
+		.color = test_rand() & 0x0F,
+		.bg_color = test_rand() & 0x0F,
+		.use_color_key = test_rand() & 1,
+		.color_key = image_565[0],
+	};
+
+	/* Indexed screen buffers only take mono images */
+	switch (is_indexed ? 0 : test_rand() % 3)
+	{
+	case 0:
+		image.data = image_mono;
+		image.format = TFT_DRIVER_IMAGE_FORMAT_MONO;
+		break;
+	case 1:
+		image.data = image_rle;
+		image.format = TFT_DRIVER_IMAGE_FORMAT_RLE565;
+		break;
+	default:
+		break;
+	}
+
+	tft_driver_blit(handle, x, y, &image);
+}
+
+static void draw_prim(tft_driver_handle_t handle, bool is_indexed)
+{
+	static uint8_t text[] = "clip";
+	uint16_t x1 = rand_coord(TEST_WIDTH);
+	uint16_t y1 = rand_coord(TEST_HEIGHT);
+	uint16_t x2 = rand_coord(TEST_WIDTH);
+	uint16_t y2 = rand_coord(TEST_HEIGHT);
+	uint16_t w = rand_size();
+	uint16_t h = rand_size();
+	uint32_t color = is_indexed ? test_rand() & 0x0F : test_rand() & 0xFFFFFF;
+	uint32_t argb = test_rand() | color;
+
+	switch (test_rand() % 15)
+	{
+	case 0:
+		tft_driver_write_pixel(handle, x1, y1, color);
+		break;
+	case 1:
+		tft_driver_write_line(handle, x1, y1, x2, y2, color);
+		break;
+	case 2:
+		tft_driver_write_rectangle(handle, x1, y1, w, h, color);
+		break;
+	case 3:
+		tft_driver_fill_rectangle(handle, x1, y1, w, h, color);
+		break;
+	case 4:
+		tft_driver_write_circle(handle, x1, y1, w, color);
+		break;
+	case 5:
+		tft_driver_fill_circle(handle, x1, y1, w, color);
+		break;
+	case 6:
+		tft_driver_write_ellipse(handle, x1, y1, w, h, color);
+		break;
+	case 7:
+		tft_driver_fill_ellipse(handle, x1, y1, w, h, color);
+		break;
+	case 8:
+		tft_driver_write_round_rectangle(handle, x1, y1, w, h, test_rand() % 64, color);
+		break;
+	case 9:
+		tft_driver_fill_round_rectangle(handle, x1, y1, w, h, test_rand() % 64, color);
+		break;
+	case 10:
+		tft_driver_blend_rectangle(handle, x1, y1, w, h, argb);
+		break;
+	case 11:
+		tft_driver_write_line_aa(handle, x1, y1, x2, y2, argb);
+		break;
+	case 12:
+		tft_driver_write_circle_aa(handle, x1, y1, w, argb);
+		break;
+	case 13:
+		tft_driver_set_position(handle, x1, y1);
+		tft_driver_write_string(handle, (test_rand() & 1) ? FONT_SIZE_16 : FONT_SIZE_8, text, color);
+		break;
+	default:
+		draw_blit(handle, x1, y1, is_indexed);
+		break;
+	}
+}
+
+static int run_case(const test_case_t *tc)
+{
+	bool is_indexed = tc->pixel_format == TFT_DRIVER_PIXEL_FORMAT_INDEX4;
+	tft_driver_cfg_t config = {
+		.height = TEST_HEIGHT,
+		.width = TEST_WIDTH,
+		.pixel_format = tc->pixel_format,
+		.render_mode = tc->render_mode,
+		.display_list_size = TEST_DL_SIZE,
+	};
+
+	tft_driver_handle_t handle = tft_driver_init();
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	mock_panel_reset(40000000);
+	if (tft_driver_config(handle, config) != ERR_CODE_SUCCESS)
+	{
+		printf("%s: config failed\n", tc->name);
+		return 1;
+	}
+
+	/* Background as the panel shows it */
+	uint32_t bg_color = is_indexed ? 5 : 0x336699;
+	tft_driver_fill(handle, bg_color);
+	tft_driver_screen_refresh(handle);
+	uint16_t bg = mock_panel_get_pixel(0, 0);
+
+	int num_bad_round = 0;
+	for (uint32_t round = 0; round < TEST_NUM_ROUND; round++)
+	{
+		tft_driver_fill(handle, bg_color);
+
+		/* Nested clips, the inner one may reach past the outer one and the screen */
+		int32_t x_start = test_rand() % TEST_WIDTH;
+		int32_t y_start = test_rand() % TEST_HEIGHT;
+		int32_t x_end = x_start + test_rand() % TEST_WIDTH;
+		int32_t y_end = y_start + test_rand() % TEST_HEIGHT;
+		tft_driver_push_clip(handle, x_start, y_start, x_end - x_start + 1, y_end - y_start + 1);
+
+		uint16_t x = test_rand() % TEST_WIDTH;
+		uint16_t y = test_rand() % TEST_HEIGHT;
+		uint16_t w = rand_size();
+		uint16_t h = rand_size();
+		bool is_nested = test_rand() & 1;
+		if (is_nested)
+		{
+			tft_driver_push_clip(handle, x, y, w, h);
+			if (x > x_start) x_start = x;
+			if (y > y_start) y_start = y;
+			if ((int32_t)x + w - 1 < x_end) x_end = x + w - 1;
+			if ((int32_t)y + h - 1 < y_end) y_end = y + h - 1;
+		}
+
+		for (uint32_t i = 0; i < TEST_NUM_PRIM; i++)
+		{
+			draw_prim(handle, is_indexed);
+		}
+
+		if (is_nested)
+		{
+			tft_driver_pop_clip(handle);
+		}
+		tft_driver_pop_clip(handle);
+		tft_driver_screen_refresh(handle);
+
+		/* Nothing outside the clip rectangle changed */
+		uint32_t num_bad = 0;
+		for (int32_t row = 0; row < TEST_HEIGHT; row++)
+		{
+			for (int32_t col = 0; col < TEST_WIDTH; col++)
+			{
+				bool is_inside = (col >= x_start) && (col <= x_end) && (row >= y_start) && (row <= y_end);
+				num_bad += !is_inside && (mock_panel_get_pixel(col, row) != bg);
+			}
+		}
+		if (num_bad > 0)
+		{
+			printf("%s: round %u drew %u pixels outside clip\n", tc->name, round, num_bad);
+			num_bad_round++;
+		}
+	}
+
+	return num_bad_round;
+}
+
+int main(void)
+{
+	int num_fail = 0;
+
+	make_images();
+	for (uint32_t i = 0; i < sizeof(test_case) / sizeof(test_case[0]); i++)
+	{
+		int err = run_case(&test_case[i]);
+		printf("%-16s %s\n", test_case[i].name, err ? "FAIL" : "ok");
+		num_fail += err != 0;
+	}
+
+	return num_fail ? 1 : 0;
+}
@@ -0,0 +1,310 @@
+#include "pthread.h"
+#include "sched.h"
+#include "stdatomic.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "tft_driver.h"
+#include "mock_panel.h"
+
+#define TEST_NUM_PRODUCER 		4
+#define TEST_NUM_OP 			600
+#define TEST_STRIP_WIDTH 		80 			/*!< Every producer draws in its own strip, order between them does not matter */
+#define TEST_WIDTH 				320
+#define TEST_HEIGHT 			240
+#define TEST_DL_SIZE 			(1024 * 1024)
+
+/**
+ * @struct  Driver setup the producers draw through.
+ */
+typedef struct {
+	const char *name;
+	tft_driver_render_mode_t render_mode;
+	tft_driver_pixel_format_t pixel_format;
+	uint16_t cmd_queue_size;
+	uint8_t skip_unchanged;
+	bool is_async;
+} test_case_t;
+
+/**
+ * @struct  Producer thread.
+ */
+typedef struct {
+	tft_driver_handle_t handle;
+	uint32_t id;
+	bool is_indexed;
+} producer_t;
+
+static const test_case_t test_case[] = {
+	{"fb565", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 64, 0, false},
+	{"fb565 async", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 64, 0, true},
+	{"fb565 async small queue", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 16, 0, true},
+	{"fb565 async skip unchanged", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 64, 1, true},
+	{"fb888 async", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB888, 64, 0, true},
+	{"index8 async", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_INDEX8, 64, 0, true},
+	{"display list", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, 64, 0, false},
+	{"display list async", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, 256, 0, true},
+	{"immediate", TFT_DRIVER_RENDER_MODE_IMMEDIATE, TFT_DRIVER_PIXEL_FORMAT_RGB565, 64, 0, false},
+};
+
+static uint16_t expected[MOCK_PANEL_NUM_ROW][MOCK_PANEL_NUM_COL];
+static uint16_t image[16 * 16];
+static atomic_uint num_done;
+static atomic_uint num_failed;
+
+static err_code_t draw_op(tft_driver_handle_t handle, uint32_t id, unsigned int *seed, bool is_indexed)
+{
+	static uint8_t text[] = "queue";
+	tft_driver_image_t im = {
+		.data = (const uint8_t *)image,
+		.width = 16,
+		.height = 16,
+		.format = TFT_DRIVER_IMAGE_FORMAT_RGB565,
+	};
+	uint16_t x = id * TEST_STRIP_WIDTH - 10 + rand_r(seed) % (TEST_STRIP_WIDTH + 20);
+	uint16_t y = rand_r(seed) % TEST_HEIGHT;
+	uint16_t w = rand_r(seed) % 50;
+	uint16_t h = rand_r(seed) % 50;
+	uint32_t color = is_indexed ? rand_r(seed) & 0xFF : rand_r(seed) & 0xFFFFFF;
+
+	switch (rand_r(seed) % 5)
+	{
+	case 0:
+		return tft_driver_fill_rectangle(handle, x, y, w, h, color);
+	case 1:
+		return tft_driver_fill_circle(handle, x, y, w / 3, color);
+	case 2:
+		return tft_driver_write_line(handle, x, y, x + w, y + h, color);
+	case 3:
+		tft_driver_set_position(handle, x, y);
+		return tft_driver_write_string(handle, FONT_SIZE_8, text, color);
+	default:
+		/* Indexed screen buffers take mono images only */
+		return is_indexed ? ERR_CODE_SUCCESS : tft_driver_blit(handle, x, y, &im);
+	}
+}
+
+static void draw_strip(tft_driver_handle_t handle, uint32_t id, bool is_indexed, bool is_queued)
+{
+	unsigned int seed = id * 1000 + 7;
+
+	tft_driver_push_clip(handle, id * TEST_STRIP_WIDTH, 0, TEST_STRIP_WIDTH, TEST_HEIGHT);
+	for (uint32_t i = 0; i < TEST_NUM_OP; i++)
+	{
+		unsigned int op_seed = seed;
+		while (draw_op(handle, id, &op_seed, is_indexed) != ERR_CODE_SUCCESS)
+		{
+			/* Queue is full, same command again once the consumer drained it */
+			atomic_fetch_add(&num_failed, 1);
+			if (!is_queued)
+			{
+				break;
+			}
+			op_seed = seed;
+			sched_yield();
+		}
+		seed = op_seed;
+	}
+	tft_driver_pop_clip(handle);
+}
+
+static void *producer_task(void *arg)
+{
+	producer_t *producer = arg;
+
+	draw_strip(producer->handle, producer->id, producer->is_indexed, true);
+	atomic_fetch_add(&num_done, 1);
+
+	return NULL;
+}
+
+static tft_driver_handle_t create_driver(const test_case_t *tc, uint16_t cmd_queue_size)
+{
+	tft_driver_cfg_t config = {
+		.height = TEST_HEIGHT,
+		.width = TEST_WIDTH,
+		.pixel_format = tc->pixel_format,
+		.render_mode = tc->render_mode,
+		.display_list_size = TEST_DL_SIZE,
+		.skip_unchanged = tc->skip_unchanged,
+		.cmd_queue_size = cmd_queue_size,
+	};
+
+	tft_driver_handle_t handle = tft_driver_init();
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	if (tc->is_async)
+	{
+		tft_driver_set_func_async(handle, mock_panel_queue_trans, mock_panel_wait_trans);
+	}
+	mock_panel_reset(40000000);
+	if (tft_driver_config(handle, config) != ERR_CODE_SUCCESS)
+	{
+		return NULL;
+	}
+
+	return handle;
+}
+
+static int run_case(const test_case_t *tc)
+{
+	bool is_indexed = tc->pixel_format == TFT_DRIVER_PIXEL_FORMAT_INDEX8;
+
+	/* Same strips drawn one after another without the queue */
+	tft_driver_handle_t ref = create_driver(tc, 0);
+	if (ref == NULL)
+	{
+		printf("%s: config failed\n", tc->name);
+		return 1;
+	}
+	for (uint32_t id = 0; id < TEST_NUM_PRODUCER; id++)
+	{
+		draw_strip(ref, id, is_indexed, false);
+	}
+	tft_driver_screen_refresh(ref);
+	for (uint16_t row = 0; row < MOCK_PANEL_NUM_ROW; row++)
+	{
+		for (uint16_t col = 0; col < MOCK_PANEL_NUM_COL; col++)
+		{
+			expected[row][col] = mock_panel_get_pixel(col, row);
+		}
+	}
+
+	tft_driver_handle_t handle = create_driver(tc, tc->cmd_queue_size);
+	if (handle == NULL)
+	{
+		printf("%s: config failed\n", tc->name);
+		return 1;
+	}
+
+	pthread_t thread[TEST_NUM_PRODUCER];
+	producer_t producer[TEST_NUM_PRODUCER];
+	atomic_store(&num_done, 0);
+	atomic_store(&num_failed, 0);
+	for (uint32_t id = 0; id < TEST_NUM_PRODUCER; id++)
+	{
+		producer[id].handle = tft_driver_create_producer(handle);
+		producer[id].id = id;
+		producer[id].is_indexed = is_indexed;
+		pthread_create(&thread[id], NULL, producer_task, &producer[id]);
+	}
+
+	/* Consumer refreshes until every producer is done, asynchronous refresh drains the queue itself */
+	while (atomic_load(&num_done) < TEST_NUM_PRODUCER)
+	{
+		if (tc->is_async)
+		{
+			uint8_t is_done = false;
+			tft_driver_screen_refresh_async(handle);
+			while (!is_done)
+			{
+				tft_driver_refresh_poll(handle, &is_done);
+			}
+		}
+		else
+		{
+			tft_driver_queue_drain(handle, (rand() % 8 == 0) ? 0 : 64);
+			tft_driver_screen_refresh(handle);
+		}
+		sched_yield();
+	}
+	for (uint32_t id = 0; id < TEST_NUM_PRODUCER; id++)
+	{
+		pthread_join(thread[id], NULL);
+	}
+	tft_driver_queue_drain(handle, 0);
+	tft_driver_screen_refresh(handle);
+
+	uint32_t num_bad = 0;
+	for (uint16_t row = 0; row < MOCK_PANEL_NUM_ROW; row++)
+	{
+		for (uint16_t col = 0; col < MOCK_PANEL_NUM_COL; col++)
+		{
+			num_bad += mock_panel_get_pixel(col, row) != expected[row][col];
+		}
+	}
+
+	/* Every failed call was a dropped command */
+	uint32_t depth;
+	uint32_t max_depth;
+	uint32_t dropped;
+	tft_driver_get_queue_stats(handle, &depth, &max_depth, &dropped);
+	if ((num_bad > 0) || (depth != 0) || (dropped != atomic_load(&num_failed)))
+	{
+		printf("%s: %u pixels differ, depth %u, %u dropped of %u failed\n",
+		       tc->name, num_bad, depth, dropped, atomic_load(&num_failed));
+		return 1;
+	}
+
+	return 0;
+}
+
+static int run_drain_during_frame(void)
+{
+	test_case_t tc = {"drain during frame", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 16, 1, true};
+	tft_driver_handle_t handle = create_driver(&tc, tc.cmd_queue_size);
+	if (handle == NULL)
+	{
+		printf("%s: config failed\n", tc.name);
+		return 1;
+	}
+	tft_driver_handle_t producer = tft_driver_create_producer(handle);
+
+	tft_driver_fill_rectangle(handle, 0, 0, TEST_WIDTH, TEST_HEIGHT, 0xFF0000);
+	tft_driver_screen_refresh(handle);
+	uint16_t red = mock_panel_get_pixel(0, 0);
+
+	/* Green is drained by the frame hashed as red while its rows are on the
+	   bus. Red again matches that hash, yet the panel may show green */
+	int num_fail = 0;
+	for (uint32_t frame = 0; frame < 10; frame++)
+	{
+		tft_driver_fill_rectangle(handle, 0, 0, TEST_WIDTH, TEST_HEIGHT, 0x0000FF);
+		tft_driver_screen_refresh(handle);
+		tft_driver_fill_rectangle(producer, 0, 0, TEST_WIDTH, TEST_HEIGHT, 0x00FF00);
+		tft_driver_fill_rectangle(handle, 0, 0, TEST_WIDTH, TEST_HEIGHT, 0xFF0000);
+		tft_driver_screen_refresh_async(handle);
+		tft_driver_refresh_wait(handle);
+		tft_driver_fill_rectangle(handle, 0, 0, TEST_WIDTH, TEST_HEIGHT, 0xFF0000);
+		tft_driver_screen_refresh(handle);
+
+		uint32_t num_bad = 0;
+		for (uint16_t row = 0; row < TEST_HEIGHT; row++)
+		{
+			for (uint16_t col = 0; col < TEST_WIDTH; col++)
+			{
+				num_bad += mock_panel_get_pixel(col, row) != red;
+			}
+		}
+		if (num_bad > 0)
+		{
+			printf("%s: frame %u has %u stale pixels\n", tc.name, frame, num_bad);
+			num_fail++;
+		}
+	}
+
+	return num_fail;
+}
+
+int main(void)
+{
+	int num_fail = 0;
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		image[i] = i * 257;
+	}
+
+	for (uint32_t i = 0; i < sizeof(test_case) / sizeof(test_case[0]); i++)
+	{
+		int err = run_case(&test_case[i]);
+		printf("%-32s %s\n", test_case[i].name, err ? "FAIL" : "ok");
+		num_fail += err != 0;
+	}
+
+	int err = run_drain_during_frame();
+	printf("%-32s %s\n", "drain during frame", err ? "FAIL" : "ok");
+	num_fail += err != 0;
+
+	return num_fail ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "color/color_convert.h"
+
+#define TEST_NUM_COLOR_STEP 	65536 		/*!< Colors converted per call when going through all of them */
+#define TEST_MAX_LEN 			100 		/*!< Lengths checked for kernel tails */
+#define TEST_GUARD 				0xA5A5
+
+/* Conversion the driver did pixel by pixel before the kernels */
+static uint16_t old_convert(const uint8_t *p_src)
+{
+	uint16_t color_565 = (((uint16_t)p_src[0] & 0x00F8) << 8) |
+	                     (((uint16_t)p_src[1] & 0x00FC) << 3) |
+	                     ((uint16_t)p_src[2] >> 3);
+	uint16_t swap565 = ((color_565 << 8) & 0xFF00) | ((color_565 >> 8) & 0x00FF);
+
+	return swap565;
+}
+
+static int test_all_colors(void)
+{
+	static uint8_t src[TEST_NUM_COLOR_STEP * 3];
+	static uint16_t dst[TEST_NUM_COLOR_STEP];
+	static uint16_t ref[TEST_NUM_COLOR_STEP];
+	uint32_t num_bad = 0;
+
+	/* Every RGB888 color, in steps of one red value */
+	for (uint32_t r = 0; r < 256; r++)
+	{
+		for (uint32_t i = 0; i < TEST_NUM_COLOR_STEP; i++)
+		{
+			src[i * 3 + 0] = r;
+			src[i * 3 + 1] = i >> 8;
+			src[i * 3 + 2] = i & 0xFF;
+		}
+
+		color_convert_rgb888_to_rgb565(src, dst, TEST_NUM_COLOR_STEP);
+		color_convert_rgb888_to_rgb565_ref(src, ref, TEST_NUM_COLOR_STEP);
+		for (uint32_t i = 0; i < TEST_NUM_COLOR_STEP; i++)
+		{
+			uint16_t expected = old_convert(&src[i * 3]);
+			num_bad += (dst[i] != expected) || (ref[i] != expected);
+		}
+	}
+
+	printf("all colors: %u mismatches\n", num_bad);
+
+	return num_bad != 0;
+}
+
+static int test_tails(void)
+{
+	static uint8_t src[(TEST_MAX_LEN + 4) * 3];
+	static uint16_t dst[TEST_MAX_LEN + 4];
+	uint32_t num_bad = 0;
+
+	for (uint32_t i = 0; i < sizeof(src); i++)
+	{
+		src[i] = rand();
+	}
+
+	/* Every length at every source alignment, nothing written past the end */
+	for (uint32_t src_offset = 0; src_offset < 4; src_offset++)
+	{
+		for (uint32_t dst_offset = 0; dst_offset < 2; dst_offset++)
+		{
+			for (uint32_t len = 0; len <= TEST_MAX_LEN; len++)
+			{
+				for (uint32_t i = 0; i < TEST_MAX_LEN + 4; i++)
+				{
+					dst[i] = TEST_GUARD;
+				}
+
+				color_convert_rgb888_to_rgb565(src + src_offset, dst + dst_offset, len);
+				for (uint32_t i = 0; i < TEST_MAX_LEN + 4; i++)
+				{
+					uint16_t expected = TEST_GUARD;
+					if ((i >= dst_offset) && (i < dst_offset + len))
+					{
+						expected = old_convert(src + src_offset + (i - dst_offset) * 3);
+					}
+					num_bad += dst[i] != expected;
+				}
+			}
+		}
+	}
+
+	printf("lengths and alignments: %u mismatches\n", num_bad);
+
+	return num_bad != 0;
+}
+
+int main(void)
+{
+	int num_fail = 0;
+
+	num_fail += test_all_colors();
+	num_fail += test_tails();
+
+	return num_fail ? 1 : 0;
+}
@@ -0,0 +1,322 @@
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "tft_driver.h"
+#include "console/tft_console.h"
+#include "mock_panel.h"
+
+#define TEST_WIDTH 				240
+#define TEST_HEIGHT 			320
+#define TEST_NUM_COL 			40 		/*!< Console covers the screen in 6 x 8 cells */
+#define TEST_NUM_ROW 			40
+#define TEST_NUM_LINE 			160
+#define TEST_CHECK_LINE 		40 		/*!< Log lines between panel checks */
+#define TEST_DL_SIZE 			(256 * 1024) 	/*!< Record of every cell on screen, earlier ones below are dropped */
+#define TEST_LOG_SIZE 			(64 * 1024)
+
+/**
+ * @struct  Driver and console setup the log is streamed with.
+ */
+typedef struct {
+	const char *name;
+	tft_driver_render_mode_t render_mode;
+	uint8_t use_hw_scroll;
+} test_case_t;
+
+/**
+ * @struct  Escape sequence and the one it must act the same as.
+ */
+typedef struct {
+	const char *name;
+	const char *seq;
+	const char *ref;
+} test_esc_t;
+
+static const test_case_t test_case[] = {
+	{"framebuffer", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, 0},
+	{"framebuffer hw scroll", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, 1},
+	{"display list", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, 0},
+	{"display list hw scroll", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, 1},
+	{"immediate", TFT_DRIVER_RENDER_MODE_IMMEDIATE, 0},
+	{"immediate hw scroll", TFT_DRIVER_RENDER_MODE_IMMEDIATE, 1},
+};
+
+#define TEST_SEP_16 			";;;;;;;;;;;;;;;;"
+#define TEST_SEP_256 			TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 \
+								TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 TEST_SEP_16 \
+								TEST_SEP_16 TEST_SEP_16
+
+/* Parameters past ESC_MAX_PARAM and values past ESC_MAX_VALUE are dropped */
+static const test_esc_t test_esc[] = {
+	{"params kept", "\x1b[1;2;3;32m", "\x1b[32m"},
+	{"params past the last kept", "\x1b[1;2;3;4;32m", ""},
+	{"many empty params", "\x1b[;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;32m", "\x1b[0m"},
+	{"param count past 8 bits", "\x1b[" TEST_SEP_256 "32m", "\x1b[0m"},
+	{"many params", "\x1b[31;32;33;34;35;36;37;41;42;43;44;45;46;47;91;92;93;94;95;96;97m", "\x1b[34m"},
+	{"leading zeros", "\x1b[00000000000000033m", "\x1b[33m"},
+	{"value overflow", "\x1b[99999999999999999999m", ""},
+	{"value overflow then color", "\x1b[65567;35m", "\x1b[35m"},
+	{"move past the end", "\x1b[999;999H", "\x1b[40;40H"},
+	{"move overflow", "\x1b[99999999999A\x1b[99999999999D", "\x1b[H"},
+	{"unknown final", "\x1b[5;5z", ""},
+	{"other escape", "\x1b(B", "B"},
+};
+
+static const char *test_word[] = {
+	"boot", "sensor", "ok", "retry", "timeout", "spi", "dma", "queue", "frame", "0x3FF8",
+};
+
+static char log_text[TEST_LOG_SIZE];
+static uint32_t log_line_end[TEST_NUM_LINE];
+static uint16_t reference[TEST_NUM_LINE / TEST_CHECK_LINE][TEST_HEIGHT][TEST_WIDTH];
+static uint32_t test_seed;
+
+static uint32_t test_rand(void)
+{
+	test_seed ^= test_seed << 13;
+	test_seed ^= test_seed >> 17;
+	test_seed ^= test_seed << 5;
+
+	return test_seed;
+}
+
+static void make_log(void)
+{
+	/* Colored prefixes, tabs, lines longer than the console and blank ones */
+	uint32_t len = 0;
+	test_seed = 2024;
+	for (uint32_t line = 0; line < TEST_NUM_LINE; line++)
+	{
+		len += sprintf(log_text + len, "\x1b[%um%05u\x1b[0m\t", 90 + test_rand() % 8, line);
+		uint32_t num_word = test_rand() % 16;
+		for (uint32_t word = 0; word < num_word; word++)
+		{
+			switch (test_rand() % 6)
+			{
+			case 0:
+				len += sprintf(log_text + len, "\x1b[%u;%um", 30 + test_rand() % 8, 40 + test_rand() % 8);
+				break;
+			case 1:
+				len += sprintf(log_text + len, "\x1b[39;49m\t");
+				break;
+			case 2:
+				len += sprintf(log_text + len, "\x1b[%um", 100 + test_rand() % 8);
+				break;
+			default:
+				break;
+			}
+			len += sprintf(log_text + len, "%s ", test_word[test_rand() % (sizeof(test_word) / sizeof(test_word[0]))]);
+		}
+		if (test_rand() % 8 == 0)
+		{
+			len += sprintf(log_text + len, "\x1b[K");
+		}
+		len += sprintf(log_text + len, "\x1b[m\r\n");
+		log_line_end[line] = len;
+	}
+}
+
+static tft_driver_handle_t create_driver(tft_driver_render_mode_t render_mode)
+{
+	tft_driver_cfg_t config = {
+		.height = TEST_HEIGHT,
+		.width = TEST_WIDTH,
+		.pixel_format = TFT_DRIVER_PIXEL_FORMAT_RGB565,
+		.render_mode = render_mode,
+		.display_list_size = TEST_DL_SIZE,
+		.rotation = TFT_DRIVER_ROTATION_PORTRAIT,
+	};
+
+	tft_driver_handle_t handle = tft_driver_init();
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	mock_panel_reset(40000000);
+	if (tft_driver_config(handle, config) != ERR_CODE_SUCCESS)
+	{
+		return NULL;
+	}
+
+	return handle;
+}
+
+static tft_console_handle_t create_console(tft_driver_handle_t driver, uint8_t use_hw_scroll)
+{
+	tft_console_cfg_t config = {
+		.driver = driver,
+		.font_size = FONT_SIZE_8,
+		.num_col = TEST_NUM_COL,
+		.num_row = TEST_NUM_ROW,
+		.fg_color = 7,
+		.bg_color = 0,
+		.use_hw_scroll = use_hw_scroll,
+	};
+
+	tft_console_handle_t handle = tft_console_init();
+	if ((handle == NULL) || (tft_console_config(handle, config) != ERR_CODE_SUCCESS))
+	{
+		return NULL;
+	}
+
+	return handle;
+}
+
+static uint16_t screen_pixel(uint16_t x, uint16_t y)
+{
+	/* Panel shows memory rows from the scroll start on */
+	return mock_panel_get_pixel(x, (y + mock_panel_get_scroll_start()) % TEST_HEIGHT);
+}
+
+static int make_reference(const char *text, uint32_t len, uint16_t (*ref)[TEST_WIDTH])
+{
+	/* Text written at once and drawn from blank cells */
+	tft_driver_handle_t driver = create_driver(TFT_DRIVER_RENDER_MODE_FRAMEBUFFER);
+	tft_console_handle_t console = (driver != NULL) ? create_console(driver, 0) : NULL;
+	if ((console == NULL) || (tft_console_write(console, (const uint8_t *)text, len) != ERR_CODE_SUCCESS) ||
+	    (tft_console_refresh(console) != ERR_CODE_SUCCESS))
+	{
+		return 1;
+	}
+
+	for (uint16_t y = 0; y < TEST_HEIGHT; y++)
+	{
+		for (uint16_t x = 0; x < TEST_WIDTH; x++)
+		{
+			ref[y][x] = screen_pixel(x, y);
+		}
+	}
+
+	return 0;
+}
+
+static uint32_t count_diff(uint16_t (*ref)[TEST_WIDTH])
+{
+	uint32_t num_diff = 0;
+
+	for (uint16_t y = 0; y < TEST_HEIGHT; y++)
+	{
+		for (uint16_t x = 0; x < TEST_WIDTH; x++)
+		{
+			num_diff += screen_pixel(x, y) != ref[y][x];
+		}
+	}
+
+	return num_diff;
+}
+
+static int run_case(const test_case_t *tc, uint64_t *num_byte)
+{
+	tft_driver_handle_t driver = create_driver(tc->render_mode);
+	tft_console_handle_t console = (driver != NULL) ? create_console(driver, tc->use_hw_scroll) : NULL;
+	if (console == NULL)
+	{
+		printf("%s: config failed\n", tc->name);
+		return 1;
+	}
+
+	/* Log streamed a line at a time, checked against the same text drawn at once */
+	int num_fail = 0;
+	uint32_t start = 0;
+	for (uint32_t line = 0; line < TEST_NUM_LINE; line++)
+	{
+		tft_console_write(console, (const uint8_t *)log_text + start, log_line_end[line] - start);
+		if (tft_console_refresh(console) != ERR_CODE_SUCCESS)
+		{
+			printf("%s: line %u not drawn\n", tc->name, line);
+			return 1;
+		}
+		start = log_line_end[line];
+
+		if ((line + 1) % TEST_CHECK_LINE != 0)
+		{
+			continue;
+		}
+		uint32_t num_diff = count_diff(reference[line / TEST_CHECK_LINE]);
+		if (num_diff > 0)
+		{
+			printf("%s: %u lines, %u pixels differ\n", tc->name, line + 1, num_diff);
+			num_fail++;
+		}
+	}
+
+	mock_panel_stats_t stats;
+	mock_panel_get_stats(&stats);
+	*num_byte = stats.num_byte;
+
+	return num_fail;
+}
+
+static int run_esc(const test_esc_t *te)
+{
+	/* Colored text around the sequence shows where the cursor went and which colors it set */
+	char text[512];
+	uint32_t len = sprintf(text, "\x1b[2J\x1b[5;3H\x1b[36;44mab\x1b[37;40m\tcd%sXY\x1b[41mZ\r\nend", te->ref);
+	if (make_reference(text, len, reference[0]) != 0)
+	{
+		return 1;
+	}
+
+	len = sprintf(text, "\x1b[2J\x1b[5;3H\x1b[36;44mab\x1b[37;40m\tcd%sXY\x1b[41mZ\r\nend", te->seq);
+	tft_driver_handle_t driver = create_driver(TFT_DRIVER_RENDER_MODE_FRAMEBUFFER);
+	tft_console_handle_t console = (driver != NULL) ? create_console(driver, 0) : NULL;
+	if ((console == NULL) || (tft_console_write(console, (const uint8_t *)text, len) != ERR_CODE_SUCCESS) ||
+	    (tft_console_refresh(console) != ERR_CODE_SUCCESS))
+	{
+		return 1;
+	}
+
+	uint32_t num_diff = count_diff(reference[0]);
+	if (num_diff > 0)
+	{
+		printf("%s: %u pixels differ\n", te->name, num_diff);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	/* Usage: test_console [esc], escape sequences only */
+	bool is_esc_only = (argc > 1) && (strcmp(argv[1], "esc") == 0);
+	int num_fail = 0;
+
+	for (uint32_t i = 0; i < sizeof(test_esc) / sizeof(test_esc[0]); i++)
+	{
+		int err = run_esc(&test_esc[i]);
+		printf("%-36s %s\n", test_esc[i].name, err ? "FAIL" : "ok");
+		num_fail += err != 0;
+	}
+	if (is_esc_only)
+	{
+		return num_fail ? 1 : 0;
+	}
+
+	/* Panel is shared, every reference is drawn before the log is streamed */
+	make_log();
+	for (uint32_t check = 0; check < TEST_NUM_LINE / TEST_CHECK_LINE; check++)
+	{
+		if (make_reference(log_text, log_line_end[(check + 1) * TEST_CHECK_LINE - 1], reference[check]) != 0)
+		{
+			printf("reference not drawn\n");
+			return 1;
+		}
+	}
+
+	uint64_t num_byte[sizeof(test_case) / sizeof(test_case[0])];
+	for (uint32_t i = 0; i < sizeof(test_case) / sizeof(test_case[0]); i++)
+	{
+		int err = run_case(&test_case[i], &num_byte[i]);
+		printf("%-36s %s, %llu bytes sent\n", test_case[i].name, err ? "FAIL" : "ok", (unsigned long long)num_byte[i]);
+		num_fail += err != 0;
+	}
+
+	/* Panel scrolls what was drawn, only lines scrolled in are sent */
+	if (num_byte[1] >= num_byte[0] / 2)
+	{
+		printf("hardware scroll sent %llu bytes, redrawing %llu\n",
+		       (unsigned long long)num_byte[1], (unsigned long long)num_byte[0]);
+		num_fail++;
+	}
+
+	return num_fail ? 1 : 0;
+}
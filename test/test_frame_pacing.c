@@ -0,0 +1,305 @@
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "tft_driver.h"
+#include "mock_panel.h"
+
+#define TEST_WIDTH 				320
+#define TEST_HEIGHT 			240
+#define TEST_NUM_FRAME 			40
+#define TEST_POLL_US 			1000 		/*!< Main loop polls this often while idle */
+#define TEST_DRAIN_US 			200000 		/*!< Longer than a frame at the lowest rate */
+
+/**
+ * @struct  Main loop of a polled run, drawing does not poll.
+ */
+typedef struct {
+	const char *name;
+	uint8_t frame_rate;
+	uint32_t draw_us; 				/*!< Time drawing a frame takes */
+	uint32_t idle_us; 				/*!< Time polled before the next frame is drawn */
+	bool is_async;
+	bool is_rate_bound; 			/*!< Frames come faster than the rate, presented frames follow it */
+	bool is_dropping; 				/*!< Edges mostly come while drawing, frames may be merged */
+} test_case_t;
+
+static const test_case_t test_case[] = {
+	{"30 fps slow drawing", 30, 5000, 40000, false, false, false},
+	{"30 fps slow drawing async", 30, 5000, 40000, true, false, false},
+	{"30 fps fast drawing", 30, 3000, 2000, false, true, true},
+	{"20 fps fast drawing async", 20, 4000, 1000, true, true, true},
+	{"60 fps drawing past edges", 60, 20000, 1000, false, false, true},
+	{"60 fps drawing past edges async", 60, 20000, 1000, true, false, true},
+	{"10 fps drawing past edges", 10, 45000, 3000, false, false, true},
+};
+
+static const uint8_t test_rate[] = {60, 45, 30, 25, 20, 15, 12, 10, 7, 5, 2, 1};
+static const uint32_t test_color[2] = {0xFF0000, 0x0000FF};
+static uint16_t panel_color[2];
+
+static tft_driver_handle_t create_driver(bool is_async)
+{
+	tft_driver_cfg_t config = {
+		.height = TEST_HEIGHT,
+		.width = TEST_WIDTH,
+		.pixel_format = TFT_DRIVER_PIXEL_FORMAT_RGB565,
+		.render_mode = TFT_DRIVER_RENDER_MODE_FRAMEBUFFER,
+	};
+
+	tft_driver_handle_t handle = tft_driver_init();
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	if (is_async)
+	{
+		tft_driver_set_func_async(handle, mock_panel_queue_trans, mock_panel_wait_trans);
+	}
+	tft_driver_set_func_tear(handle, mock_panel_wait_te);
+	mock_panel_reset(40000000);
+	if (tft_driver_config(handle, config) != ERR_CODE_SUCCESS)
+	{
+		return NULL;
+	}
+
+	/* Colors as the panel shows them, not paced yet so frames go out right away */
+	for (uint8_t i = 0; i < 2; i++)
+	{
+		tft_driver_fill(handle, test_color[i]);
+		tft_driver_frame_submit(handle, true);
+		tft_driver_refresh_wait(handle);
+		panel_color[i] = mock_panel_get_pixel(0, 0);
+	}
+
+	return handle;
+}
+
+static uint32_t get_presented(tft_driver_handle_t handle, uint32_t *dropped)
+{
+	uint8_t frame_rate;
+	uint32_t presented;
+	uint32_t num_dropped;
+
+	tft_driver_get_frame_stats(handle, &frame_rate, &presented, &num_dropped);
+	if (dropped != NULL)
+	{
+		*dropped = num_dropped;
+	}
+
+	return presented;
+}
+
+static uint32_t check_stale(tft_driver_handle_t handle, uint32_t *presented)
+{
+	/* Frame started by the last call, simulated time does not move while it runs */
+	uint32_t now_presented = get_presented(handle, NULL);
+	bool is_started = now_presented != *presented;
+	*presented = now_presented;
+
+	return is_started && (mock_panel_get_time_ns() - mock_panel_get_last_te_ns() >= (uint64_t)TEST_POLL_US * 1000);
+}
+
+static int run_divider(void)
+{
+	tft_driver_handle_t handle = create_driver(false);
+	if (handle == NULL)
+	{
+		printf("divider: config failed\n");
+		return 1;
+	}
+
+	int num_fail = 0;
+	for (uint32_t i = 0; i < sizeof(test_rate); i++)
+	{
+		uint8_t rate = test_rate[i];
+		if (tft_driver_set_frame_rate(handle, rate) != ERR_CODE_SUCCESS)
+		{
+			printf("%u fps: not set\n", rate);
+			num_fail++;
+			continue;
+		}
+
+		/* Nothing drawn between frames, every one waits for all edges of its period */
+		mock_panel_stats_t stats;
+		mock_panel_get_stats(&stats);
+		uint32_t num_edge = stats.num_te_edge;
+		for (uint32_t frame = 0; frame < 4; frame++)
+		{
+			tft_driver_fill(handle, test_color[frame & 1]);
+			tft_driver_frame_submit(handle, true);
+			if (mock_panel_get_time_ns() != mock_panel_get_last_te_ns())
+			{
+				printf("%u fps: frame %u started after its edge\n", rate, frame);
+				num_fail++;
+			}
+		}
+		mock_panel_get_stats(&stats);
+		uint32_t divider = (stats.num_te_edge - num_edge) / 4;
+
+		/* Rate in use is the scan rate divided, near the requested one, and
+		   the panel scans fast enough not to flicker */
+		uint8_t frame_rate;
+		uint32_t presented;
+		uint32_t dropped;
+		tft_driver_get_frame_stats(handle, &frame_rate, &presented, &dropped);
+		uint32_t scan_rate = mock_panel_get_scan_rate();
+		int32_t rate_diff = (int32_t)frame_rate * divider - scan_rate;
+		int32_t request_diff = (int32_t)frame_rate - rate;
+		if ((divider == 0) || (rate_diff < -(int32_t)divider) || (rate_diff > (int32_t)divider) ||
+		    (abs(request_diff) > ((rate >= 10) ? rate / 10 : 1)) || (scan_rate < 45))
+		{
+			printf("%u fps: %u fps in use, panel scans at %u fps, %u edges per frame\n",
+			       rate, frame_rate, scan_rate, divider);
+			num_fail++;
+		}
+	}
+
+	/* Pacing off, frames go out without waiting for an edge */
+	tft_driver_set_frame_rate(handle, 0);
+	uint64_t time_ns = mock_panel_get_time_ns();
+	uint32_t presented = get_presented(handle, NULL);
+	tft_driver_frame_submit(handle, true);
+	if ((mock_panel_get_time_ns() != time_ns) || (get_presented(handle, NULL) != presented + 1))
+	{
+		printf("unpaced frame waited for an edge\n");
+		num_fail++;
+	}
+
+	return num_fail;
+}
+
+static int run_blocking(bool is_async)
+{
+	tft_driver_handle_t handle = create_driver(is_async);
+	if ((handle == NULL) || (tft_driver_set_frame_rate(handle, 30) != ERR_CODE_SUCCESS))
+	{
+		printf("blocking: config failed\n");
+		return 1;
+	}
+
+	/* Drawing takes up to two frames, edges meanwhile count toward the rate only */
+	int num_fail = 0;
+	for (uint32_t frame = 0; frame < TEST_NUM_FRAME; frame++)
+	{
+		tft_driver_fill(handle, test_color[frame & 1]);
+		mock_panel_advance_time((frame % 7) * 10000);
+		tft_driver_frame_submit(handle, true);
+		if (mock_panel_get_time_ns() != mock_panel_get_last_te_ns())
+		{
+			printf("blocking: frame %u started on an old edge\n", frame);
+			num_fail++;
+		}
+
+		tft_driver_refresh_wait(handle);
+		if (mock_panel_get_pixel(0, 0) != panel_color[frame & 1])
+		{
+			printf("blocking: frame %u not shown\n", frame);
+			num_fail++;
+		}
+	}
+
+	uint32_t dropped;
+	uint32_t presented = get_presented(handle, &dropped) - 2;
+	if ((presented != TEST_NUM_FRAME) || (dropped != 0))
+	{
+		printf("blocking: %u presented, %u dropped\n", presented, dropped);
+		num_fail++;
+	}
+
+	return num_fail;
+}
+
+static int run_polled(const test_case_t *tc)
+{
+	tft_driver_handle_t handle = create_driver(tc->is_async);
+	if ((handle == NULL) || (tft_driver_set_frame_rate(handle, tc->frame_rate) != ERR_CODE_SUCCESS))
+	{
+		printf("%s: config failed\n", tc->name);
+		return 1;
+	}
+
+	/* Frame may only start on an edge which came since the previous poll,
+	   an older one may be in the middle of the scan */
+	int num_fail = 0;
+	uint32_t base = get_presented(handle, NULL);
+	uint32_t presented = base;
+	uint64_t start_ns = mock_panel_get_time_ns();
+	uint32_t num_submit = 0;
+	uint32_t num_stale = 0;
+	for (uint32_t frame = 0; frame <= TEST_NUM_FRAME; frame++)
+	{
+		/* Last frame goes out on a coming edge */
+		uint32_t idle_us = tc->idle_us;
+		if (frame < TEST_NUM_FRAME)
+		{
+			tft_driver_fill(handle, test_color[frame & 1]);
+			mock_panel_advance_time(tc->draw_us);
+			tft_driver_frame_submit(handle, false);
+			num_submit++;
+			num_stale += check_stale(handle, &presented);
+		}
+		else
+		{
+			idle_us = TEST_DRAIN_US;
+		}
+
+		for (uint32_t idle = 0; idle < idle_us; idle += TEST_POLL_US)
+		{
+			/* Bus is done within a poll interval */
+			uint8_t is_done = false;
+			while (!is_done)
+			{
+				tft_driver_refresh_poll(handle, &is_done);
+			}
+			mock_panel_advance_time(TEST_POLL_US);
+			tft_driver_frame_poll(handle, NULL);
+			num_stale += check_stale(handle, &presented);
+		}
+	}
+	uint64_t elapsed_ns = mock_panel_get_time_ns() - start_ns - (uint64_t)TEST_DRAIN_US * 1000;
+	tft_driver_refresh_wait(handle);
+
+	/* Every frame submitted was either presented or merged into a later one */
+	uint32_t dropped;
+	presented = get_presented(handle, &dropped) - base;
+	uint32_t max_presented = elapsed_ns * tc->frame_rate / 1000000000 + 1;
+	if ((num_stale > 0) || (presented + dropped != num_submit) ||
+	    (tc->is_rate_bound && ((presented > max_presented) || (presented + 2 < max_presented * 9 / 10))) ||
+	    (!tc->is_dropping && (dropped > 0)))
+	{
+		printf("%s: %u submitted, %u presented of %u at most, %u dropped, %u on old edges\n",
+		       tc->name, num_submit, presented, max_presented, dropped, num_stale);
+		num_fail++;
+	}
+	if (mock_panel_get_pixel(0, 0) != panel_color[(TEST_NUM_FRAME - 1) & 1])
+	{
+		printf("%s: last frame not shown\n", tc->name);
+		num_fail++;
+	}
+
+	return num_fail;
+}
+
+int main(void)
+{
+	int num_fail = 0;
+
+	int err = run_divider();
+	printf("%-36s %s\n", "divider", err ? "FAIL" : "ok");
+	num_fail += err != 0;
+
+	err = run_blocking(false);
+	printf("%-36s %s\n", "blocking", err ? "FAIL" : "ok");
+	num_fail += err != 0;
+
+	err = run_blocking(true);
+	printf("%-36s %s\n", "blocking async", err ? "FAIL" : "ok");
+	num_fail += err != 0;
+
+	for (uint32_t i = 0; i < sizeof(test_case) / sizeof(test_case[0]); i++)
+	{
+		err = run_polled(&test_case[i]);
+		printf("%-36s %s\n", test_case[i].name, err ? "FAIL" : "ok");
+		num_fail += err != 0;
+	}
+
+	return num_fail ? 1 : 0;
+}
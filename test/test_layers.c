@@ -0,0 +1,292 @@
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "tft_driver.h"
+#include "mock_panel.h"
+
+#define TEST_WIDTH 				320
+#define TEST_HEIGHT 			240
+#define TEST_NUM_LAYER 			3
+#define TEST_DL_SIZE 			(16 * 1024)
+#define TEST_KEY 				0xFF00FF
+
+/**
+ * @struct  Driver setup the layer steps run with.
+ */
+typedef struct {
+	const char *name;
+	tft_driver_render_mode_t render_mode;
+	tft_driver_pixel_format_t pixel_format;
+	uint8_t skip_unchanged;
+	bool is_async;
+} test_case_t;
+
+/**
+ * @struct  Layer change followed by a refresh.
+ */
+typedef struct {
+	const char *name;
+	uint8_t layer_id;
+	enum {
+		STEP_SHOW,
+		STEP_HIDE,
+		STEP_MOVE,
+		STEP_ALPHA,
+	} op;
+	int16_t x;
+	int16_t y;
+	uint8_t alpha;
+} test_step_t;
+
+static const test_case_t test_case[] = {
+	{"fb565", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 0, false},
+	{"fb888", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB888, 0, false},
+	{"display list", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, 0, false},
+	{"fb565 async", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 0, true},
+	{"fb888 async", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB888, 0, true},
+	{"display list async", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565, 0, true},
+	{"fb565 skip unchanged", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 1, false},
+	{"fb565 skip unchanged async", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565, 1, true},
+};
+
+/* Opaque layer, color keyed layer over it and a blended one in between */
+static const test_step_t test_step[] = {
+	{"show opaque", 0, STEP_SHOW},
+	{"show keyed", 1, STEP_SHOW},
+	{"show blended", 2, STEP_SHOW},
+	{"move opaque off left and bottom", 0, STEP_MOVE, -20, 210},
+	{"move keyed off right and top", 1, STEP_MOVE, 300, -15},
+	{"move blended under keyed", 2, STEP_MOVE, 250, 5},
+	{"blend lighter", 2, STEP_ALPHA, 0, 0, 64},
+	{"hide keyed", 1, STEP_HIDE},
+	{"move opaque off every edge", 0, STEP_MOVE, -40, -30},
+	{"hide opaque", 0, STEP_HIDE},
+	{"blend almost opaque", 2, STEP_ALPHA, 0, 0, 250},
+	{"hide blended", 2, STEP_HIDE}, 		/* Panel shows the background again */
+};
+
+static const tft_driver_layer_t layer_init[TEST_NUM_LAYER] = {
+	{.x = 40, .y = 30, .width = 64, .height = 48, .z_order = 2, .alpha = 255},
+	{.x = 70, .y = 50, .width = 40, .height = 40, .z_order = 5, .alpha = 255, .use_color_key = 1, .color_key = TEST_KEY},
+	{.x = 90, .y = 60, .width = 80, .height = 30, .z_order = 3, .alpha = 128},
+};
+
+static uint16_t layer_data[TEST_NUM_LAYER][64 * 48];
+static tft_driver_layer_t layer[TEST_NUM_LAYER];
+static uint16_t background[TEST_HEIGHT][TEST_WIDTH];
+static uint16_t expected[TEST_HEIGHT][TEST_WIDTH];
+
+static uint16_t to_panel(uint32_t color)
+{
+	/* RGB565 byte swapped, as the panel memory holds it */
+	uint16_t pixel = ((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) | ((color >> 3) & 0x001F);
+
+	return (pixel << 8) | (pixel >> 8);
+}
+
+static uint16_t blend(uint16_t dst, uint16_t src, uint8_t alpha)
+{
+	/* Every channel on its own, 32 levels as the driver blends */
+	uint32_t a = (alpha + 4) >> 3;
+	uint16_t d = (dst << 8) | (dst >> 8);
+	uint16_t s = (src << 8) | (src >> 8);
+	uint16_t r = (((d >> 11) * (32 - a) + (s >> 11) * a) >> 5) << 11;
+	uint16_t g = ((((d >> 5) & 0x3F) * (32 - a) + ((s >> 5) & 0x3F) * a) >> 5) << 5;
+	uint16_t b = ((d & 0x1F) * (32 - a) + (s & 0x1F) * a) >> 5;
+	uint16_t pixel = r | g | b;
+
+	return (pixel << 8) | (pixel >> 8);
+}
+
+static void make_layers(void)
+{
+	for (uint8_t id = 0; id < TEST_NUM_LAYER; id++)
+	{
+		layer[id] = layer_init[id];
+		layer[id].data = layer_data[id];
+		for (uint16_t y = 0; y < layer[id].height; y++)
+		{
+			for (uint16_t x = 0; x < layer[id].width; x++)
+			{
+				/* Gradient, every pixel of a misplaced row or column shows */
+				uint32_t color = ((uint32_t)(x * 4) << 16) | ((uint32_t)(y * 5) << 8) | (id * 80);
+				if ((id == 1) && (((x / 8) + (y / 8)) & 1))
+				{
+					color = TEST_KEY;
+				}
+				layer_data[id][y * layer[id].width + x] = to_panel(color);
+			}
+		}
+	}
+}
+
+static void make_expected(void)
+{
+	memcpy(expected, background, sizeof(expected));
+
+	/* Lowest z order first */
+	for (uint8_t z = 0; z < 255; z++)
+	{
+		for (uint8_t id = 0; id < TEST_NUM_LAYER; id++)
+		{
+			const tft_driver_layer_t *l = &layer[id];
+			if ((l->z_order != z) || !l->visible || (l->alpha < 4))
+			{
+				continue;
+			}
+			for (int32_t y = 0; y < l->height; y++)
+			{
+				for (int32_t x = 0; x < l->width; x++)
+				{
+					int32_t sx = l->x + x;
+					int32_t sy = l->y + y;
+					uint16_t pixel = l->data[y * l->width + x];
+					if ((sx < 0) || (sx >= TEST_WIDTH) || (sy < 0) || (sy >= TEST_HEIGHT) ||
+					    (l->use_color_key && (pixel == to_panel(l->color_key))))
+					{
+						continue;
+					}
+					expected[sy][sx] = blend(expected[sy][sx], pixel, l->alpha);
+				}
+			}
+		}
+	}
+}
+
+static void refresh(tft_driver_handle_t handle, bool is_async)
+{
+	if (!is_async)
+	{
+		tft_driver_screen_refresh(handle);
+		return;
+	}
+
+	uint8_t is_done = false;
+	tft_driver_screen_refresh_async(handle);
+	while (!is_done)
+	{
+		tft_driver_refresh_poll(handle, &is_done);
+	}
+}
+
+static uint32_t count_diff(void)
+{
+	uint32_t num_diff = 0;
+
+	for (uint16_t row = 0; row < TEST_HEIGHT; row++)
+	{
+		for (uint16_t col = 0; col < TEST_WIDTH; col++)
+		{
+			num_diff += mock_panel_get_pixel(col, row) != expected[row][col];
+		}
+	}
+
+	return num_diff;
+}
+
+static int run_case(const test_case_t *tc)
+{
+	tft_driver_cfg_t config = {
+		.height = TEST_HEIGHT,
+		.width = TEST_WIDTH,
+		.pixel_format = tc->pixel_format,
+		.render_mode = tc->render_mode,
+		.display_list_size = TEST_DL_SIZE,
+		.skip_unchanged = tc->skip_unchanged,
+		.num_layer = TEST_NUM_LAYER,
+	};
+
+	tft_driver_handle_t handle = tft_driver_init();
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	if (tc->is_async)
+	{
+		tft_driver_set_func_async(handle, mock_panel_queue_trans, mock_panel_wait_trans);
+	}
+	mock_panel_reset(40000000);
+	if (tft_driver_config(handle, config) != ERR_CODE_SUCCESS)
+	{
+		printf("%s: config failed\n", tc->name);
+		return 1;
+	}
+
+	/* Background is drawn once, layer changes must not need it again */
+	tft_driver_fill(handle, 0x202020);
+	tft_driver_fill_rectangle(handle, 0, 0, 160, 120, 0x0000C0);
+	tft_driver_fill_rectangle(handle, 200, 100, 120, 140, 0xC04000);
+	tft_driver_fill_circle(handle, 100, 150, 40, 0x00A000);
+	refresh(handle, tc->is_async);
+	for (uint16_t row = 0; row < TEST_HEIGHT; row++)
+	{
+		for (uint16_t col = 0; col < TEST_WIDTH; col++)
+		{
+			background[row][col] = mock_panel_get_pixel(col, row);
+		}
+	}
+
+	make_layers();
+	for (uint8_t id = 0; id < TEST_NUM_LAYER; id++)
+	{
+		if (tft_driver_set_layer(handle, id, &layer[id]) != ERR_CODE_SUCCESS)
+		{
+			printf("%s: layer %u not set\n", tc->name, id);
+			return 1;
+		}
+	}
+
+	int num_fail = 0;
+	for (uint32_t i = 0; i < sizeof(test_step) / sizeof(test_step[0]); i++)
+	{
+		const test_step_t *step = &test_step[i];
+		tft_driver_layer_t *l = &layer[step->layer_id];
+		err_code_t err = ERR_CODE_SUCCESS;
+		switch (step->op)
+		{
+		case STEP_SHOW:
+		case STEP_HIDE:
+			l->visible = step->op == STEP_SHOW;
+			err = tft_driver_show_layer(handle, step->layer_id, l->visible);
+			break;
+		case STEP_MOVE:
+			l->x = step->x;
+			l->y = step->y;
+			err = tft_driver_move_layer(handle, step->layer_id, l->x, l->y);
+			break;
+		default:
+			l->alpha = step->alpha;
+			err = tft_driver_set_layer(handle, step->layer_id, l);
+			break;
+		}
+
+		/* Only what the layer covered before and after goes out */
+		mock_panel_reset_stats();
+		refresh(handle, tc->is_async);
+		mock_panel_stats_t stats;
+		mock_panel_get_stats(&stats);
+
+		make_expected();
+		uint32_t num_diff = count_diff();
+		if ((err != ERR_CODE_SUCCESS) || (num_diff > 0) || (stats.num_byte >= TEST_WIDTH * TEST_HEIGHT * 2))
+		{
+			printf("%s: %s, %u pixels differ, %llu bytes sent\n", tc->name, step->name, num_diff,
+			       (unsigned long long)stats.num_byte);
+			num_fail++;
+		}
+	}
+
+	return num_fail;
+}
+
+int main(void)
+{
+	int num_fail = 0;
+
+	for (uint32_t i = 0; i < sizeof(test_case) / sizeof(test_case[0]); i++)
+	{
+		int err = run_case(&test_case[i]);
+		printf("%-36s %s\n", test_case[i].name, err ? "FAIL" : "ok");
+		num_fail += err != 0;
+	}
+
+	return num_fail ? 1 : 0;
+}
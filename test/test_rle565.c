@@ -0,0 +1,96 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "codec/rle565.h"
+
+#define TEST_NUM_IMAGE 			200
+#define TEST_MAX_PIXEL 			2000
+
+static uint32_t test_seed = 1;
+
+static uint32_t test_rand(void)
+{
+	test_seed ^= test_seed << 13;
+	test_seed ^= test_seed >> 17;
+	test_seed ^= test_seed << 5;
+
+	return test_seed;
+}
+
+static void make_pixels(uint8_t *pixels, uint32_t num_pixel)
+{
+	/* Runs of random length, repeated or noisy, around packet size limits */
+	uint32_t idx = 0;
+	while (idx < num_pixel)
+	{
+		uint32_t len = 1 + test_rand() % (2 * RLE565_MAX_RUN + 3);
+		uint8_t is_repeat = test_rand() & 1;
+		uint16_t color = test_rand();
+		for (uint32_t i = 0; (i < len) && (idx < num_pixel); i++, idx++)
+		{
+			if (!is_repeat)
+			{
+				color = test_rand() % 4;
+			}
+			memcpy(&pixels[idx * 2], &color, 2);
+		}
+	}
+}
+
+int main(void)
+{
+	static uint8_t pixels[TEST_MAX_PIXEL * 2];
+	static uint8_t decoded[TEST_MAX_PIXEL * 2];
+	static uint8_t stream[TEST_MAX_PIXEL * 2 + TEST_MAX_PIXEL / RLE565_MAX_RUN + 1];
+	int num_fail = 0;
+
+	for (uint32_t n = 0; n < TEST_NUM_IMAGE; n++)
+	{
+		uint32_t num_pixel = 1 + test_rand() % TEST_MAX_PIXEL;
+		make_pixels(pixels, num_pixel);
+
+		/* Size pass agrees with the written stream and stays within worst case */
+		uint32_t size = rle565_encode(pixels, num_pixel, NULL);
+		if ((rle565_encode(pixels, num_pixel, stream) != size) ||
+		    (size > num_pixel * 2 + num_pixel / RLE565_MAX_RUN + 1))
+		{
+			printf("image %u: stream size %u out of bounds\n", n, size);
+			num_fail++;
+			continue;
+		}
+
+		/* Decode in random pieces, skipping some of them, as rows of a clipped blit are */
+		rle565_decoder_t decoder;
+		rle565_decoder_init(&decoder, stream);
+		memset(decoded, 0, sizeof(decoded));
+		uint32_t idx = 0;
+		while (idx < num_pixel)
+		{
+			uint32_t len = 1 + test_rand() % 300;
+			if (len > num_pixel - idx)
+			{
+				len = num_pixel - idx;
+			}
+			if (test_rand() % 4 == 0)
+			{
+				rle565_decode(&decoder, NULL, len);
+				memcpy(&decoded[idx * 2], &pixels[idx * 2], len * 2);
+			}
+			else
+			{
+				rle565_decode(&decoder, &decoded[idx * 2], len);
+			}
+			idx += len;
+		}
+
+		if ((memcmp(decoded, pixels, num_pixel * 2) != 0) || (decoder.src != stream + size))
+		{
+			printf("image %u: round trip of %u pixels differs\n", n, num_pixel);
+			num_fail++;
+		}
+	}
+
+	printf("%u images: %d failed\n", TEST_NUM_IMAGE, num_fail);
+
+	return num_fail ? 1 : 0;
+}
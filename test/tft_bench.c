@@ -0,0 +1,426 @@
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "tft_driver.h"
+#include "color/color_convert.h"
+#include "codec/rle565.h"
+#include "mock_panel.h"
+#include "worker_pool.h"
+
+#define BENCH_WIDTH 			320
+#define BENCH_HEIGHT 			240
+#define BENCH_CLOCK_MHZ 		40 		/*!< SPI clock when not given, ILI9341 writes up to about that */
+#define BENCH_NUM_FRAME 		20 		/*!< Frames per workload when not given */
+#define BENCH_NUM_LINE 			1000
+#define BENCH_NUM_CIRCLE 		100
+#define BENCH_DL_SIZE 			(64 * 1024)
+#define BENCH_CONVERT_PIXEL 	(320 * 16) 		/*!< One band of lines buffer */
+#define BENCH_CONVERT_NS 		200000000 		/*!< Time each conversion kernel runs for */
+#define BENCH_PARALLEL_BAND 	4 		/*!< Bands prepared together in the worker scaling run */
+
+/**
+ * @struct  Render mode and screen buffer format a workload runs in.
+ */
+typedef struct {
+	const char *name;
+	tft_driver_render_mode_t render_mode;
+	tft_driver_pixel_format_t pixel_format;
+} bench_mode_t;
+
+/**
+ * @struct  Workload, draw is called once per frame and returns drawing calls made.
+ */
+typedef struct {
+	const char *name;
+	uint32_t (*draw)(tft_driver_handle_t handle, uint32_t frame);
+	uint8_t is_cleared; 			/*!< Screen is filled black before every frame, display list does not grow */
+} bench_workload_t;
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+	/* Same sequence on every host, xorshift32 */
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 17;
+	bench_seed ^= bench_seed << 5;
+
+	return bench_seed;
+}
+
+static uint64_t bench_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t draw_fill(tft_driver_handle_t handle, uint32_t frame)
+{
+	tft_driver_fill(handle, (frame & 1) ? 0x2040A0 : 0xA04020);
+
+	return 1;
+}
+
+static uint32_t draw_lines(tft_driver_handle_t handle, uint32_t frame)
+{
+	(void)frame;
+
+	for (uint32_t i = 0; i < BENCH_NUM_LINE; i++)
+	{
+		tft_driver_write_line(handle,
+		                      bench_rand() % BENCH_WIDTH, bench_rand() % BENCH_HEIGHT,
+		                      bench_rand() % BENCH_WIDTH, bench_rand() % BENCH_HEIGHT,
+		                      bench_rand() & 0xFFFFFF);
+	}
+
+	return BENCH_NUM_LINE;
+}
+
+static uint32_t draw_text(tft_driver_handle_t handle, uint32_t frame)
+{
+	static uint8_t text[] = "The quick brown fox jumps over the lazy dog 0123";
+	uint32_t num_op = 0;
+
+	/* Page of 8 pixel text, one string per line */
+	for (uint16_t y = 0; y + 8 <= BENCH_HEIGHT; y += 10)
+	{
+		tft_driver_set_position(handle, 0, y);
+		tft_driver_write_string(handle, FONT_SIZE_8, text, (frame & 1) ? 0xFFFFFF : 0x00FF00);
+		num_op++;
+	}
+
+	return num_op;
+}
+
+static uint32_t draw_circles(tft_driver_handle_t handle, uint32_t frame)
+{
+	(void)frame;
+
+	for (uint32_t i = 0; i < BENCH_NUM_CIRCLE; i++)
+	{
+		uint16_t x = bench_rand() % BENCH_WIDTH;
+		uint16_t y = bench_rand() % BENCH_HEIGHT;
+		uint16_t r = 2 + bench_rand() % 40;
+		uint32_t color = bench_rand() & 0xFFFFFF;
+		if (i & 1)
+		{
+			tft_driver_fill_circle(handle, x, y, r, color);
+		}
+		else
+		{
+			tft_driver_write_circle(handle, x, y, r, color);
+		}
+	}
+
+	return BENCH_NUM_CIRCLE;
+}
+
+static const bench_mode_t bench_mode[] = {
+	{"fb888", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB888},
+	{"fb565", TFT_DRIVER_RENDER_MODE_FRAMEBUFFER, TFT_DRIVER_PIXEL_FORMAT_RGB565},
+	{"dl", TFT_DRIVER_RENDER_MODE_DISPLAY_LIST, TFT_DRIVER_PIXEL_FORMAT_RGB565},
+	{"immediate", TFT_DRIVER_RENDER_MODE_IMMEDIATE, TFT_DRIVER_PIXEL_FORMAT_RGB565},
+};
+
+static const bench_workload_t bench_workload[] = {
+	{"fill", draw_fill, false},
+	{"lines", draw_lines, true},
+	{"text", draw_text, true},
+	{"circles", draw_circles, true},
+};
+
+/* Conversion and display list replay are what workers share out */
+static const struct {
+	const bench_mode_t *mode;
+	const bench_workload_t *workload;
+} bench_parallel_run[] = {
+	{&bench_mode[0], &bench_workload[0]},
+	{&bench_mode[2], &bench_workload[1]},
+};
+
+static int run_workload(const bench_mode_t *mode, const bench_workload_t *workload, uint32_t clock_mhz, uint32_t num_frame)
+{
+	tft_driver_handle_t handle = tft_driver_init();
+	if (handle == NULL)
+	{
+		return -1;
+	}
+
+	tft_driver_cfg_t config = {
+		.height = BENCH_HEIGHT,
+		.width = BENCH_WIDTH,
+		.pixel_format = mode->pixel_format,
+		.render_mode = mode->render_mode,
+		.display_list_size = BENCH_DL_SIZE,
+	};
+	mock_panel_reset(clock_mhz * 1000000);
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	if (tft_driver_config(handle, config) != ERR_CODE_SUCCESS)
+	{
+		return -1;
+	}
+
+	/* First refresh sends the whole screen after init, it is not counted */
+	tft_driver_screen_refresh(handle);
+	mock_panel_reset_stats();
+	bench_seed = 1;
+
+	uint64_t draw_ns = 0;
+	uint64_t refresh_ns = 0;
+	uint64_t num_op = 0;
+	for (uint32_t frame = 0; frame < num_frame; frame++)
+	{
+		if (workload->is_cleared)
+		{
+			tft_driver_fill(handle, 0x000000);
+		}
+
+		uint64_t start = bench_time_ns();
+		num_op += workload->draw(handle, frame);
+		uint64_t drawn = bench_time_ns();
+		tft_driver_screen_refresh(handle);
+		uint64_t refreshed = bench_time_ns();
+
+		draw_ns += drawn - start;
+		refresh_ns += refreshed - drawn;
+	}
+
+	/* Immediate mode sends while drawing, bus figures cover both */
+	mock_panel_stats_t stats;
+	mock_panel_get_stats(&stats);
+	double bus_ns = (double)stats.bus_time_ns / num_frame;
+	printf("%-10s %-8s %10.1f %12.1f %12llu %8u %6u %6u %10.1f %8.1f\n",
+	       mode->name, workload->name,
+	       (double)draw_ns / num_op,
+	       (double)refresh_ns / num_frame / 1000,
+	       (unsigned long long)(stats.num_byte / num_frame),
+	       stats.num_trans / num_frame,
+	       stats.num_dc_toggle / num_frame,
+	       stats.num_dc_write / num_frame,
+	       bus_ns / 1000,
+	       (bus_ns > 0) ? 1e9 / bus_ns : 0);
+
+	return 0;
+}
+
+static int bench_parallel(const bench_mode_t *mode, const bench_workload_t *workload, uint32_t num_worker, uint32_t num_frame)
+{
+	tft_driver_handle_t handle = tft_driver_init();
+	if ((handle == NULL) || (worker_pool_start(num_worker) != ERR_CODE_SUCCESS))
+	{
+		return -1;
+	}
+
+	tft_driver_cfg_t config = {
+		.height = BENCH_HEIGHT,
+		.width = BENCH_WIDTH,
+		.pixel_format = mode->pixel_format,
+		.render_mode = mode->render_mode,
+		.display_list_size = BENCH_DL_SIZE,
+		.num_parallel_band = BENCH_PARALLEL_BAND,
+	};
+	mock_panel_reset(BENCH_CLOCK_MHZ * 1000000);
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	tft_driver_set_func_parallel(handle, worker_pool_run);
+	if (tft_driver_config(handle, config) != ERR_CODE_SUCCESS)
+	{
+		worker_pool_stop();
+		return -1;
+	}
+
+	/* Same frames for every number of workers, only refresh is timed */
+	tft_driver_screen_refresh(handle);
+	bench_seed = 1;
+	uint64_t refresh_ns = 0;
+	for (uint32_t frame = 0; frame < num_frame; frame++)
+	{
+		if (workload->is_cleared)
+		{
+			tft_driver_fill(handle, 0x000000);
+		}
+		workload->draw(handle, frame);
+
+		uint64_t start = bench_time_ns();
+		tft_driver_screen_refresh(handle);
+		refresh_ns += bench_time_ns() - start;
+	}
+	worker_pool_stop();
+
+	printf("%-10s %-8s %8u %12.1f\n", mode->name, workload->name, num_worker, (double)refresh_ns / num_frame / 1000);
+
+	return 0;
+}
+
+static double bench_convert(void (*convert)(const uint8_t *, uint16_t *, uint32_t))
+{
+	static uint8_t src[BENCH_CONVERT_PIXEL * 3];
+	static uint16_t dst[BENCH_CONVERT_PIXEL];
+
+	for (uint32_t i = 0; i < sizeof(src); i++)
+	{
+		src[i] = bench_rand();
+	}
+
+	/* Convert the band over and over for a fixed time */
+	uint64_t num_pixel = 0;
+	uint64_t start = bench_time_ns();
+	uint64_t elapsed = 0;
+	while (elapsed < BENCH_CONVERT_NS)
+	{
+		for (uint32_t i = 0; i < 64; i++)
+		{
+			convert(src, dst, BENCH_CONVERT_PIXEL);
+			src[i] = dst[i];
+		}
+		num_pixel += 64 * BENCH_CONVERT_PIXEL;
+		elapsed = bench_time_ns() - start;
+	}
+
+	return (double)num_pixel * 1000 / elapsed;
+}
+
+static void make_background(uint16_t *pixels)
+{
+	/* Vertical gradient with flat panels and a noisy picture, like a UI background */
+	for (uint32_t y = 0; y < BENCH_HEIGHT; y++)
+	{
+		for (uint32_t x = 0; x < BENCH_WIDTH; x++)
+		{
+			uint16_t color = (y / 8) << 11 | (y / 4);
+			if ((x >= 20) && (x < 140) && (y >= 40) && (y < 200))
+			{
+				color = 0xE7FF;
+			}
+			if ((x >= 180) && (x < 300) && (y >= 60) && (y < 140))
+			{
+				color = bench_rand();
+			}
+			pixels[y * BENCH_WIDTH + x] = color;
+		}
+	}
+}
+
+static double bench_blit(tft_driver_handle_t handle, const tft_driver_image_t *image)
+{
+	/* Every blit covers the whole screen, time includes sending it */
+	uint64_t start = bench_time_ns();
+	for (uint32_t i = 0; i < BENCH_NUM_FRAME; i++)
+	{
+		tft_driver_blit(handle, 0, 0, image);
+		tft_driver_screen_refresh(handle);
+	}
+
+	return (double)(bench_time_ns() - start) / BENCH_NUM_FRAME / 1000;
+}
+
+static void bench_rle565(void)
+{
+	static uint16_t pixels[BENCH_WIDTH * BENCH_HEIGHT];
+	static uint8_t stream[BENCH_WIDTH * BENCH_HEIGHT * 2 + BENCH_WIDTH * BENCH_HEIGHT / RLE565_MAX_RUN + 1];
+	static uint16_t band[BENCH_CONVERT_PIXEL];
+	uint32_t num_pixel = BENCH_WIDTH * BENCH_HEIGHT;
+
+	make_background(pixels);
+	uint32_t size = rle565_encode((const uint8_t *)pixels, num_pixel, stream);
+
+	/* Decode the image band by band for a fixed time, as refresh does */
+	uint64_t num_decoded = 0;
+	uint64_t start = bench_time_ns();
+	uint64_t elapsed = 0;
+	while (elapsed < BENCH_CONVERT_NS)
+	{
+		rle565_decoder_t decoder;
+		rle565_decoder_init(&decoder, stream);
+		for (uint32_t done = 0; done < num_pixel; done += BENCH_CONVERT_PIXEL)
+		{
+			rle565_decode(&decoder, (uint8_t *)band, BENCH_CONVERT_PIXEL);
+		}
+		num_decoded += num_pixel;
+		elapsed = bench_time_ns() - start;
+	}
+
+	printf("\nRLE565 %ux%u background, %u of %u bytes (%.1f%%)\n",
+	       BENCH_WIDTH, BENCH_HEIGHT, size, num_pixel * 2, 100.0 * size / (num_pixel * 2));
+	printf("decode    %10.1f Mpixel/s\n", (double)num_decoded * 1000 / elapsed);
+
+	/* Full screen blit and refresh, compressed against raw source */
+	tft_driver_handle_t handle = tft_driver_init();
+	tft_driver_cfg_t config = {
+		.height = BENCH_HEIGHT,
+		.width = BENCH_WIDTH,
+		.pixel_format = TFT_DRIVER_PIXEL_FORMAT_RGB565,
+		.render_mode = TFT_DRIVER_RENDER_MODE_FRAMEBUFFER,
+	};
+	tft_driver_set_func(handle, mock_panel_spi_trans, mock_panel_set_dc, mock_panel_set_rst, mock_panel_delay);
+	if ((handle == NULL) || (tft_driver_config(handle, config) != ERR_CODE_SUCCESS))
+	{
+		return;
+	}
+
+	tft_driver_image_t image = {
+		.data = (const uint8_t *)pixels,
+		.width = BENCH_WIDTH,
+		.height = BENCH_HEIGHT,
+		.format = TFT_DRIVER_IMAGE_FORMAT_RGB565,
+	};
+	printf("blit raw  %10.1f us/frame\n", bench_blit(handle, &image));
+	image.data = stream;
+	image.format = TFT_DRIVER_IMAGE_FORMAT_RLE565;
+	printf("blit rle  %10.1f us/frame\n", bench_blit(handle, &image));
+}
+
+int main(int argc, char **argv)
+{
+	/* Usage: tft_bench [spi_clock_mhz] [num_frame] */
+	uint32_t clock_mhz = (argc > 1) ? (uint32_t)atoi(argv[1]) : BENCH_CLOCK_MHZ;
+	uint32_t num_frame = (argc > 2) ? (uint32_t)atoi(argv[2]) : BENCH_NUM_FRAME;
+	if ((clock_mhz == 0) || (num_frame == 0))
+	{
+		fprintf(stderr, "usage: %s [spi_clock_mhz] [num_frame]\n", argv[0]);
+		return 1;
+	}
+
+	printf("SPI clock %u MHz, %u frames per workload, FPS is bus bound\n", clock_mhz, num_frame);
+	printf("%-10s %-8s %10s %12s %12s %8s %6s %6s %10s %8s\n",
+	       "mode", "workload", "ns/op", "refresh us", "bytes/frame", "trans", "dc", "dc wr", "bus us", "FPS");
+
+	for (uint32_t m = 0; m < sizeof(bench_mode) / sizeof(bench_mode[0]); m++)
+	{
+		for (uint32_t w = 0; w < sizeof(bench_workload) / sizeof(bench_workload[0]); w++)
+		{
+			if (run_workload(&bench_mode[m], &bench_workload[w], clock_mhz, num_frame) != 0)
+			{
+				fprintf(stderr, "%s %s: driver setup failed\n", bench_mode[m].name, bench_workload[w].name);
+				return 1;
+			}
+		}
+	}
+
+	/* Bands of a group prepared on pthread workers, the calling thread is one of them */
+	printf("\n%u bands prepared together, refresh time by workers\n", BENCH_PARALLEL_BAND);
+	printf("%-10s %-8s %8s %12s\n", "mode", "workload", "workers", "refresh us");
+	for (uint32_t r = 0; r < sizeof(bench_parallel_run) / sizeof(bench_parallel_run[0]); r++)
+	{
+		for (uint32_t num_worker = 1; num_worker <= 4; num_worker *= 2)
+		{
+			if (bench_parallel(bench_parallel_run[r].mode, bench_parallel_run[r].workload, num_worker, num_frame) != 0)
+			{
+				fprintf(stderr, "%s: parallel driver setup failed\n", bench_parallel_run[r].mode->name);
+				return 1;
+			}
+		}
+	}
+
+	/* RGB888 screen buffer conversion, kernel of this build against the scalar reference */
+	printf("\nRGB888 to RGB565, %u pixel band\n", BENCH_CONVERT_PIXEL);
+	printf("kernel    %10.1f Mpixel/s\n", bench_convert(color_convert_rgb888_to_rgb565));
+	printf("reference %10.1f Mpixel/s\n", bench_convert(color_convert_rgb888_to_rgb565_ref));
+
+	bench_rle565();
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+#include "stdatomic.h"
+#include "stdbool.h"
+#include "pthread.h"
+#include "worker_pool.h"
+
+/**
+ * @struct  Workers and the run they take jobs of. A new run bumps the
+ *          generation, workers sleep until they see it change.
+ */
+typedef struct {
+	pthread_t thread[WORKER_POOL_MAX_WORKER];
+	uint32_t num_thread;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	uint32_t generation;
+	uint32_t num_busy; 				/*!< Threads still taking jobs of the current run */
+	uint32_t num_run;
+	uint8_t is_stopped;
+	tft_driver_job_t job;
+	void *arg;
+	uint32_t num_job;
+	atomic_uint next_idx;
+} worker_pool_t;
+
+static worker_pool_t pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.start = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+};
+
+static void take_jobs(void)
+{
+	uint32_t idx;
+
+	while ((idx = atomic_fetch_add(&pool.next_idx, 1)) < pool.num_job)
+	{
+		pool.job(pool.arg, idx);
+	}
+}
+
+static void *worker_task(void *arg)
+{
+	(void)arg;
+	uint32_t generation = 0;
+
+	pthread_mutex_lock(&pool.lock);
+	while (true)
+	{
+		while (!pool.is_stopped && (pool.generation == generation))
+		{
+			pthread_cond_wait(&pool.start, &pool.lock);
+		}
+		if (pool.is_stopped)
+		{
+			break;
+		}
+		generation = pool.generation;
+		pthread_mutex_unlock(&pool.lock);
+
+		take_jobs();
+
+		pthread_mutex_lock(&pool.lock);
+		if (--pool.num_busy == 0)
+		{
+			pthread_cond_signal(&pool.done);
+		}
+	}
+	pthread_mutex_unlock(&pool.lock);
+
+	return NULL;
+}
+
+err_code_t worker_pool_start(uint32_t num_worker)
+{
+	if ((num_worker == 0) || (num_worker > WORKER_POOL_MAX_WORKER) || (pool.num_thread > 0))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	pool.is_stopped = false;
+	pool.generation = 0;
+	pool.num_run = 0;
+	for (uint32_t i = 0; i < num_worker - 1; i++)
+	{
+		if (pthread_create(&pool.thread[i], NULL, worker_task, NULL) != 0)
+		{
+			worker_pool_stop();
+			return ERR_CODE_FAIL;
+		}
+		pool.num_thread++;
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t worker_pool_run(tft_driver_job_t job, void *arg, uint32_t num_job)
+{
+	if (job == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Run is published under the lock, workers read it after they woke up */
+	pthread_mutex_lock(&pool.lock);
+	pool.num_run += num_job > 1;
+	pool.job = job;
+	pool.arg = arg;
+	pool.num_job = num_job;
+	atomic_store(&pool.next_idx, 0);
+	pool.num_busy = pool.num_thread;
+	pool.generation++;
+	pthread_cond_broadcast(&pool.start);
+	pthread_mutex_unlock(&pool.lock);
+
+	take_jobs();
+
+	/* Last job taken may still run on a worker */
+	pthread_mutex_lock(&pool.lock);
+	while (pool.num_busy > 0)
+	{
+		pthread_cond_wait(&pool.done, &pool.lock);
+	}
+	pthread_mutex_unlock(&pool.lock);
+
+	return ERR_CODE_SUCCESS;
+}
+
+uint32_t worker_pool_get_num_run(void)
+{
+	return pool.num_run;
+}
+
+void worker_pool_stop(void)
+{
+	pthread_mutex_lock(&pool.lock);
+	pool.is_stopped = true;
+	pthread_cond_broadcast(&pool.start);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (uint32_t i = 0; i < pool.num_thread; i++)
+	{
+		pthread_join(pool.thread[i], NULL);
+	}
+	pool.num_thread = 0;
+}
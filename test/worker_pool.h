@@ -0,0 +1,88 @@
+// MIT License
+
+// Copyright (c) 2023 phonght32
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+#include "err_code.h"
+#include "intf/tft_driver_intf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Pthread workers behind tft_driver_set_func_parallel. The calling thread
+ * takes jobs as one of the workers, the others wait for a run on a
+ * condition variable. Jobs are handed out in order of idx.
+ */
+
+#define WORKER_POOL_MAX_WORKER      8           /*!< Workers including the calling thread */
+
+/*
+ * @brief   Start worker threads.
+ *
+ * @param   num_worker Workers including the calling thread, 1 runs every
+ *          job on the calling thread.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t worker_pool_start(uint32_t num_worker);
+
+/*
+ * @brief   Run job on the workers, port function for tft_driver_set_func_parallel.
+ *
+ * @param   job Job, called once for every idx from 0 to num_job - 1.
+ * @param   arg Argument passed to job.
+ * @param   num_job Number of jobs.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t worker_pool_run(tft_driver_job_t job, void *arg, uint32_t num_job);
+
+/*
+ * @brief   Get number of runs with more than one job since start.
+ *
+ * @param   None.
+ *
+ * @return  Number of runs.
+ */
+uint32_t worker_pool_get_num_run(void);
+
+/*
+ * @brief   Stop and join worker threads.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+void worker_pool_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WORKER_POOL_H__ */
@@ -1,14 +1,46 @@
 #include "stdbool.h"
+#include "string.h"
+#include "stdatomic.h"
 #include "tft_driver.h"
-
-#define USE_ILI9341
-
-#ifdef USE_ILI9341
+#include "color/color_convert.h"
+#include "codec/rle565.h"
 #include "ili9341/ili9341.h"
-#endif
 
 #define SPI_PARALLEL_LINES  	16
-#define MAX_LINE_BUF  			2
+#define MAX_PARALLEL_BAND  		8 		/*!< Areas prepared together, each needs two lines buffers */
+#define MAX_DIRTY_RECT  		8
+#define DIRTY_MERGE_SLACK  		32 		/*!< Pixels worth of window setup overhead accepted when merging */
+#define REFRESH_TRANS_TIMEOUT_MS 1000
+#define DISPLAY_LIST_DEFAULT_SIZE 4096 		/*!< Bytes of display list when not configured */
+#define BLIT_CHUNK_PIXELS 		32 		/*!< Converted pixels sent at once in immediate mode */
+#define MAX_CLIP_DEPTH 			8
+#define TE_TIMEOUT_MS 			100 	/*!< Longer than a frame at the lowest panel rate */
+#define MIN_SCAN_RATE 			50 		/*!< Panel scans at a multiple of paced rates below this, lower ones flicker */
+#define MAX_HASH_BAND 			32 		/*!< Bands of SPI_PARALLEL_LINES rows hashed to skip unchanged ones */
+#define HASH_PRIME1 			2654435761U
+#define HASH_PRIME2 			2246822519U
+#define HASH_PRIME3 			3266489917U
+#define HASH_PRIME4 			668265263U
+#define HASH_PRIME5 			374761393U
+#define QUEUE_PAYLOAD_SIZE 		48 		/*!< Bytes of text or image following a queued command, text keeps one for terminator */
+#define QUEUE_DRAIN_BATCH 		16 		/*!< Queued commands drawn while an asynchronous refresh waits for the bus */
+
+#ifdef TFT_DRIVER_ENABLE_STATS
+#define STATS_TIME(handle) 						(((handle)->func_get_time_us != NULL) ? (handle)->func_get_time_us() : 0)
+#define STATS_TIME_START(handle, start) 		uint32_t start = STATS_TIME(handle)
+#define STATS_TIME_ADD(handle, field, start) 	((handle)->field += STATS_TIME(handle) - (start))
+#define STATS_ADD(handle, field, num) 			((handle)->stats.field += (num))
+#define STATS_CALL(handle, type) 				((handle)->stats.prim[type].num_call++)
+#define STATS_PRIM(handle, type) 				((handle)->stats_prim = (type))
+#define STATS_PIXEL(handle, num) 				((handle)->stats.prim[(handle)->stats_prim].num_pixel += (num))
+#else
+#define STATS_TIME_START(handle, start)
+#define STATS_TIME_ADD(handle, field, start)
+#define STATS_ADD(handle, field, num)
+#define STATS_CALL(handle, type)
+#define STATS_PRIM(handle, type)
+#define STATS_PIXEL(handle, num)
+#endif
 
 /**
  * @struct  LCD lines.
@@ -17,115 +49,4573 @@ typedef struct {
 	uint16_t *data;
 } lines_t;
 
+/**
+ * @struct  Rectangle area, end positions are inclusive.
+ */
+typedef struct {
+	uint16_t x_start;
+	uint16_t y_start;
+	uint16_t x_end;
+	uint16_t y_end;
+} rect_t;
+
+/**
+ * @struct  Color replicated in screen buffer format.
+ */
+typedef struct {
+	uint8_t bytes[3]; 				/*!< One pixel, or one byte of pixels for indexed formats */
+	uint32_t words[3]; 				/*!< 4 pixels of RGB888 or 2 pixels of RGB565 per word */
+} pattern_t;
+
+/**
+ * @struct  Run of set pixels in one glyph row.
+ */
+typedef struct {
+	uint8_t x;
+	uint8_t y;
+	uint8_t len;
+} glyph_span_t;
+
+/**
+ * @struct  Cached glyph, rasterized into runs.
+ */
+typedef struct {
+	uint8_t 		valid;
+	uint8_t 		font_size;
+	uint8_t 		chr;
+	uint8_t 		width; 				/*!< Font width, used to advance position */
+	uint8_t 		height;
+	uint8_t 		num_byte_per_row;
+	uint16_t 		num_span;
+	glyph_span_t 	*spans;
+} glyph_t;
+
+/**
+ * @struct  Destination of drawing. Pixel (x, y) of screen is stored at
+ *          data + (row * stride + (x - area.x_start)) * bytes_per_pixel, where
+ *          row is y - area.y_start + y_offset wrapped to the area height.
+ *          Indexed pixels are packed, that many index_bits into data.
+ */
+typedef struct {
+	uint8_t *data;
+	uint16_t stride; 				/*!< Pixels per row of data */
+	uint16_t y_offset; 				/*!< Rows of data are rotated by this, screen buffer is a ring after scrolling */
+	rect_t area; 					/*!< Screen area held by data */
+	rect_t clip; 					/*!< Part of area drawing may touch, primitives clip against it once */
+} target_t;
+
+/**
+ * @enum  Drawing command type, one per primitive.
+ */
+typedef enum {
+	CMD_FILL = TFT_DRIVER_PRIM_FILL,
+	CMD_PIXEL = TFT_DRIVER_PRIM_PIXEL,
+	CMD_LINE = TFT_DRIVER_PRIM_LINE,
+	CMD_RECT = TFT_DRIVER_PRIM_RECT,
+	CMD_FILL_RECT = TFT_DRIVER_PRIM_FILL_RECT,
+	CMD_CIRCLE = TFT_DRIVER_PRIM_CIRCLE,
+	CMD_FILL_CIRCLE = TFT_DRIVER_PRIM_FILL_CIRCLE,
+	CMD_ELLIPSE = TFT_DRIVER_PRIM_ELLIPSE,
+	CMD_FILL_ELLIPSE = TFT_DRIVER_PRIM_FILL_ELLIPSE,
+	CMD_ROUND_RECT = TFT_DRIVER_PRIM_ROUND_RECT,
+	CMD_FILL_ROUND_RECT = TFT_DRIVER_PRIM_FILL_ROUND_RECT,
+	CMD_TEXT = TFT_DRIVER_PRIM_TEXT,
+	CMD_BLEND_RECT = TFT_DRIVER_PRIM_BLEND_RECT,
+	CMD_LINE_AA = TFT_DRIVER_PRIM_LINE_AA,
+	CMD_CIRCLE_AA = TFT_DRIVER_PRIM_CIRCLE_AA,
+	CMD_BLIT = TFT_DRIVER_PRIM_BLIT,
+} cmd_type_t;
+
+/**
+ * @struct  Drawing command. Text commands are followed by their string, blit
+ *          commands by their image.
+ */
+typedef struct {
+	uint8_t 		type;
+	uint8_t 		font_size;
+	uint16_t 		size; 				/*!< Bytes of command and payload in display list */
+	rect_t 			bbox; 				/*!< Pixels touched, clamped to clip rectangle */
+	uint16_t 		args[6];
+	uint32_t 		color;
+} cmd_t;
+
+/**
+ * @struct  Extent of drawn text.
+ */
+typedef struct {
+	int32_t x_end; 					/*!< Last column touched */
+	int32_t y_end; 					/*!< Last row touched */
+	int32_t x_next; 				/*!< Position after the last character */
+	uint16_t num_chr; 				/*!< Characters drawn */
+} text_extent_t;
+
+/**
+ * @struct  Area of screen ready to be transmitted.
+ */
+typedef struct {
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+	uint16_t *data;
+	uint16_t *buf; 					/*!< Lines buffer the area may be prepared in */
+	uint16_t window_y_end; 			/*!< Last row of the rectangle, panel window covers all of its rows */
+	uint8_t is_continue; 			/*!< Area follows the previous one in the same window */
+} area_t;
+
+/**
+ * @struct  Areas prepared together and sent in order.
+ */
+typedef struct {
+	area_t area[MAX_PARALLEL_BAND];
+	uint8_t num;
+	uint8_t sent; 					/*!< Areas already queued */
+} band_group_t;
+
+/**
+ * @struct  Layer with its color key in panel format.
+ */
+typedef struct {
+	tft_driver_layer_t cfg;
+	uint16_t key;
+} layer_t;
+
+/**
+ * @struct  Queued drawing command. Sequence tells whose turn the slot is: its
+ *          position for the producer claiming it, position + 1 for the consumer.
+ */
+typedef struct {
+	_Atomic uint32_t seq;
+	uint16_t payload_len;
+	cmd_t cmd;
+	uint8_t payload[QUEUE_PAYLOAD_SIZE]; 	/*!< Follows command directly, as in display list */
+} queue_slot_t;
+
+/**
+ * @struct  Bounded lock free queue of drawing commands, any number of
+ *          producers and one consumer.
+ */
+typedef struct {
+	queue_slot_t *slot;
+	uint32_t mask; 					/*!< Slots minus one, number of slots is a power of two */
+	_Atomic uint32_t head; 			/*!< Next position claimed by producers */
+	_Atomic uint32_t tail; 			/*!< Next position taken by consumer, only it writes this */
+	_Atomic uint32_t num_dropped;
+	_Atomic uint32_t max_depth;
+} cmd_queue_t;
+
 /**
  * @struct  TFT driver structure.
  */
 typedef struct tft_driver {
 	uint16_t 				height;
 	uint16_t 				width;
-	tft_driver_spi_trans	func_spi_trans;
-	tft_driver_set_dc		func_set_dc;
-	tft_driver_set_rst 		func_set_rst;
-	tft_driver_delay		func_delay;
+	tft_driver_pixel_format_t pixel_format;
+	tft_driver_render_mode_t render_mode;
+	tft_driver_rotation_t 	rotation;
+	uint8_t 				bytes_per_pixel; 	/*!< 1 for indexed formats, pattern is one byte */
+	uint8_t 				index_bits; 	/*!< Bits per pixel of indexed formats, 0 for RGB */
+	uint16_t 				*index_lut; 	/*!< Panel pixels of every byte value of indexed screen buffer */
+	tft_driver_io_t 		io;
+	const tft_driver_panel_t *panel;
+	tft_driver_spi_queue_trans func_spi_queue_trans;
+	tft_driver_spi_wait_trans func_spi_wait_trans;
 	uint8_t 				*data;
-	lines_t 				lines[MAX_LINE_BUF];
-	uint8_t 				line_idx;
+	lines_t 				*lines;
+	uint8_t 				num_band; 		/*!< Areas per band group */
 	uint8_t 				pause;
 	uint8_t 				is_started;
 	uint16_t 				pos_x;
 	uint16_t 				pos_y;
+	rect_t 					dirty[MAX_DIRTY_RECT];
+	uint8_t 				num_dirty;
+	rect_t 					frame[MAX_DIRTY_RECT];
+	uint8_t 				frame_num_rect;
+	uint8_t 				frame_rect_idx;
+	uint16_t 				frame_y;
+	uint8_t 				frame_gap; 		/*!< Rows were skipped since the last area, its window does not continue */
+	band_group_t 			group[2]; 		/*!< Group on the bus and the one prepared meanwhile */
+	uint8_t 				group_idx;
+	uint8_t 				in_flight; 		/*!< Queued transfers not waited for */
+	tft_driver_run_parallel func_run_parallel;
+	struct tft_driver 		*band_ctx; 		/*!< Handle copy per band, display list replay draws through it */
+	uint8_t 				refresh_busy;
+	glyph_t 				*glyph_cache;
+	uint16_t 				glyph_cache_size;
+	uint32_t 				glyph_cache_hit;
+	uint32_t 				glyph_cache_miss;
+	uint8_t 				glyph_cache_readonly;
+	target_t 				target;
+	uint8_t 				*dl;
+	uint32_t 				dl_size;
+	uint32_t 				dl_len;
+	uint16_t 				scroll_offset; 	/*!< Screen buffer row shown at the top of screen */
+	uint8_t 				scroll_pending;
+	rect_t 					clip; 			/*!< Drawing is limited to this, empty when start is past end */
+	rect_t 					clip_stack[MAX_CLIP_DEPTH];
+	uint8_t 				clip_depth;
+	tft_driver_wait_te 		func_wait_te;
+	uint8_t 				frame_rate; 	/*!< Paced refresh rate, 0 when refresh is not paced */
+	uint8_t 				frame_divider; 	/*!< TE edges per paced refresh */
+	uint8_t 				te_count; 		/*!< TE edges since the last paced refresh, up to frame_divider */
+	uint8_t 				frame_pending; 	/*!< Submitted frame waits for its TE edge */
+	uint32_t 				num_frame_presented;
+	uint32_t 				num_frame_dropped;
+	uint32_t 				*band_hash; 	/*!< Hash of every band as last sent, NULL when unchanged bands are not skipped */
+	uint8_t 				num_hash_band;
+	uint32_t 				band_hash_valid; /*!< Bands whose hash is known, one bit each */
+	uint32_t 				band_changed; 	/*!< Bands of the current frame to be sent */
+	uint32_t 				num_band_hashed;
+	uint32_t 				num_band_skipped;
+	layer_t 				*layer;
+	uint8_t 				*layer_order; 	/*!< Layer indices from the lowest z order up */
+	uint8_t 				num_layer;
+	cmd_queue_t 			*queue; 		/*!< Drawing commands from producer handles */
+	uint8_t 				is_producer; 	/*!< Commands go to the queue instead of being drawn */
+#ifdef TFT_DRIVER_ENABLE_STATS
+	tft_driver_get_time_us 	func_get_time_us;
+	tft_driver_stats_t 		stats;
+	uint8_t 				stats_prim; 	/*!< Primitive written pixels are counted for */
+	uint32_t 				frame_start_us;
+	uint32_t 				frame_prepare_us;
+	uint32_t 				frame_trans_us;
+	uint32_t 				frame_num_pixel; /*!< Pixels sent by current refresh */
+	uint32_t 				first_frame_us; /*!< Start of the first refresh since reset, for average rate */
+#endif
 } tft_driver_t;
 
-static void convert_pixel_to_lines(tft_driver_handle_t handle, int height_idx)
+static void render_area(tft_driver_handle_t handle,
+                        uint16_t x,
+                        uint16_t y,
+                        uint16_t width,
+                        uint16_t height,
+                        uint16_t *data);
+
+static void composite_layers(tft_driver_handle_t handle, area_t *area);
+
+static uint32_t rect_area(const rect_t *rect)
+{
+	return (uint32_t)(rect->x_end - rect->x_start + 1) * (rect->y_end - rect->y_start + 1);
+}
+
+static void rect_union(rect_t *dst, const rect_t *src)
+{
+	if (src->x_start < dst->x_start) dst->x_start = src->x_start;
+	if (src->y_start < dst->y_start) dst->y_start = src->y_start;
+	if (src->x_end > dst->x_end) dst->x_end = src->x_end;
+	if (src->y_end > dst->y_end) dst->y_end = src->y_end;
+}
+
+static void rect_clip(rect_t *dst, const rect_t *src)
+{
+	/* Intersection, empty when a start ends up past its end */
+	if (src->x_start > dst->x_start) dst->x_start = src->x_start;
+	if (src->y_start > dst->y_start) dst->y_start = src->y_start;
+	if (src->x_end < dst->x_end) dst->x_end = src->x_end;
+	if (src->y_end < dst->y_end) dst->y_end = src->y_end;
+}
+
+static uint32_t rect_union_growth(const rect_t *a, const rect_t *b)
+{
+	rect_t merged = *a;
+	rect_union(&merged, b);
+
+	uint32_t area = rect_area(&merged);
+	uint32_t sum = rect_area(a) + rect_area(b);
+
+	return (area > sum) ? (area - sum) : 0;
+}
+
+static void add_dirty(tft_driver_handle_t handle, rect_t rect)
+{
+	/* Hashes of the frame on the bus were taken before this drawing, its bands
+	   may go out with old or new content, so their hashes no longer tell what
+	   the panel shows */
+	if (handle->refresh_busy && (handle->band_hash != NULL))
+	{
+		for (uint8_t band = rect.y_start / SPI_PARALLEL_LINES; band <= rect.y_end / SPI_PARALLEL_LINES; band++)
+		{
+			handle->band_hash_valid &= ~(1UL << band);
+		}
+	}
+
+	/* Merge into existing rectangles while that costs less than an extra window.
+	   A merged rectangle may become mergeable with others, so restart the scan */
+	uint8_t idx = 0;
+	while (idx < handle->num_dirty)
+	{
+		if (rect_union_growth(&handle->dirty[idx], &rect) <= DIRTY_MERGE_SLACK)
+		{
+			rect_union(&rect, &handle->dirty[idx]);
+			handle->dirty[idx] = handle->dirty[--handle->num_dirty];
+			idx = 0;
+		}
+		else
+		{
+			idx++;
+		}
+	}
+
+	if (handle->num_dirty < MAX_DIRTY_RECT)
+	{
+		handle->dirty[handle->num_dirty++] = rect;
+		return;
+	}
+
+	/* List is full, grow the rectangle which gains the least area */
+	uint8_t best = 0;
+	uint32_t best_growth = UINT32_MAX;
+	for (idx = 0; idx < handle->num_dirty; idx++)
+	{
+		uint32_t growth = rect_union_growth(&handle->dirty[idx], &rect);
+		if (growth < best_growth)
+		{
+			best_growth = growth;
+			best = idx;
+		}
+	}
+	rect_union(&handle->dirty[best], &rect);
+}
+
+static void mark_dirty(tft_driver_handle_t handle, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+	/* Panel is already up to date in immediate mode, producers leave damage to the queue consumer */
+	if ((handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE) || handle->is_producer)
+	{
+		return;
+	}
+
+	/* Clamp damage to the screen, drawing outside of it is never transmitted */
+	if (x1 < 0) x1 = 0;
+	if (y1 < 0) y1 = 0;
+	if (x2 >= handle->width) x2 = handle->width - 1;
+	if (y2 >= handle->height) y2 = handle->height - 1;
+	if ((x1 > x2) || (y1 > y2))
+	{
+		return;
+	}
+
+	/* Damage is kept in screen buffer rows, which are panel memory rows as
+	   well. Rows wrapping around the end of the ring become two rectangles */
+	y1 += handle->scroll_offset;
+	y2 += handle->scroll_offset;
+	if (y1 >= handle->height)
+	{
+		y1 -= handle->height;
+		y2 -= handle->height;
+	}
+
+	if (y2 >= handle->height)
+	{
+		rect_t top = {x1, 0, x2, y2 - handle->height};
+		rect_t bottom = {x1, y1, x2, handle->height - 1};
+		add_dirty(handle, top);
+		add_dirty(handle, bottom);
+		return;
+	}
+
+	rect_t rect = {x1, y1, x2, y2};
+	add_dirty(handle, rect);
+}
+
+static uint16_t color_to_565(uint32_t color)
+{
+	/* Convert RGB888 color to byte swapped RGB565 as the panel expects it */
+	uint16_t color_565 = ((color >> 8) & 0xF800) |
+	                     ((color >> 5) & 0x07E0) |
+	                     ((color >> 3) & 0x001F);
+
+	return ((color_565 << 8) & 0xFF00) | ((color_565 >> 8) & 0x00FF);
+}
+
+static void convert_pixel_to_lines(tft_driver_handle_t handle,
+                                   uint16_t x,
+                                   uint16_t y,
+                                   uint16_t width,
+                                   uint16_t height,
+                                   uint16_t *p_desc)
+{
+	/* Full width rows are contiguous, convert them in one run */
+	if (width == handle->width)
+	{
+		color_convert_rgb888_to_rgb565(handle->data + y * handle->width * 3, p_desc, width * height);
+		return;
+	}
+
+	/* Convert pixel data to RGB565 format, rows are packed back to back */
+	for (uint16_t height_idx = 0; height_idx < height; height_idx++) {
+		uint8_t *p_src = handle->data + ((y + height_idx) * handle->width + x) * 3;
+
+		color_convert_rgb888_to_rgb565(p_src, p_desc, width);
+		p_desc += width;
+	}
+}
+
+static uint8_t index_bits_of(tft_driver_pixel_format_t pixel_format)
+{
+	switch (pixel_format)
+	{
+	case TFT_DRIVER_PIXEL_FORMAT_INDEX1:
+		return 1;
+	case TFT_DRIVER_PIXEL_FORMAT_INDEX2:
+		return 2;
+	case TFT_DRIVER_PIXEL_FORMAT_INDEX4:
+		return 4;
+	case TFT_DRIVER_PIXEL_FORMAT_INDEX8:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+static void build_index_lut(tft_driver_handle_t handle, const uint32_t *palette)
+{
+	uint8_t bits = handle->index_bits;
+	uint8_t pixel_per_byte = 8 / bits;
+	uint16_t num_color = 1 << bits;
+	uint16_t color_565[256];
+
+	/* Gray levels from black to white when there is no palette */
+	for (uint16_t idx = 0; idx < num_color; idx++)
+	{
+		uint32_t level = idx * 0xFF / (num_color - 1);
+		color_565[idx] = color_to_565((palette != NULL) ? palette[idx] : level * 0x010101);
+	}
+
+	/* Every byte value maps to all of its pixels, leftmost one in the top bits */
+	for (uint16_t value = 0; value < 256; value++)
+	{
+		for (uint8_t idx = 0; idx < pixel_per_byte; idx++)
+		{
+			uint8_t shift = 8 - bits * (idx + 1);
+			handle->index_lut[value * pixel_per_byte + idx] = color_565[(value >> shift) & (num_color - 1)];
+		}
+	}
+}
+
+static void expand_index(tft_driver_handle_t handle, uint32_t pixel, uint32_t num_pixel, uint16_t *p_desc)
+{
+	const uint16_t *lut = handle->index_lut;
+	uint8_t pixel_per_byte = 8 / handle->index_bits;
+	const uint8_t *src = handle->data + pixel / pixel_per_byte;
+	uint8_t first = pixel % pixel_per_byte;
+
+	/* Pixels of a partly covered first byte one by one */
+	if (first != 0)
+	{
+		for (; (first < pixel_per_byte) && (num_pixel > 0); first++, num_pixel--)
+		{
+			*p_desc++ = lut[*src * pixel_per_byte + first];
+		}
+		src++;
+	}
+
+	/* One lookup per source byte, copy size is known for every format */
+	uint32_t num_byte = num_pixel / pixel_per_byte;
+	switch (handle->index_bits)
+	{
+	case 1:
+		for (uint32_t idx = 0; idx < num_byte; idx++, p_desc += 8)
+		{
+			memcpy(p_desc, &lut[src[idx] * 8], 16);
+		}
+		break;
+	case 2:
+		for (uint32_t idx = 0; idx < num_byte; idx++, p_desc += 4)
+		{
+			memcpy(p_desc, &lut[src[idx] * 4], 8);
+		}
+		break;
+	case 4:
+		for (uint32_t idx = 0; idx < num_byte; idx++, p_desc += 2)
+		{
+			memcpy(p_desc, &lut[src[idx] * 2], 4);
+		}
+		break;
+	default:
+		for (uint32_t idx = 0; idx < num_byte; idx++)
+		{
+			*p_desc++ = lut[src[idx]];
+		}
+		break;
+	}
+	src += num_byte;
+	num_pixel -= num_byte * pixel_per_byte;
+
+	/* Pixels of a partly covered last byte */
+	for (uint8_t idx = 0; idx < num_pixel; idx++)
+	{
+		*p_desc++ = lut[*src * pixel_per_byte + idx];
+	}
+}
+
+static void expand_index_to_lines(tft_driver_handle_t handle,
+                                  uint16_t x,
+                                  uint16_t y,
+                                  uint16_t width,
+                                  uint16_t height,
+                                  uint16_t *p_desc)
+{
+	/* Full width rows are contiguous, expand them in one run */
+	if (width == handle->width)
+	{
+		expand_index(handle, (uint32_t)y * handle->width, (uint32_t)width * height, p_desc);
+		return;
+	}
+
+	/* Expand palette indices to RGB565, rows are packed back to back */
+	for (uint16_t height_idx = 0; height_idx < height; height_idx++) {
+		expand_index(handle, (uint32_t)(y + height_idx) * handle->width + x, width, p_desc);
+		p_desc += width;
+	}
+}
+
+static void copy_pixel_to_lines(tft_driver_handle_t handle,
+                                uint16_t x,
+                                uint16_t y,
+                                uint16_t width,
+                                uint16_t height,
+                                uint16_t *p_desc)
+{
+	/* Screen buffer is already in panel format, only pack rows back to back */
+	for (uint16_t height_idx = 0; height_idx < height; height_idx++) {
+		memcpy(p_desc,
+		       handle->data + ((y + height_idx) * handle->width + x) * 2,
+		       width * sizeof(uint16_t));
+		p_desc += width;
+	}
+}
+
+static void prepare_area(tft_driver_handle_t handle, area_t *area)
+{
+	/* Get panel format data of the area, converted into lines buffer if needed */
+	area->data = area->buf;
+
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+	{
+		/* Nothing is buffered, draw the area from display list */
+		render_area(handle, area->x, area->y, area->width, area->height, area->buf);
+	}
+	else if (handle->pixel_format == TFT_DRIVER_PIXEL_FORMAT_RGB565)
+	{
+		/* Full width rows are contiguous in screen buffer, send them in place */
+		if (area->width == handle->width)
+		{
+			area->data = (uint16_t *)(handle->data + area->y * handle->width * 2);
+		}
+		else
+		{
+			copy_pixel_to_lines(handle, area->x, area->y, area->width, area->height, area->buf);
+		}
+	}
+	else if (handle->index_bits > 0)
+	{
+		/* Look up panel pixels of palette indices */
+		expand_index_to_lines(handle, area->x, area->y, area->width, area->height, area->buf);
+	}
+	else
+	{
+		/* Convert buffer data from RGB888 to RGB565 */
+		convert_pixel_to_lines(handle, area->x, area->y, area->width, area->height, area->buf);
+	}
+
+	/* Layers go over the screen content where they cover the area */
+	if (handle->num_layer > 0)
+	{
+		composite_layers(handle, area);
+	}
+}
+
+static uint16_t scan_order(tft_driver_handle_t handle, const rect_t *rect)
+{
+	/* Panel scans gate lines, screen rows from scroll start on in portrait and columns in landscape */
+	if (handle->rotation == TFT_DRIVER_ROTATION_PORTRAIT)
+	{
+		return (rect->y_start + handle->height - handle->scroll_offset) % handle->height;
+	}
+
+	return rect->x_start;
+}
+
+static void sort_scan_order(tft_driver_handle_t handle)
+{
+	/* Few rectangles, insertion sort */
+	for (uint8_t idx = 1; idx < handle->frame_num_rect; idx++)
+	{
+		rect_t rect = handle->frame[idx];
+		uint16_t order = scan_order(handle, &rect);
+		uint8_t pos = idx;
+		while ((pos > 0) && (scan_order(handle, &handle->frame[pos - 1]) > order))
+		{
+			handle->frame[pos] = handle->frame[pos - 1];
+			pos--;
+		}
+		handle->frame[pos] = rect;
+	}
+}
+
+static uint32_t hash_rotl(uint32_t value, uint8_t shift)
+{
+	return (value << shift) | (value >> (32 - shift));
+}
+
+static uint32_t hash_bytes(const uint8_t *p, uint32_t len)
+{
+	/* xxHash32 with seed 0. Words are loaded with memcpy, data may be unaligned */
+	const uint8_t *end = p + len;
+	uint32_t hash;
+	uint32_t w[4];
+
+	if (len >= 16)
+	{
+		uint32_t v[4] = {HASH_PRIME1 + HASH_PRIME2, HASH_PRIME2, 0, 0 - HASH_PRIME1};
+		for (; p + 16 <= end; p += 16)
+		{
+			memcpy(w, p, 16);
+			for (uint8_t idx = 0; idx < 4; idx++)
+			{
+				v[idx] = hash_rotl(v[idx] + w[idx] * HASH_PRIME2, 13) * HASH_PRIME1;
+			}
+		}
+		hash = hash_rotl(v[0], 1) + hash_rotl(v[1], 7) + hash_rotl(v[2], 12) + hash_rotl(v[3], 18);
+	}
+	else
+	{
+		hash = HASH_PRIME5;
+	}
+	hash += len;
+
+	for (; p + 4 <= end; p += 4)
+	{
+		memcpy(w, p, 4);
+		hash = hash_rotl(hash + w[0] * HASH_PRIME3, 17) * HASH_PRIME4;
+	}
+	for (; p < end; p++)
+	{
+		hash = hash_rotl(hash + *p * HASH_PRIME5, 11) * HASH_PRIME1;
+	}
+
+	hash ^= hash >> 15;
+	hash *= HASH_PRIME2;
+	hash ^= hash >> 13;
+	hash *= HASH_PRIME3;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+static uint32_t hash_band(tft_driver_handle_t handle, uint8_t band)
+{
+	uint32_t y = band * SPI_PARALLEL_LINES;
+	uint32_t num_row = (handle->height - y < SPI_PARALLEL_LINES) ? handle->height - y : SPI_PARALLEL_LINES;
+	uint32_t bits = (handle->index_bits > 0) ? handle->index_bits : handle->bytes_per_pixel * 8;
+
+	/* Rows are contiguous and bands start on a byte, only the last one may end inside one */
+	uint32_t start = (y * handle->width * bits) / 8;
+	uint32_t end = ((y + num_row) * handle->width * bits + 7) / 8;
+
+	return hash_bytes(handle->data + start, end - start);
+}
+
+static void hash_frame(tft_driver_handle_t handle)
+{
+	/* Bands the damage of this frame touches */
+	uint32_t touched = 0;
+	for (uint8_t idx = 0; idx < handle->frame_num_rect; idx++)
+	{
+		for (uint8_t band = handle->frame[idx].y_start / SPI_PARALLEL_LINES;
+		     band <= handle->frame[idx].y_end / SPI_PARALLEL_LINES;
+		     band++)
+		{
+			touched |= 1UL << band;
+		}
+	}
+
+	/* Panel holds what was last sent, a band hashing the same needs no transfer */
+	handle->band_changed = 0;
+	for (uint8_t band = 0; band < handle->num_hash_band; band++)
+	{
+		uint32_t mask = 1UL << band;
+		if (!(touched & mask))
+		{
+			continue;
+		}
+
+		uint32_t hash = hash_band(handle, band);
+		handle->num_band_hashed++;
+		if ((handle->band_hash_valid & mask) && (handle->band_hash[band] == hash))
+		{
+			handle->num_band_skipped++;
+			continue;
+		}
+
+		handle->band_hash[band] = hash;
+		handle->band_hash_valid |= mask;
+		handle->band_changed |= mask;
+	}
+}
+
+static void begin_frame(tft_driver_handle_t handle)
+{
+	/* Take over damage of this frame, drawing from now on belongs to the next one */
+	memcpy(handle->frame, handle->dirty, handle->num_dirty * sizeof(rect_t));
+	handle->frame_num_rect = handle->num_dirty;
+	handle->frame_rect_idx = 0;
+
+	/* Paced frames start at vertical blanking, rectangles go out ahead of the scan */
+	if (handle->frame_divider > 0)
+	{
+		sort_scan_order(handle);
+	}
+	handle->frame_y = handle->frame[0].y_start;
+	handle->frame_gap = false;
+	handle->num_dirty = 0;
+
+	if (handle->band_hash != NULL)
+	{
+		hash_frame(handle);
+	}
+
+#ifdef TFT_DRIVER_ENABLE_STATS
+	uint32_t now = STATS_TIME(handle);
+	if (handle->stats.num_refresh > 0)
+	{
+		handle->stats.frame_interval_us = now - handle->frame_start_us;
+	}
+	else
+	{
+		handle->first_frame_us = now;
+	}
+	handle->frame_start_us = now;
+	handle->frame_prepare_us = 0;
+	handle->frame_trans_us = 0;
+	handle->frame_num_pixel = 0;
+#endif
+}
+
+#ifdef TFT_DRIVER_ENABLE_STATS
+static void end_frame_stats(tft_driver_handle_t handle)
+{
+	tft_driver_stats_t *stats = &handle->stats;
+	uint32_t now = STATS_TIME(handle);
+
+	stats->refresh_time_us = now - handle->frame_start_us;
+	if (stats->refresh_time_us > stats->max_refresh_time_us)
+	{
+		stats->max_refresh_time_us = stats->refresh_time_us;
+	}
+	stats->prepare_time_us = handle->frame_prepare_us;
+	stats->trans_time_us = handle->frame_trans_us;
+	stats->num_pixel_sent += handle->frame_num_pixel;
+	stats->num_pixel_skipped += (uint32_t)handle->width * handle->height - handle->frame_num_pixel;
+	stats->num_refresh++;
+
+	/* Average over all refreshes since reset, the first one starts the period */
+	uint32_t period_us = now - handle->first_frame_us;
+	if (period_us > 0)
+	{
+		stats->fps = (uint64_t)(stats->num_refresh - 1) * 1000000 / period_us;
+	}
+}
+#endif
+
+static void advance_frame(tft_driver_handle_t handle, uint32_t rows)
+{
+	rect_t *rect = &handle->frame[handle->frame_rect_idx];
+
+	/* Move to the next rows, or the next rectangle */
+	if ((uint32_t)handle->frame_y + rows > rect->y_end)
+	{
+		handle->frame_rect_idx++;
+		if (handle->frame_rect_idx < handle->frame_num_rect)
+		{
+			handle->frame_y = handle->frame[handle->frame_rect_idx].y_start;
+		}
+	}
+	else
+	{
+		handle->frame_y += rows;
+	}
+}
+
+static bool skip_unchanged(tft_driver_handle_t handle)
+{
+	/* Move past bands already on the panel, return false when nothing is left */
+	while (handle->frame_rect_idx < handle->frame_num_rect)
+	{
+		uint8_t band = handle->frame_y / SPI_PARALLEL_LINES;
+		if (handle->band_changed & (1UL << band))
+		{
+			return true;
+		}
+
+		handle->frame_gap = true;
+		advance_frame(handle, (band + 1) * SPI_PARALLEL_LINES - handle->frame_y);
+	}
+
+	return false;
+}
+
+static bool plan_area(tft_driver_handle_t handle, area_t *area)
+{
+	if (handle->frame_rect_idx >= handle->frame_num_rect)
+	{
+		return false;
+	}
+
+	if ((handle->band_hash != NULL) && !skip_unchanged(handle))
+	{
+		return false;
+	}
+
+	/* Every area holds as many rows of the rectangle as fit into one lines buffer */
+	rect_t *rect = &handle->frame[handle->frame_rect_idx];
+	uint16_t width = rect->x_end - rect->x_start + 1;
+	uint16_t max_rows = (handle->width * SPI_PARALLEL_LINES) / width;
+	uint16_t rows = rect->y_end - handle->frame_y + 1;
+	if (rows > max_rows)
+	{
+		rows = max_rows;
+	}
+
+	/* Stop before the next band which is skipped */
+	if (handle->band_hash != NULL)
+	{
+		uint32_t end = (handle->frame_y / SPI_PARALLEL_LINES + 1) * SPI_PARALLEL_LINES;
+		while ((end <= rect->y_end) && (handle->band_changed & (1UL << (end / SPI_PARALLEL_LINES))))
+		{
+			end += SPI_PARALLEL_LINES;
+		}
+		if (rows > end - handle->frame_y)
+		{
+			rows = end - handle->frame_y;
+		}
+	}
+
+	area->x = rect->x_start;
+	area->y = handle->frame_y;
+	area->width = width;
+	area->height = rows;
+	area->window_y_end = rect->y_end;
+	area->is_continue = (area->y != rect->y_start) && !handle->frame_gap;
+	handle->frame_gap = false;
+
+	advance_frame(handle, rows);
+
+	return true;
+}
+
+typedef struct {
+	tft_driver_handle_t handle;
+	band_group_t *group;
+} band_job_t;
+
+static void prepare_band_job(void *arg, uint32_t idx)
+{
+	band_job_t *job = arg;
+	tft_driver_handle_t handle = job->handle;
+
+	/* Display list replay changes drawing target, every band draws through its own copy */
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+	{
+		handle = &handle->band_ctx[idx];
+	}
+
+	prepare_area(handle, &job->group->area[idx]);
+}
+
+static bool prepare_group(tft_driver_handle_t handle, uint8_t group_idx)
+{
+	band_group_t *group = &handle->group[group_idx];
+
+	/* Take the next areas of the frame, each group has its own lines buffers */
+	group->num = 0;
+	group->sent = 0;
+	while ((group->num < handle->num_band) && plan_area(handle, &group->area[group->num]))
+	{
+		group->area[group->num].buf = handle->lines[group_idx * handle->num_band + group->num].data;
+		group->num++;
+	}
+
+	if (group->num == 0)
+	{
+		return false;
+	}
+
+	STATS_TIME_START(handle, start);
+
+	/* Areas do not overlap, prepare them on all cores when the port allows it */
+	bool has_ctx = (handle->render_mode != TFT_DRIVER_RENDER_MODE_DISPLAY_LIST) || (handle->band_ctx != NULL);
+	if ((handle->func_run_parallel != NULL) && (group->num > 1) && has_ctx)
+	{
+		band_job_t job = {handle, group};
+
+		if (handle->render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+		{
+			/* Shared glyph cache must not change while bands read it */
+			for (uint8_t idx = 0; idx < group->num; idx++)
+			{
+				handle->band_ctx[idx] = *handle;
+				handle->band_ctx[idx].glyph_cache_readonly = true;
+			}
+		}
+
+		handle->func_run_parallel(prepare_band_job, &job, group->num);
+
+#ifdef TFT_DRIVER_ENABLE_STATS
+		if (handle->render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+		{
+			/* Bands counted pixels into their copies, take over what they added */
+			for (uint8_t prim = 0; prim < TFT_DRIVER_PRIM_MAX; prim++)
+			{
+				uint64_t base = handle->stats.prim[prim].num_pixel;
+				for (uint8_t idx = 0; idx < group->num; idx++)
+				{
+					handle->stats.prim[prim].num_pixel += handle->band_ctx[idx].stats.prim[prim].num_pixel - base;
+				}
+			}
+		}
+#endif
+	}
+	else
+	{
+		for (uint8_t idx = 0; idx < group->num; idx++)
+		{
+			prepare_area(handle, &group->area[idx]);
+		}
+	}
+
+	STATS_TIME_ADD(handle, frame_prepare_us, start);
+
+	return true;
+}
+
+static void panel_fill(tft_driver_handle_t handle,
+                       int32_t x,
+                       int32_t y,
+                       int32_t width,
+                       int32_t height,
+                       const pattern_t *pattern)
+{
+	/* Immediate mode, area is already clipped */
+	uint16_t color_565;
+	memcpy(&color_565, pattern->bytes, sizeof(color_565));
+
+	handle->panel->write_start(&handle->io, x, y, x + width - 1, y + height - 1);
+	handle->panel->write_color(&handle->io, color_565, (uint32_t)width * height);
+}
+
+static uint32_t target_pixel(tft_driver_handle_t handle, int32_t x, int32_t y)
+{
+	target_t *target = &handle->target;
+	int32_t row = y - target->area.y_start + target->y_offset;
+
+	if (row > target->area.y_end - target->area.y_start)
+	{
+		row -= target->area.y_end - target->area.y_start + 1;
+	}
+
+	return row * target->stride + (x - target->area.x_start);
+}
+
+static uint8_t *target_addr(tft_driver_handle_t handle, int32_t x, int32_t y)
+{
+	return handle->target.data + target_pixel(handle, x, y) * handle->bytes_per_pixel;
+}
+
+static int32_t target_rows_to_wrap(tft_driver_handle_t handle, int32_t y)
+{
+	target_t *target = &handle->target;
+	int32_t num_row = target->area.y_end - target->area.y_start + 1;
+	int32_t row = y - target->area.y_start + target->y_offset;
+
+	/* Rows from y which are contiguous in data */
+	return (row >= num_row) ? (2 * num_row - row) : (num_row - row);
+}
+
+static void make_pattern(tft_driver_handle_t handle, uint32_t color, pattern_t *pattern)
+{
+	uint8_t bytes[12];
+
+	if (handle->index_bits > 0)
+	{
+		/* Index repeated over the byte, whole bytes of a run are set at once */
+		uint8_t mask = (1 << handle->index_bits) - 1;
+		pattern->bytes[0] = (color & mask) * (0xFF / mask);
+	}
+	else if (handle->pixel_format == TFT_DRIVER_PIXEL_FORMAT_RGB565)
+	{
+		uint16_t color_565 = color_to_565(color);
+		memcpy(&pattern->bytes[0], &color_565, 2);
+	}
+	else
+	{
+		pattern->bytes[0] = (color >> 16) & 0xFF;
+		pattern->bytes[1] = (color >> 8) & 0xFF;
+		pattern->bytes[2] = (color >> 0) & 0xFF;
+	}
+
+	/* Repeat pixel over 12 bytes, the smallest run of whole words for both formats */
+	for (uint8_t idx = 0; idx < sizeof(bytes); idx++)
+	{
+		bytes[idx] = pattern->bytes[idx % handle->bytes_per_pixel];
+	}
+	memcpy(pattern->words, bytes, sizeof(bytes));
+}
+
+static void fill_row(tft_driver_handle_t handle, uint8_t *p, uint32_t num_pixel, const pattern_t *pattern)
+{
+	uint8_t bpp = handle->bytes_per_pixel;
+
+	/* Single pixels until word aligned, pixel boundary lines up with pattern start */
+	while ((num_pixel > 0) && (((uintptr_t)p & 0x03) != 0))
+	{
+		memcpy(p, pattern->bytes, bpp);
+		p += bpp;
+		num_pixel--;
+	}
+
+	/* Whole words, 3 words hold 4 pixels of RGB888 or 6 pixels of RGB565 */
+	uint32_t *w = (uint32_t *)p;
+	uint8_t pixel_per_group = 12 / bpp;
+	for (; num_pixel >= pixel_per_group; num_pixel -= pixel_per_group)
+	{
+		w[0] = pattern->words[0];
+		w[1] = pattern->words[1];
+		w[2] = pattern->words[2];
+		w += 3;
+	}
+
+	/* Remaining pixels */
+	p = (uint8_t *)w;
+	while (num_pixel > 0)
+	{
+		memcpy(p, pattern->bytes, bpp);
+		p += bpp;
+		num_pixel--;
+	}
+}
+
+static void fill_index(tft_driver_handle_t handle, uint32_t pixel, uint32_t num_pixel, const pattern_t *pattern)
+{
+	uint8_t bits = handle->index_bits;
+	uint8_t pixel_per_byte = 8 / bits;
+	uint8_t *p = handle->target.data + pixel / pixel_per_byte;
+	uint8_t first = pixel % pixel_per_byte;
+
+	/* Partly covered first byte, leftmost pixel is in the top bits */
+	if (first != 0)
+	{
+		uint8_t num = pixel_per_byte - first;
+		if (num > num_pixel)
+		{
+			num = num_pixel;
+		}
+		uint8_t mask = (uint8_t)(0xFF >> (first * bits)) & (uint8_t)(0xFF << ((pixel_per_byte - first - num) * bits));
+		*p = (*p & ~mask) | (pattern->bytes[0] & mask);
+		p++;
+		num_pixel -= num;
+	}
+
+	/* Whole bytes */
+	memset(p, pattern->bytes[0], num_pixel / pixel_per_byte);
+	p += num_pixel / pixel_per_byte;
+
+	/* Partly covered last byte */
+	num_pixel %= pixel_per_byte;
+	if (num_pixel > 0)
+	{
+		uint8_t mask = (uint8_t)(0xFF << ((pixel_per_byte - num_pixel) * bits));
+		*p = (*p & ~mask) | (pattern->bytes[0] & mask);
+	}
+}
+
+static void fill_span(tft_driver_handle_t handle, int32_t x, int32_t y, uint32_t num_pixel, const pattern_t *pattern)
+{
+	/* Indexed pixels share bytes, they are set by bit position */
+	if (handle->index_bits > 0)
+	{
+		fill_index(handle, target_pixel(handle, x, y), num_pixel, pattern);
+		return;
+	}
+
+	fill_row(handle, target_addr(handle, x, y), num_pixel, pattern);
+}
+
+static bool clip_hspan(tft_driver_handle_t handle, int32_t *x, int32_t y, int32_t *len)
+{
+	rect_t *clip = &handle->target.clip;
+
+	/* Clip to target */
+	if ((y < clip->y_start) || (y > clip->y_end))
+	{
+		return false;
+	}
+	if (*x < clip->x_start)
+	{
+		*len -= clip->x_start - *x;
+		*x = clip->x_start;
+	}
+	if (*x + *len > clip->x_end + 1)
+	{
+		*len = clip->x_end + 1 - *x;
+	}
+
+	return *len > 0;
+}
+
+static void write_hspan(tft_driver_handle_t handle, int32_t x, int32_t y, int32_t len, const pattern_t *pattern)
+{
+	if (!clip_hspan(handle, &x, y, &len))
+	{
+		return;
+	}
+	STATS_PIXEL(handle, len);
+
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE)
+	{
+		panel_fill(handle, x, y, len, 1, pattern);
+		return;
+	}
+
+	fill_span(handle, x, y, len, pattern);
+}
+
+static void write_vspan(tft_driver_handle_t handle, int32_t x, int32_t y, int32_t len, const pattern_t *pattern)
+{
+	rect_t *clip = &handle->target.clip;
+
+	/* Clip to target */
+	if ((x < clip->x_start) || (x > clip->x_end))
+	{
+		return;
+	}
+	if (y < clip->y_start)
+	{
+		len -= clip->y_start - y;
+		y = clip->y_start;
+	}
+	if (y + len > clip->y_end + 1)
+	{
+		len = clip->y_end + 1 - y;
+	}
+	if (len <= 0)
+	{
+		return;
+	}
+	STATS_PIXEL(handle, len);
+
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE)
+	{
+		panel_fill(handle, x, y, 1, len, pattern);
+		return;
+	}
+
+	if (handle->index_bits > 0)
+	{
+		for (int32_t row = 0; row < len; row++)
+		{
+			fill_span(handle, x, y + row, 1, pattern);
+		}
+		return;
+	}
+
+	uint8_t bpp = handle->bytes_per_pixel;
+	uint32_t stride = handle->target.stride * bpp;
+
+	while (len > 0)
+	{
+		/* Rows up to the end of the ring are contiguous */
+		int32_t num_row = target_rows_to_wrap(handle, y);
+		if (num_row > len)
+		{
+			num_row = len;
+		}
+
+		uint8_t *p = target_addr(handle, x, y);
+		for (int32_t row = 0; row < num_row; row++)
+		{
+			memcpy(p, pattern->bytes, bpp);
+			p += stride;
+		}
+
+		y += num_row;
+		len -= num_row;
+	}
+}
+
+static void fill_rect(tft_driver_handle_t handle,
+                      int32_t x,
+                      int32_t y,
+                      int32_t width,
+                      int32_t height,
+                      const pattern_t *pattern)
+{
+	rect_t *clip = &handle->target.clip;
+
+	/* Clip once, rows below are known to be inside the target */
+	if (x < clip->x_start)
+	{
+		width -= clip->x_start - x;
+		x = clip->x_start;
+	}
+	if (y < clip->y_start)
+	{
+		height -= clip->y_start - y;
+		y = clip->y_start;
+	}
+	if (x + width > clip->x_end + 1)
+	{
+		width = clip->x_end + 1 - x;
+	}
+	if (y + height > clip->y_end + 1)
+	{
+		height = clip->y_end + 1 - y;
+	}
+	if ((width <= 0) || (height <= 0))
+	{
+		return;
+	}
+	STATS_PIXEL(handle, (uint32_t)width * height);
+
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE)
+	{
+		panel_fill(handle, x, y, width, height, pattern);
+		return;
+	}
+
+	while (height > 0)
+	{
+		/* Rows up to the end of the ring are contiguous */
+		int32_t num_row = target_rows_to_wrap(handle, y);
+		if (num_row > height)
+		{
+			num_row = height;
+		}
+
+		/* Full width rows are contiguous, fill them as one run */
+		if (width == handle->target.stride)
+		{
+			fill_span(handle, x, y, (uint32_t)width * num_row, pattern);
+		}
+		else
+		{
+			for (int32_t row = 0; row < num_row; row++)
+			{
+				fill_span(handle, x, y + row, width, pattern);
+			}
+		}
+
+		y += num_row;
+		height -= num_row;
+	}
+}
+
+static void plot_pixel(tft_driver_handle_t handle, int32_t x, int32_t y, const pattern_t *pattern)
+{
+	rect_t *clip = &handle->target.clip;
+
+	if ((x < clip->x_start) || (y < clip->y_start) || (x > clip->x_end) || (y > clip->y_end))
+	{
+		return;
+	}
+	STATS_PIXEL(handle, 1);
+
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE)
+	{
+		panel_fill(handle, x, y, 1, 1, pattern);
+		return;
+	}
+
+	if (handle->index_bits > 0)
+	{
+		fill_span(handle, x, y, 1, pattern);
+		return;
+	}
+
+	memcpy(target_addr(handle, x, y), pattern->bytes, handle->bytes_per_pixel);
+}
+
+static uint8_t clip_outcode(const rect_t *clip, int32_t x, int32_t y)
+{
+	/* Cohen-Sutherland region code, one bit per clip edge the point is beyond */
+	uint8_t code = 0;
+
+	if (x < clip->x_start) code |= 0x01;
+	if (x > clip->x_end) code |= 0x02;
+	if (y < clip->y_start) code |= 0x04;
+	if (y > clip->y_end) code |= 0x08;
+
+	return code;
+}
+
+static int64_t div_ceil(int64_t num, int64_t den)
+{
+	/* Denominator is positive */
+	return (num >= 0) ? (num + den - 1) / den : -(-num / den);
+}
+
+static void write_line_run(tft_driver_handle_t handle,
+                           bool steep,
+                           int32_t major1,
+                           int32_t major2,
+                           int32_t minor,
+                           const pattern_t *pattern)
+{
+	int32_t first = (major1 < major2) ? major1 : major2;
+	int32_t len = abs(major2 - major1) + 1;
+
+	if (steep)
+	{
+		write_vspan(handle, minor, first, len, pattern);
+	}
+	else
+	{
+		write_hspan(handle, first, minor, len, pattern);
+	}
+}
+
+static void write_line(tft_driver_handle_t handle, int32_t x1, int32_t y1, int32_t x2, int32_t y2, const pattern_t *pattern)
+{
+	rect_t *clip = &handle->target.clip;
+	uint8_t code1 = clip_outcode(clip, x1, y1);
+	uint8_t code2 = clip_outcode(clip, x2, y2);
+
+	/* Trivial reject, both ends are beyond the same edge */
+	if (code1 & code2)
+	{
+		return;
+	}
+
+	/* Bresenham walks the major axis one step at a time. Step k is at minor
+	   offset (2 * k * d + len - 1) / (2 * len), ties round toward the start */
+	bool steep = abs(y2 - y1) > abs(x2 - x1);
+	int32_t major = steep ? y1 : x1;
+	int32_t minor = steep ? x1 : y1;
+	int32_t major_sign = ((steep ? y2 : x2) < major) ? -1 : 1;
+	int32_t minor_sign = ((steep ? x2 : y2) < minor) ? -1 : 1;
+	int32_t len = abs((steep ? y2 : x2) - major);
+	int32_t d = abs((steep ? x2 : y2) - minor);
+
+	if (len == 0)
+	{
+		plot_pixel(handle, x1, y1, pattern);
+		return;
+	}
+
+	int32_t k_start = 0;
+	int32_t k_end = len;
+
+	/* Partly outside, keep the steps inside clip. Moving end points onto the
+	   edges instead would shift pixels, and bands of one line would not match */
+	if (code1 | code2)
+	{
+		int32_t major_lo = steep ? clip->y_start : clip->x_start;
+		int32_t major_hi = steep ? clip->y_end : clip->x_end;
+		int32_t minor_lo = steep ? clip->x_start : clip->y_start;
+		int32_t minor_hi = steep ? clip->x_end : clip->y_end;
+
+		int32_t lo = (major_sign > 0) ? major_lo - major : major - major_hi;
+		int32_t hi = (major_sign > 0) ? major_hi - major : major - major_lo;
+		if (lo > k_start) k_start = lo;
+		if (hi < k_end) k_end = hi;
+
+		/* Minor offset only grows with k, solve the step formula for both bounds */
+		lo = (minor_sign > 0) ? minor_lo - minor : minor - minor_hi;
+		hi = (minor_sign > 0) ? minor_hi - minor : minor - minor_lo;
+		if ((hi < 0) || (lo > d))
+		{
+			return;
+		}
+		if (lo > 0)
+		{
+			int32_t k = div_ceil(2LL * len * lo - len + 1, 2LL * d);
+			if (k > k_start) k_start = k;
+		}
+		if (hi < d)
+		{
+			int32_t k = div_ceil(2LL * len * (hi + 1) - len + 1, 2LL * d) - 1;
+			if (k < k_end) k_end = k;
+		}
+		if (k_start > k_end)
+		{
+			return;
+		}
+	}
+
+	/* Offset at first step, remainder tells when it moves next */
+	int64_t num = 2LL * k_start * d + len - 1;
+	int32_t offset = (int32_t)(num / (2 * len));
+	int32_t rem = (int32_t)(num % (2 * len));
+	int32_t run_start = k_start;
+
+	/* Steps at the same offset form one span */
+	for (int32_t k = k_start; k <= k_end; k++)
+	{
+		rem += 2 * d;
+		if ((rem >= 2 * len) || (k == k_end))
+		{
+			write_line_run(handle, steep, major + major_sign * run_start, major + major_sign * k,
+			               minor + minor_sign * offset, pattern);
+			run_start = k + 1;
+		}
+		if (rem >= 2 * len)
+		{
+			rem -= 2 * len;
+			offset++;
+		}
+	}
+}
+
+static int32_t clamp_corner_radius(int32_t width, int32_t height, int32_t radius)
+{
+	/* Opposite corners must not cross each other */
+	int32_t max_radius = (((width < height) ? width : height) - 1) / 2;
+
+	return (radius > max_radius) ? max_radius : radius;
+}
+
+static void write_round_rect(tft_driver_handle_t handle,
+                             int32_t x,
+                             int32_t y,
+                             int32_t width,
+                             int32_t height,
+                             int32_t radius,
+                             const pattern_t *pattern)
+{
+	/* Corner arc centers */
+	int32_t cx_left = x + radius;
+	int32_t cx_right = x + width - 1 - radius;
+	int32_t cy_top = y + radius;
+	int32_t cy_bottom = y + height - 1 - radius;
+
+	/* Straight edges between corners */
+	write_hspan(handle, cx_left + 1, y, cx_right - cx_left - 1, pattern);
+	write_hspan(handle, cx_left + 1, y + height - 1, cx_right - cx_left - 1, pattern);
+	write_vspan(handle, x, cy_top + 1, cy_bottom - cy_top - 1, pattern);
+	write_vspan(handle, x + width - 1, cy_top + 1, cy_bottom - cy_top - 1, pattern);
+
+	/* Midpoint circle over one octant, mirrored into both octants of each corner.
+	   Steps sharing py are one span, horizontal in one octant and vertical in the other */
+	int32_t px = 0;
+	int32_t py = radius;
+	int32_t d = 1 - radius;
+	int32_t run_start = 0;
+
+	while (px <= py) {
+		bool is_last = (px + 1 > py - ((d < 0) ? 0 : 1));
+
+		if ((d >= 0) || is_last) {
+			int32_t len = px - run_start + 1;
+			write_hspan(handle, cx_right + run_start, cy_bottom + py, len, pattern);
+			write_hspan(handle, cx_left - px, cy_bottom + py, len, pattern);
+			write_hspan(handle, cx_right + run_start, cy_top - py, len, pattern);
+			write_hspan(handle, cx_left - px, cy_top - py, len, pattern);
+			write_vspan(handle, cx_right + py, cy_bottom + run_start, len, pattern);
+			write_vspan(handle, cx_left - py, cy_bottom + run_start, len, pattern);
+			write_vspan(handle, cx_right + py, cy_top - px, len, pattern);
+			write_vspan(handle, cx_left - py, cy_top - px, len, pattern);
+			run_start = px + 1;
+		}
+
+		if (d < 0) {
+			d += 2 * px + 3;
+		} else {
+			d += 2 * (px - py) + 5;
+			py--;
+		}
+		px++;
+	}
+}
+
+static void fill_round_rect(tft_driver_handle_t handle,
+                            int32_t x,
+                            int32_t y,
+                            int32_t width,
+                            int32_t height,
+                            int32_t radius,
+                            const pattern_t *pattern)
+{
+	/* Corner arc centers */
+	int32_t cx_left = x + radius;
+	int32_t cx_right = x + width - 1 - radius;
+	int32_t cy_top = y + radius;
+	int32_t cy_bottom = y + height - 1 - radius;
+
+	/* Rows between corners */
+	fill_rect(handle, x, cy_top + 1, width, cy_bottom - cy_top - 1, pattern);
+
+	/* Midpoint circle gives the half width of every corner row, each row is one span */
+	int32_t px = 0;
+	int32_t py = radius;
+	int32_t d = 1 - radius;
+
+	while (px <= py) {
+		/* Row px away from centers spans py around them */
+		write_hspan(handle, cx_left - py, cy_top - px, cx_right - cx_left + 2 * py + 1, pattern);
+		if (cy_bottom + px != cy_top - px) {
+			write_hspan(handle, cx_left - py, cy_bottom + px, cx_right - cx_left + 2 * py + 1, pattern);
+		}
+
+		if (d < 0) {
+			d += 2 * px + 3;
+		} else {
+			/* Row py away is final once py is about to move */
+			if (px != py) {
+				write_hspan(handle, cx_left - px, cy_top - py, cx_right - cx_left + 2 * px + 1, pattern);
+				write_hspan(handle, cx_left - px, cy_bottom + py, cx_right - cx_left + 2 * px + 1, pattern);
+			}
+			d += 2 * (px - py) + 5;
+			py--;
+		}
+		px++;
+	}
+}
+
+static void ellipse_row(tft_driver_handle_t handle,
+                        int32_t x_origin,
+                        int32_t y_origin,
+                        int32_t x,
+                        int32_t y,
+                        const pattern_t *pattern)
+{
+	write_hspan(handle, x_origin - x, y_origin + y, 2 * x + 1, pattern);
+	if (y != 0) {
+		write_hspan(handle, x_origin - x, y_origin - y, 2 * x + 1, pattern);
+	}
+}
+
+static void ellipse_hspans(tft_driver_handle_t handle,
+                           int32_t x_origin,
+                           int32_t y_origin,
+                           int32_t x_start,
+                           int32_t x_end,
+                           int32_t y,
+                           const pattern_t *pattern)
+{
+	/* Outline span mirrored into 4 quadrants */
+	int32_t len = x_end - x_start + 1;
+
+	write_hspan(handle, x_origin + x_start, y_origin + y, len, pattern);
+	write_hspan(handle, x_origin - x_end, y_origin + y, len, pattern);
+	write_hspan(handle, x_origin + x_start, y_origin - y, len, pattern);
+	write_hspan(handle, x_origin - x_end, y_origin - y, len, pattern);
+}
+
+static void ellipse_vspans(tft_driver_handle_t handle,
+                           int32_t x_origin,
+                           int32_t y_origin,
+                           int32_t x,
+                           int32_t y_start,
+                           int32_t y_end,
+                           const pattern_t *pattern)
+{
+	int32_t len = y_end - y_start + 1;
+
+	write_vspan(handle, x_origin + x, y_origin + y_start, len, pattern);
+	write_vspan(handle, x_origin - x, y_origin + y_start, len, pattern);
+	write_vspan(handle, x_origin + x, y_origin - y_end, len, pattern);
+	write_vspan(handle, x_origin - x, y_origin - y_end, len, pattern);
+}
+
+static void draw_ellipse(tft_driver_handle_t handle,
+                         int32_t x_origin,
+                         int32_t y_origin,
+                         int32_t x_radius,
+                         int32_t y_radius,
+                         const pattern_t *pattern,
+                         bool fill)
+{
+	/* Flat ellipses are lines, the decision terms below do not cover them */
+	if (y_radius == 0) {
+		write_hspan(handle, x_origin - x_radius, y_origin, 2 * x_radius + 1, pattern);
+		return;
+	}
+	if (x_radius == 0) {
+		write_vspan(handle, x_origin, y_origin - y_radius, 2 * y_radius + 1, pattern);
+		return;
+	}
+
+	int64_t a2 = (int64_t)x_radius * x_radius;
+	int64_t b2 = (int64_t)y_radius * y_radius;
+	int32_t x = 0;
+	int32_t y = y_radius;
+	int64_t dx = 0;
+	int64_t dy = 2 * a2 * y;
+
+	/* Region 1, x moves every step. Decision terms are scaled by 4 to stay integer.
+	   Outline steps sharing a row are one span */
+	int64_t d = 4 * b2 - 4 * a2 * y_radius + a2;
+	int32_t run_start = 0;
+	while (dx < dy) {
+		int32_t y_run = y;
+
+		x++;
+		dx += 2 * b2;
+		if (d < 0) {
+			d += 4 * (dx + b2);
+		} else {
+			/* Row is complete, its widest point was the previous one */
+			if (fill) {
+				ellipse_row(handle, x_origin, y_origin, x - 1, y, pattern);
+			}
+			y--;
+			dy -= 2 * a2;
+			d += 4 * (dx - dy + b2);
+		}
+
+		if (!fill && ((y != y_run) || (dx >= dy))) {
+			ellipse_hspans(handle, x_origin, y_origin, run_start, x - 1, y_run, pattern);
+			run_start = x;
+		}
+	}
+
+	/* Region 2, y moves every step. Outline steps sharing a column are one span */
+	d = b2 * (2 * x + 1) * (2 * x + 1) + 4 * a2 * (y - 1) * (y - 1) - 4 * a2 * b2;
+	int32_t run_top = y;
+	while (y >= 0) {
+		int32_t x_run = x;
+
+		if (fill) {
+			ellipse_row(handle, x_origin, y_origin, x, y, pattern);
+		}
+
+		y--;
+		dy -= 2 * a2;
+		if (d > 0) {
+			d += 4 * (a2 - dy);
+		} else {
+			x++;
+			dx += 2 * b2;
+			d += 4 * (dx - dy + a2);
+		}
+
+		if (!fill && ((x != x_run) || (y < 0))) {
+			ellipse_vspans(handle, x_origin, y_origin, x_run, y + 1, run_top, pattern);
+			run_top = y;
+		}
+	}
+}
+
+static uint16_t blend_565(uint16_t pixel, uint32_t src, uint32_t inv)
+{
+	/* Spread byte swapped pixel to 0x07E0F81F so every channel has 5 spare bits
+	   above it, then blend all three channels with one multiply */
+	uint32_t v = (uint16_t)((pixel << 8) | (pixel >> 8));
+	v = (v | (v << 16)) & 0x07E0F81F;
+	v = ((v * inv + src) >> 5) & 0x07E0F81F;
+	v = (v | (v >> 16)) & 0xFFFF;
+
+	return (uint16_t)((v << 8) | (v >> 8));
+}
+
+static uint32_t blend_565_pair(uint32_t pair, uint64_t src, uint32_t inv)
+{
+	/* Same lane split for two pixels at once, each gets 32 bits of a 64 bit
+	   word so one multiply blends both */
+	pair = ((pair & 0x00FF00FF) << 8) | ((pair >> 8) & 0x00FF00FF);
+	uint64_t v = (uint64_t)(pair & 0xFFFF) | ((uint64_t)(pair >> 16) << 32);
+	v = (v | (v << 16)) & 0x07E0F81F07E0F81FULL;
+	v = ((v * inv + src) >> 5) & 0x07E0F81F07E0F81FULL;
+	v = (v | (v >> 16)) & 0x0000FFFF0000FFFFULL;
+	pair = (uint32_t)v | ((uint32_t)(v >> 32) << 16);
+
+	return ((pair & 0x00FF00FF) << 8) | ((pair >> 8) & 0x00FF00FF);
+}
+
+static void composite_span(const layer_t *layer, uint16_t *dst, const uint16_t *src, uint32_t num_pixel)
+{
+	const tft_driver_layer_t *cfg = &layer->cfg;
+
+	/* Opaque layer without transparent pixels is copied as is */
+	if ((cfg->alpha == 255) && !cfg->use_color_key)
+	{
+		memcpy(dst, src, num_pixel * sizeof(uint16_t));
+		return;
+	}
+
+	/* 32 alpha levels as for blending into RGB565 screen buffer */
+	uint32_t a = (cfg->alpha + 4) >> 3;
+	for (uint32_t idx = 0; idx < num_pixel; idx++)
+	{
+		if (cfg->use_color_key && (src[idx] == layer->key))
+		{
+			continue;
+		}
+		if (a >= 32)
+		{
+			dst[idx] = src[idx];
+			continue;
+		}
+
+		uint16_t color = (src[idx] << 8) | (src[idx] >> 8);
+		dst[idx] = blend_565(dst[idx], (((uint32_t)color | ((uint32_t)color << 16)) & 0x07E0F81F) * a, 32 - a);
+	}
+}
+
+static void composite_rows(tft_driver_handle_t handle, area_t *area, uint16_t row, int32_t screen_y, uint16_t num_row)
+{
+	for (uint8_t order = 0; order < handle->num_layer; order++)
+	{
+		const layer_t *layer = &handle->layer[handle->layer_order[order]];
+		const tft_driver_layer_t *cfg = &layer->cfg;
+		if (!cfg->visible || (cfg->alpha < 4))
+		{
+			continue;
+		}
+
+		/* Only the part of the layer inside these rows is touched */
+		int32_t x1 = (cfg->x > area->x) ? cfg->x : area->x;
+		int32_t x2 = ((int32_t)cfg->x + cfg->width < area->x + area->width) ? cfg->x + cfg->width : area->x + area->width;
+		int32_t y1 = (cfg->y > screen_y) ? cfg->y : screen_y;
+		int32_t y2 = ((int32_t)cfg->y + cfg->height < screen_y + num_row) ? cfg->y + cfg->height : screen_y + num_row;
+		if ((x1 >= x2) || (y1 >= y2))
+		{
+			continue;
+		}
+
+		/* Full width rows may be sent from the screen buffer in place, which must not change */
+		if (area->data != area->buf)
+		{
+			memcpy(area->buf, area->data, (uint32_t)area->width * area->height * sizeof(uint16_t));
+			area->data = area->buf;
+		}
+
+		for (int32_t y = y1; y < y2; y++) {
+			composite_span(layer,
+			               area->data + (row + y - screen_y) * area->width + (x1 - area->x),
+			               cfg->data + (y - cfg->y) * cfg->width + (x1 - cfg->x),
+			               x2 - x1);
+		}
+	}
+}
+
+static void composite_layers(tft_driver_handle_t handle, area_t *area)
+{
+	/* Area holds screen buffer rows, which are screen rows shifted by the
+	   scroll offset. They wrap around the end of the screen once at most */
+	int32_t screen_y = (int32_t)area->y - handle->scroll_offset;
+	if (screen_y < 0)
+	{
+		screen_y += handle->height;
+	}
+
+	uint16_t row = 0;
+	while (row < area->height)
+	{
+		uint16_t num_row = area->height - row;
+		if (screen_y + num_row > handle->height)
+		{
+			num_row = handle->height - screen_y;
+		}
+
+		composite_rows(handle, area, row, screen_y, num_row);
+		row += num_row;
+		screen_y = 0;
+	}
+}
+
+static void blend_row(tft_driver_handle_t handle, uint8_t *p, uint32_t num_pixel, const pattern_t *pattern, uint16_t alpha)
+{
+	if (handle->pixel_format == TFT_DRIVER_PIXEL_FORMAT_RGB565)
+	{
+		/* Channels have at most 6 bits, 32 alpha levels are enough */
+		uint16_t color;
+		memcpy(&color, pattern->bytes, sizeof(color));
+		color = (color << 8) | (color >> 8);
+
+		uint32_t a = (alpha + 4) >> 3;
+		uint32_t src = (((uint32_t)color | ((uint32_t)color << 16)) & 0x07E0F81F) * a;
+		uint16_t *q = (uint16_t *)p;
+
+		/* Single pixel until word aligned */
+		if ((num_pixel > 0) && (((uintptr_t)q & 0x03) != 0))
+		{
+			q[0] = blend_565(q[0], src, 32 - a);
+			q++;
+			num_pixel--;
+		}
+
+		/* Two pixels per 32 bit word and per multiply */
+		uint64_t src_pair = (uint64_t)src | ((uint64_t)src << 32);
+		uint32_t *w = (uint32_t *)q;
+		for (; num_pixel >= 2; num_pixel -= 2)
+		{
+			*w = blend_565_pair(*w, src_pair, 32 - a);
+			w++;
+		}
+		if (num_pixel > 0)
+		{
+			q = (uint16_t *)w;
+			q[0] = blend_565(q[0], src, 32 - a);
+		}
+
+		return;
+	}
+
+	uint32_t inv = 256 - alpha;
+
+	/* Single pixels until word aligned, pixel boundary lines up with pattern start */
+	while ((num_pixel > 0) && (((uintptr_t)p & 0x03) != 0))
+	{
+		for (uint8_t idx = 0; idx < 3; idx++)
+		{
+			p[idx] = (p[idx] * inv + pattern->bytes[idx] * alpha) >> 8;
+		}
+		p += 3;
+		num_pixel--;
+	}
+
+	/* Even and odd bytes of a word are blended as two 16 bit lanes each, so
+	   3 words hold 4 pixels. Weights sum to 256, lanes never overflow */
+	uint32_t src_even[3];
+	uint32_t src_odd[3];
+	for (uint8_t idx = 0; idx < 3; idx++)
+	{
+		src_even[idx] = (pattern->words[idx] & 0x00FF00FF) * alpha;
+		src_odd[idx] = ((pattern->words[idx] >> 8) & 0x00FF00FF) * alpha;
+	}
+
+	uint32_t *w = (uint32_t *)p;
+	for (; num_pixel >= 4; num_pixel -= 4)
+	{
+		for (uint8_t idx = 0; idx < 3; idx++)
+		{
+			uint32_t even = (((w[idx] & 0x00FF00FF) * inv + src_even[idx]) >> 8) & 0x00FF00FF;
+			uint32_t odd = (((w[idx] >> 8) & 0x00FF00FF) * inv + src_odd[idx]) & 0xFF00FF00;
+			w[idx] = even | odd;
+		}
+		w += 3;
+	}
+
+	/* Remaining pixels */
+	p = (uint8_t *)w;
+	while (num_pixel > 0)
+	{
+		for (uint8_t idx = 0; idx < 3; idx++)
+		{
+			p[idx] = (p[idx] * inv + pattern->bytes[idx] * alpha) >> 8;
+		}
+		p += 3;
+		num_pixel--;
+	}
+}
+
+static uint16_t alpha_scale(uint32_t argb, uint8_t coverage)
+{
+	/* 8 bit alpha times 8 bit coverage, result 0 to 256 so opaque needs no division */
+	uint32_t alpha = argb >> 24;
+	alpha += alpha >> 7;
+
+	return (alpha * (coverage + (coverage >> 7))) >> 8;
+}
+
+static void blend_span(tft_driver_handle_t handle, int32_t x, int32_t y, int32_t len, const pattern_t *pattern, uint16_t alpha)
+{
+	/* Span is inside clip */
+	if (alpha == 0)
+	{
+		return;
+	}
+	STATS_PIXEL(handle, len);
+
+	/* Opaque spans need no read back. Indexed pixels can not be mixed, half coverage draws them */
+	if ((alpha >= 256) || ((handle->index_bits > 0) && (alpha >= 128)))
+	{
+		fill_span(handle, x, y, len, pattern);
+		return;
+	}
+	if (handle->index_bits > 0)
+	{
+		return;
+	}
+
+	blend_row(handle, target_addr(handle, x, y), len, pattern, alpha);
+}
+
+static void blend_hspan(tft_driver_handle_t handle, int32_t x, int32_t y, int32_t len, const pattern_t *pattern, uint16_t alpha)
+{
+	if (clip_hspan(handle, &x, y, &len))
+	{
+		blend_span(handle, x, y, len, pattern, alpha);
+	}
+}
+
+static void blend_point(tft_driver_handle_t handle, int32_t x, int32_t y, const pattern_t *pattern, uint16_t alpha, bool is_inside)
+{
+	/* Primitives known to be inside clip skip the check */
+	if (is_inside)
+	{
+		blend_span(handle, x, y, 1, pattern, alpha);
+	}
+	else
+	{
+		blend_hspan(handle, x, y, 1, pattern, alpha);
+	}
+}
+
+static void blend_rect(tft_driver_handle_t handle,
+                       int32_t x,
+                       int32_t y,
+                       int32_t width,
+                       int32_t height,
+                       const pattern_t *pattern,
+                       uint16_t alpha)
+{
+	rect_t *clip = &handle->target.clip;
+
+	/* Clip once as fill_rect does, rows below are known to be inside the target */
+	if (x < clip->x_start)
+	{
+		width -= clip->x_start - x;
+		x = clip->x_start;
+	}
+	if (y < clip->y_start)
+	{
+		height -= clip->y_start - y;
+		y = clip->y_start;
+	}
+	if (x + width > clip->x_end + 1)
+	{
+		width = clip->x_end + 1 - x;
+	}
+	if (y + height > clip->y_end + 1)
+	{
+		height = clip->y_end + 1 - y;
+	}
+
+	for (int32_t row = 0; row < height; row++)
+	{
+		if (width <= 0)
+		{
+			break;
+		}
+		blend_span(handle, x, y + row, width, pattern, alpha);
+	}
+}
+
+static void write_line_aa(tft_driver_handle_t handle,
+                          int32_t x1,
+                          int32_t y1,
+                          int32_t x2,
+                          int32_t y2,
+                          const pattern_t *pattern,
+                          uint32_t argb)
+{
+	/* Every pixel lies inside the bounding box of the end points, so the
+	   Cohen-Sutherland trivial reject of write_line holds here as well */
+	rect_t *clip = &handle->target.clip;
+	if (clip_outcode(clip, x1, y1) & clip_outcode(clip, x2, y2))
+	{
+		return;
+	}
+
+	/* Xiaolin Wu, walk the major axis and split coverage between the two
+	   pixels around the exact minor position. Minor position is 16.16 */
+	bool steep = abs(y2 - y1) > abs(x2 - x1);
+	int32_t tmp;
+
+	if (steep)
+	{
+		tmp = x1; x1 = y1; y1 = tmp;
+		tmp = x2; x2 = y2; y2 = tmp;
+	}
+	if (x1 > x2)
+	{
+		tmp = x1; x1 = x2; x2 = tmp;
+		tmp = y1; y1 = y2; y2 = tmp;
+	}
+
+	int32_t dx = x2 - x1;
+	int32_t gradient = (dx == 0) ? 0 : (int32_t)(((int64_t)(y2 - y1) * 65536) / dx);
+	uint16_t alpha = alpha_scale(argb, 0xFF);
+
+	/* End points are on pixel centers, fully covered */
+	blend_hspan(handle, steep ? y1 : x1, steep ? x1 : y1, 1, pattern, alpha);
+	if (dx == 0)
+	{
+		return;
+	}
+	blend_hspan(handle, steep ? y2 : x2, steep ? x2 : y2, 1, pattern, alpha);
+
+	/* Only walk the steps inside clip. Major axis directly, minor position
+	   grows linearly, pixels at y and y + 1 are visible while it is within
+	   one row above the top edge up to the bottom edge */
+	int32_t x_start = x1 + 1;
+	int32_t x_end = x2 - 1;
+	int32_t major_lo = steep ? clip->y_start : clip->x_start;
+	int32_t major_hi = steep ? clip->y_end : clip->x_end;
+	int32_t clip_minor_lo = steep ? clip->x_start : clip->y_start;
+	int32_t clip_minor_hi = steep ? clip->x_end : clip->y_end;
+	int64_t minor_lo = ((int64_t)clip_minor_lo - 1 - y1) * 65536;
+	int64_t minor_hi = ((int64_t)clip_minor_hi + 1 - y1) * 65536 - 1;
+
+	/* Pixels stay between the minor end points, lines within clip skip the check */
+	bool is_inside = (((y1 < y2) ? y1 : y2) >= clip_minor_lo) && (((y1 < y2) ? y2 : y1) <= clip_minor_hi);
+
+	if (x_start < major_lo) x_start = major_lo;
+	if (x_end > major_hi) x_end = major_hi;
+	if (gradient > 0)
+	{
+		int64_t lo = x1 + div_ceil(minor_lo, gradient);
+		int64_t hi = x1 + div_ceil(minor_hi + 1, gradient) - 1;
+		if (lo > x_start) x_start = (int32_t)lo;
+		if (hi < x_end) x_end = (int32_t)hi;
+	}
+	else if (gradient < 0)
+	{
+		int64_t lo = x1 + div_ceil(-minor_hi, -gradient);
+		int64_t hi = x1 + div_ceil(-minor_lo + 1, -gradient) - 1;
+		if (lo > x_start) x_start = (int32_t)lo;
+		if (hi < x_end) x_end = (int32_t)hi;
+	}
+	else if ((minor_lo > 0) || (minor_hi < 0))
+	{
+		return;
+	}
+
+	int64_t intery = (int64_t)y1 * 65536 + (int64_t)gradient * (x_start - x1);
+	for (int32_t x = x_start; x <= x_end; x++)
+	{
+		int32_t y = (int32_t)(intery >> 16);
+		uint8_t frac = (intery >> 8) & 0xFF;
+		uint16_t alpha_low = alpha_scale(argb, 0xFF - frac);
+		uint16_t alpha_high = alpha_scale(argb, frac);
+
+		if (steep)
+		{
+			blend_point(handle, y, x, pattern, alpha_low, is_inside);
+			blend_point(handle, y + 1, x, pattern, alpha_high, is_inside);
+		}
+		else
+		{
+			blend_point(handle, x, y, pattern, alpha_low, is_inside);
+			blend_point(handle, x, y + 1, pattern, alpha_high, is_inside);
+		}
+		intery += gradient;
+	}
+}
+
+static uint32_t isqrt(uint64_t value)
+{
+	/* Bitwise integer square root, rounded down */
+	uint64_t root = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (uint32_t)root;
+}
+
+static void blend_quad(tft_driver_handle_t handle,
+                       int32_t x_origin,
+                       int32_t y_origin,
+                       int32_t x,
+                       int32_t y,
+                       const pattern_t *pattern,
+                       uint16_t alpha,
+                       bool is_inside)
+{
+	/* Mirror into 4 quadrants, points on an axis only once */
+	blend_point(handle, x_origin + x, y_origin + y, pattern, alpha, is_inside);
+	if (x != 0) {
+		blend_point(handle, x_origin - x, y_origin + y, pattern, alpha, is_inside);
+	}
+	if (y != 0) {
+		blend_point(handle, x_origin + x, y_origin - y, pattern, alpha, is_inside);
+	}
+	if ((x != 0) && (y != 0)) {
+		blend_point(handle, x_origin - x, y_origin - y, pattern, alpha, is_inside);
+	}
+}
+
+static void write_circle_aa(tft_driver_handle_t handle,
+                            int32_t x_origin,
+                            int32_t y_origin,
+                            int32_t radius,
+                            const pattern_t *pattern,
+                            uint32_t argb)
+{
+	/* Pixels lie one past the radius at most. Circles missing clip, or
+	   whose ring passes around it, are dropped once here */
+	rect_t *clip = &handle->target.clip;
+	int32_t reach = radius + 1;
+	if ((x_origin + reach < clip->x_start) || (x_origin - reach > clip->x_end) ||
+	    (y_origin + reach < clip->y_start) || (y_origin - reach > clip->y_end))
+	{
+		return;
+	}
+
+	int64_t dx = (x_origin - clip->x_start > clip->x_end - x_origin) ? x_origin - clip->x_start : clip->x_end - x_origin;
+	int64_t dy = (y_origin - clip->y_start > clip->y_end - y_origin) ? y_origin - clip->y_start : clip->y_end - y_origin;
+	if ((radius > 1) && (dx * dx + dy * dy < (int64_t)(radius - 1) * (radius - 1)))
+	{
+		return;
+	}
+
+	/* Circles inside clip need no check per pixel */
+	bool is_inside = (x_origin - reach >= clip->x_start) && (x_origin + reach <= clip->x_end) &&
+	                 (y_origin - reach >= clip->y_start) && (y_origin + reach <= clip->y_end);
+
+	/* Exact height of the circle over every column of one octant, 8.8 fixed
+	   point. Coverage is split between the rows below and above it. Columns
+	   stop at the radius, past it the height is not real */
+	for (int32_t x = 0; x <= radius; x++) {
+		uint32_t yf = isqrt(((uint64_t)radius * radius - (uint64_t)x * x) << 16);
+		int32_t y = yf >> 8;
+		uint8_t frac = yf & 0xFF;
+		if (x > y) {
+			break;
+		}
+
+		uint16_t alpha_in = alpha_scale(argb, 0xFF - frac);
+		uint16_t alpha_out = alpha_scale(argb, frac);
+
+		blend_quad(handle, x_origin, y_origin, x, y, pattern, alpha_in, is_inside);
+		blend_quad(handle, x_origin, y_origin, x, y + 1, pattern, alpha_out, is_inside);
+
+		/* Other octant, its diagonal point is the same pixel */
+		if (x != y) {
+			blend_quad(handle, x_origin, y_origin, y, x, pattern, alpha_in, is_inside);
+		}
+		blend_quad(handle, x_origin, y_origin, y + 1, x, pattern, alpha_out, is_inside);
+	}
+}
+
+static uint32_t image_stride(const tft_driver_image_t *image)
+{
+	/* Rows are packed when stride is not given */
+	if (image->stride != 0)
+	{
+		return image->stride;
+	}
+
+	switch (image->format)
+	{
+	case TFT_DRIVER_IMAGE_FORMAT_RGB565:
+		return (uint32_t)image->width * 2;
+	case TFT_DRIVER_IMAGE_FORMAT_RGB888:
+		return (uint32_t)image->width * 3;
+	default:
+		return ((uint32_t)image->width + 7) / 8;
+	}
+}
+
+static bool image_is_key(const tft_driver_image_t *image, const uint8_t *src, int32_t col, const uint8_t *key)
+{
+	const uint8_t *p;
+
+	switch (image->format)
+	{
+	case TFT_DRIVER_IMAGE_FORMAT_RGB565:
+		p = src + col * 2;
+		return (p[0] == key[0]) && (p[1] == key[1]);
+	case TFT_DRIVER_IMAGE_FORMAT_RGB888:
+		p = src + col * 3;
+		return (p[0] == key[0]) && (p[1] == key[1]) && (p[2] == key[2]);
+	default:
+		return !((src[col >> 3] << (col & 0x07)) & 0x80);
+	}
+}
+
+static int32_t image_next_run(const tft_driver_image_t *image,
+                              const uint8_t *src,
+                              int32_t col,
+                              int32_t col_end,
+                              const uint8_t *key,
+                              bool *is_opaque)
+{
+	/* Without color key the whole row is drawn */
+	if (!image->use_color_key)
+	{
+		*is_opaque = true;
+		return col_end - col;
+	}
+
+	/* Pixels of the same transparency as the first one */
+	bool is_key = image_is_key(image, src, col, key);
+	int32_t end = col + 1;
+	while ((end < col_end) && (image_is_key(image, src, end, key) == is_key))
+	{
+		end++;
+	}
+
+	*is_opaque = !is_key;
+	return end - col;
+}
+
+static void image_convert(tft_driver_handle_t handle,
+                          uint8_t *dst,
+                          const tft_driver_image_t *image,
+                          const uint8_t *src,
+                          int32_t col,
+                          int32_t len,
+                          const pattern_t *fg,
+                          const pattern_t *bg)
+{
+	uint8_t bpp = handle->bytes_per_pixel;
+	const uint8_t *p;
+
+	switch (image->format)
+	{
+	case TFT_DRIVER_IMAGE_FORMAT_RGB565:
+		p = src + col * 2;
+		if (bpp == 2)
+		{
+			memcpy(dst, p, len * 2);
+			break;
+		}
+		/* Expand to RGB888, top bits are repeated into the low ones */
+		for (int32_t idx = 0; idx < len; idx++, p += 2, dst += 3)
+		{
+			uint8_t r = p[0] >> 3;
+			uint8_t g = ((p[0] & 0x07) << 3) | (p[1] >> 5);
+			uint8_t b = p[1] & 0x1F;
+			dst[0] = (r << 3) | (r >> 2);
+			dst[1] = (g << 2) | (g >> 4);
+			dst[2] = (b << 3) | (b >> 2);
+		}
+		break;
+
+	case TFT_DRIVER_IMAGE_FORMAT_RGB888:
+		p = src + col * 3;
+		if (bpp == 3)
+		{
+			memcpy(dst, p, len * 3);
+			break;
+		}
+		for (int32_t idx = 0; idx < len; idx++, p += 3, dst += 2)
+		{
+			uint16_t color_565 = color_to_565(((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]);
+			memcpy(dst, &color_565, 2);
+		}
+		break;
+
+	default:
+		for (int32_t idx = 0; idx < len; idx++, col++, dst += bpp)
+		{
+			bool is_set = (src[col >> 3] << (col & 0x07)) & 0x80;
+			memcpy(dst, is_set ? fg->bytes : bg->bytes, bpp);
+		}
+		break;
+	}
+}
+
+static void panel_blit_run(tft_driver_handle_t handle,
+                           const tft_driver_image_t *image,
+                           const uint8_t *src,
+                           int32_t col,
+                           int32_t len,
+                           const pattern_t *fg,
+                           const pattern_t *bg)
+{
+	/* Panel native pixels are sent straight from the image */
+	if (image->format == TFT_DRIVER_IMAGE_FORMAT_RGB565)
+	{
+		handle->panel->write_pixels(&handle->io, (uint16_t *)(uintptr_t)(src + col * 2), len);
+		return;
+	}
+
+	uint16_t buf[BLIT_CHUNK_PIXELS];
+	while (len > 0)
+	{
+		int32_t num_pixel = (len < BLIT_CHUNK_PIXELS) ? len : BLIT_CHUNK_PIXELS;
+		image_convert(handle, (uint8_t *)buf, image, src, col, num_pixel, fg, bg);
+		handle->panel->write_pixels(&handle->io, buf, num_pixel);
+		col += num_pixel;
+		len -= num_pixel;
+	}
+}
+
+static void blit_index_run(tft_driver_handle_t handle,
+                           const uint8_t *src,
+                           int32_t x,
+                           int32_t row,
+                           int32_t col,
+                           int32_t len,
+                           const pattern_t *fg,
+                           const pattern_t *bg)
+{
+	/* Mono pixels of equal bits are filled as one span */
+	while (len > 0)
+	{
+		bool is_set = (src[col >> 3] << (col & 0x07)) & 0x80;
+		int32_t num = 1;
+		while ((num < len) && ((bool)((src[(col + num) >> 3] << ((col + num) & 0x07)) & 0x80) == is_set))
+		{
+			num++;
+		}
+
+		fill_span(handle, x + col, row, num, is_set ? fg : bg);
+		col += num;
+		len -= num;
+	}
+}
+
+static void blit_row(tft_driver_handle_t handle,
+                     const tft_driver_image_t *image,
+                     const uint8_t *src,
+                     int32_t x,
+                     int32_t row,
+                     int32_t col,
+                     int32_t col_end,
+                     const uint8_t *key,
+                     const pattern_t *fg,
+                     const pattern_t *bg)
+{
+	bool is_immediate = (handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE);
+
+	/* Transparent runs are skipped, opaque ones are copied or converted. Column 0 of src is at x */
+	while (col < col_end)
+	{
+		bool is_opaque;
+		int32_t len = image_next_run(image, src, col, col_end, key, &is_opaque);
+		if (is_opaque)
+		{
+			STATS_PIXEL(handle, len);
+		}
+
+		if (is_opaque && is_immediate)
+		{
+			if (image->use_color_key)
+			{
+				handle->panel->write_start(&handle->io, x + col, row, x + col + len - 1, row);
+			}
+			panel_blit_run(handle, image, src, col, len, fg, bg);
+		}
+		else if (is_opaque && (handle->index_bits > 0))
+		{
+			blit_index_run(handle, src, x, row, col, len, fg, bg);
+		}
+		else if (is_opaque)
+		{
+			image_convert(handle, target_addr(handle, x + col, row), image, src, col, len, fg, bg);
+		}
+		col += len;
+	}
+}
+
+static void blit_rle565(tft_driver_handle_t handle,
+                        int32_t x,
+                        int32_t y,
+                        const rect_t *area,
+                        const tft_driver_image_t *image,
+                        const uint8_t *key,
+                        const pattern_t *fg,
+                        const pattern_t *bg)
+{
+	/* Decoded pixels are plain RGB565 */
+	tft_driver_image_t decoded = *image;
+	decoded.format = TFT_DRIVER_IMAGE_FORMAT_RGB565;
+
+	/* Opaque rows of panel format are decoded straight into target */
+	bool is_direct = (handle->render_mode != TFT_DRIVER_RENDER_MODE_IMMEDIATE) &&
+	                 (handle->bytes_per_pixel == 2) && !image->use_color_key;
+	uint16_t buf[BLIT_CHUNK_PIXELS];
+	rle565_decoder_t decoder;
+
+	/* Stream is sequential, pixels outside of the area are decoded without output */
+	rle565_decoder_init(&decoder, image->data);
+	rle565_decode(&decoder, NULL, (uint32_t)(area->y_start - y) * image->width);
+
+	for (int32_t row = area->y_start; row <= area->y_end; row++)
+	{
+		rle565_decode(&decoder, NULL, area->x_start - x);
+
+		if (is_direct)
+		{
+			rle565_decode(&decoder, target_addr(handle, area->x_start, row), area->x_end - area->x_start + 1);
+			STATS_PIXEL(handle, area->x_end - area->x_start + 1);
+		}
+		else
+		{
+			for (int32_t col = area->x_start; col <= area->x_end; col += BLIT_CHUNK_PIXELS)
+			{
+				int32_t num_pixel = area->x_end - col + 1;
+				if (num_pixel > BLIT_CHUNK_PIXELS)
+				{
+					num_pixel = BLIT_CHUNK_PIXELS;
+				}
+				rle565_decode(&decoder, (uint8_t *)buf, num_pixel);
+				blit_row(handle, &decoded, (const uint8_t *)buf, col, row, 0, num_pixel, key, fg, bg);
+			}
+		}
+
+		rle565_decode(&decoder, NULL, x + image->width - 1 - area->x_end);
+	}
+}
+
+static void blit_image(tft_driver_handle_t handle, int32_t x, int32_t y, const tft_driver_image_t *image)
+{
+	rect_t *clip = &handle->target.clip;
+	int32_t x_start = (x > clip->x_start) ? x : clip->x_start;
+	int32_t y_start = (y > clip->y_start) ? y : clip->y_start;
+	int32_t x_end = x + image->width - 1;
+	int32_t y_end = y + image->height - 1;
+
+	/* Clip to target */
+	if (x_end > clip->x_end) x_end = clip->x_end;
+	if (y_end > clip->y_end) y_end = clip->y_end;
+	if ((x_start > x_end) || (y_start > y_end))
+	{
+		return;
+	}
+
+	pattern_t fg;
+	pattern_t bg;
+	make_pattern(handle, image->color, &fg);
+	make_pattern(handle, image->bg_color, &bg);
+
+	/* Color key in image format, compared byte by byte as data may be unaligned */
+	uint8_t key[3] = {0, 0, 0};
+	if (image->format == TFT_DRIVER_IMAGE_FORMAT_RGB888)
+	{
+		key[0] = (image->color_key >> 16) & 0xFF;
+		key[1] = (image->color_key >> 8) & 0xFF;
+		key[2] = (image->color_key >> 0) & 0xFF;
+	}
+	else
+	{
+		uint16_t key_565 = color_to_565(image->color_key);
+		memcpy(key, &key_565, 2);
+	}
+
+	/* Without color key every row is whole, panel window is set once for all of them */
+	if ((handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE) && !image->use_color_key)
+	{
+		handle->panel->write_start(&handle->io, x_start, y_start, x_end, y_end);
+	}
+
+	if (image->format == TFT_DRIVER_IMAGE_FORMAT_RLE565)
+	{
+		rect_t area = {x_start, y_start, x_end, y_end};
+		blit_rle565(handle, x, y, &area, image, key, &fg, &bg);
+		return;
+	}
+
+	uint32_t stride = image_stride(image);
+	for (int32_t row = y_start; row <= y_end; row++)
+	{
+		blit_row(handle, image, image->data + (uint32_t)(row - y) * stride, x, row, x_start - x, x_end - x + 1, key, &fg, &bg);
+	}
+}
+
+static bool font_next_run(const font_t *font, uint16_t num_byte_per_row, uint16_t row, uint16_t *bit, uint16_t *len)
+{
+	const uint8_t *p = font->data + row * num_byte_per_row;
+	uint16_t num_bit = num_byte_per_row * 8;
+
+	/* Skip cleared bits, then count set ones. Most significant bit is leftmost */
+	while ((*bit < num_bit) && !((p[*bit >> 3] << (*bit & 0x07)) & 0x80))
+	{
+		(*bit)++;
+	}
+	if (*bit >= num_bit)
+	{
+		return false;
+	}
+
+	*len = 0;
+	while ((*bit + *len < num_bit) && ((p[(*bit + *len) >> 3] << ((*bit + *len) & 0x07)) & 0x80))
+	{
+		(*len)++;
+	}
+
+	return true;
+}
+
+static uint16_t glyph_build_spans(const font_t *font, uint16_t num_byte_per_row, glyph_span_t *spans)
+{
+	uint16_t num_span = 0;
+
+	/* Count only when spans is NULL */
+	for (uint16_t row = 0; row < font->height; row++)
+	{
+		uint16_t bit = 0;
+		uint16_t len;
+		while (font_next_run(font, num_byte_per_row, row, &bit, &len))
+		{
+			if (spans != NULL)
+			{
+				spans[num_span].x = bit;
+				spans[num_span].y = row;
+				spans[num_span].len = len;
+			}
+			num_span++;
+			bit += len;
+		}
+	}
+
+	return num_span;
+}
+
+static bool glyph_is_visible(tft_driver_handle_t handle, int32_t x, int32_t y, const glyph_t *glyph)
+{
+	rect_t *clip = &handle->target.clip;
+
+	/* Font rows may be wider than the glyph, all of their bits count */
+	return (x <= clip->x_end) && (x + glyph->num_byte_per_row * 8 > clip->x_start) &&
+	       (y <= clip->y_end) && (y + glyph->height > clip->y_start);
+}
+
+static void draw_glyph_spans(tft_driver_handle_t handle,
+                             int32_t x,
+                             int32_t y,
+                             const glyph_t *glyph,
+                             const pattern_t *pattern)
+{
+	/* Glyph outside of clip is skipped as a whole, partly visible ones are clipped per span */
+	if ((pattern == NULL) || !glyph_is_visible(handle, x, y, glyph))
+	{
+		return;
+	}
+
+	for (uint16_t idx = 0; idx < glyph->num_span; idx++)
+	{
+		glyph_span_t *span = &glyph->spans[idx];
+		write_hspan(handle, x + span->x, y + span->y, span->len, pattern);
+	}
+}
+
+static err_code_t draw_glyph(tft_driver_handle_t handle,
+                             int32_t x,
+                             int32_t y,
+                             font_size_t font_size,
+                             uint8_t chr,
+                             const pattern_t *pattern,
+                             glyph_t *metrics)
+{
+	glyph_t *entry = NULL;
+
+	/* Direct mapped cache keyed by font size and character */
+	if (handle->glyph_cache_size > 0)
+	{
+		entry = &handle->glyph_cache[((uint32_t)font_size * 131 + chr) % handle->glyph_cache_size];
+		if (entry->valid && (entry->font_size == font_size) && (entry->chr == chr))
+		{
+			handle->glyph_cache_hit++;
+			draw_glyph_spans(handle, x, y, entry, pattern);
+			*metrics = *entry;
+
+			return ERR_CODE_SUCCESS;
+		}
+		handle->glyph_cache_miss++;
+	}
+
+	/* Get font data */
+	font_t font;
+	if (get_font(chr, font_size, &font) <= 0)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	metrics->width = font.width;
+	metrics->height = font.height;
+	metrics->num_byte_per_row = font.data_len / font.height;
+
+	/* Rasterize into cache entry, replacing what was there */
+	if ((entry != NULL) && !handle->glyph_cache_readonly)
+	{
+		uint16_t num_span = glyph_build_spans(&font, metrics->num_byte_per_row, NULL);
+		glyph_span_t *spans = malloc(num_span * sizeof(glyph_span_t) + 1);
+		if (spans != NULL)
+		{
+			free(entry->spans);
+			*entry = *metrics;
+			entry->valid = true;
+			entry->font_size = font_size;
+			entry->chr = chr;
+			entry->num_span = glyph_build_spans(&font, metrics->num_byte_per_row, spans);
+			entry->spans = spans;
+
+			draw_glyph_spans(handle, x, y, entry, pattern);
+
+			return ERR_CODE_SUCCESS;
+		}
+	}
+
+	if ((pattern == NULL) || !glyph_is_visible(handle, x, y, metrics))
+	{
+		return ERR_CODE_SUCCESS;
+	}
+
+	/* No cache, write runs straight from font data */
+	for (uint16_t row = 0; row < font.height; row++)
+	{
+		uint16_t bit = 0;
+		uint16_t len;
+		while (font_next_run(&font, metrics->num_byte_per_row, row, &bit, &len))
+		{
+			write_hspan(handle, x + bit, y + row, len, pattern);
+			bit += len;
+		}
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+static err_code_t draw_text(tft_driver_handle_t handle,
+                            int32_t x,
+                            int32_t y,
+                            font_size_t font_size,
+                            const uint8_t *str,
+                            bool is_char,
+                            const pattern_t *pattern,
+                            text_extent_t *extent)
+{
+	/* Only measure when pattern is NULL */
+	extent->x_end = x - 1;
+	extent->y_end = y - 1;
+	extent->num_chr = 0;
+
+	while (*str) {
+		glyph_t glyph;
+		if (draw_glyph(handle, x, y, font_size, *str, pattern, &glyph) != ERR_CODE_SUCCESS)
+		{
+			extent->x_next = x;
+			return ERR_CODE_FAIL;
+		}
+
+		if (x + glyph.num_byte_per_row * 8 - 1 > extent->x_end)
+		{
+			extent->x_end = x + glyph.num_byte_per_row * 8 - 1;
+		}
+		if (y + glyph.height - 1 > extent->y_end)
+		{
+			extent->y_end = y + glyph.height - 1;
+		}
+
+		/* Single character advances past its bitmap, strings keep one pixel spacing */
+		x += glyph.width + (is_char ? glyph.num_byte_per_row : 1);
+		extent->num_chr++;
+		str++;
+	}
+
+	extent->x_next = x;
+
+	return ERR_CODE_SUCCESS;
+}
+
+static void exec_cmd(tft_driver_handle_t handle, const cmd_t *cmd)
+{
+	const uint16_t *args = cmd->args;
+	pattern_t pattern;
+	text_extent_t extent;
+
+	make_pattern(handle, cmd->color, &pattern);
+	STATS_PRIM(handle, cmd->type);
+
+	switch (cmd->type)
+	{
+	case CMD_PIXEL:
+		plot_pixel(handle, args[0], args[1], &pattern);
+		break;
+
+	case CMD_LINE:
+		write_line(handle, args[0], args[1], args[2], args[3], &pattern);
+		break;
+
+	case CMD_RECT:
+		/* Edges span from origin to origin + size, both ends included */
+		write_hspan(handle, args[0], args[1], args[2] + 1, &pattern);
+		write_hspan(handle, args[0], args[1] + args[3], args[2] + 1, &pattern);
+		write_vspan(handle, args[0], args[1], args[3] + 1, &pattern);
+		write_vspan(handle, args[0] + args[2], args[1], args[3] + 1, &pattern);
+		break;
+
+	case CMD_FILL:
+	case CMD_FILL_RECT:
+		fill_rect(handle, args[0], args[1], args[2], args[3], &pattern);
+		break;
+
+	case CMD_CIRCLE:
+		/* Circle is a rounded square whose corners meet at the origin */
+		write_round_rect(handle, args[0] - args[2], args[1] - args[2], 2 * args[2] + 1, 2 * args[2] + 1, args[2], &pattern);
+		break;
+
+	case CMD_FILL_CIRCLE:
+		fill_round_rect(handle, args[0] - args[2], args[1] - args[2], 2 * args[2] + 1, 2 * args[2] + 1, args[2], &pattern);
+		break;
+
+	case CMD_ELLIPSE:
+	case CMD_FILL_ELLIPSE:
+		draw_ellipse(handle, args[0], args[1], args[2], args[3], &pattern, cmd->type == CMD_FILL_ELLIPSE);
+		break;
+
+	case CMD_ROUND_RECT:
+		write_round_rect(handle, args[0], args[1], args[2], args[3], args[4], &pattern);
+		break;
+
+	case CMD_FILL_ROUND_RECT:
+		fill_round_rect(handle, args[0], args[1], args[2], args[3], args[4], &pattern);
+		break;
+
+	case CMD_BLEND_RECT:
+		blend_rect(handle, args[0], args[1], args[2], args[3], &pattern, alpha_scale(cmd->color, 0xFF));
+		break;
+
+	case CMD_LINE_AA:
+		write_line_aa(handle, args[0], args[1], args[2], args[3], &pattern, cmd->color);
+		break;
+
+	case CMD_CIRCLE_AA:
+		write_circle_aa(handle, args[0], args[1], args[2], &pattern, cmd->color);
+		break;
+
+	case CMD_BLIT:
+	{
+		/* Image is stored right after the command, it may be unaligned */
+		tft_driver_image_t image;
+		memcpy(&image, cmd + 1, sizeof(image));
+		blit_image(handle, args[0], args[1], &image);
+		break;
+	}
+
+	case CMD_TEXT:
+		/* Text is stored right after the command */
+		draw_text(handle, args[0], args[1], cmd->font_size, (const uint8_t *)(cmd + 1), args[2], &pattern, &extent);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void mark_cmd_dirty(tft_driver_handle_t handle, const cmd_t *cmd)
+{
+	const uint16_t *args = cmd->args;
+	const rect_t *bbox = &cmd->bbox;
+
+	switch (cmd->type)
+	{
+	case CMD_RECT:
+		/* Edges are marked separately so the unchanged inside is not transmitted */
+		mark_dirty(handle, args[0], args[1], args[0] + args[2], args[1]);
+		mark_dirty(handle, args[0], args[1] + args[3], args[0] + args[2], args[1] + args[3]);
+		mark_dirty(handle, args[0], args[1], args[0], args[1] + args[3]);
+		mark_dirty(handle, args[0] + args[2], args[1], args[0] + args[2], args[1] + args[3]);
+		break;
+
+	case CMD_ROUND_RECT:
+		mark_dirty(handle, args[0], args[1], args[0] + args[2] - 1, args[1] + args[4]);
+		mark_dirty(handle, args[0], args[1] + args[3] - 1 - args[4], args[0] + args[2] - 1, args[1] + args[3] - 1);
+		mark_dirty(handle, args[0], args[1], args[0], args[1] + args[3] - 1);
+		mark_dirty(handle, args[0] + args[2] - 1, args[1], args[0] + args[2] - 1, args[1] + args[3] - 1);
+		break;
+
+	default:
+		mark_dirty(handle, bbox->x_start, bbox->y_start, bbox->x_end, bbox->y_end);
+		break;
+	}
+}
+
+static bool rect_intersect(const rect_t *a, const rect_t *b)
+{
+	return (a->x_start <= b->x_end) && (b->x_start <= a->x_end) &&
+	       (a->y_start <= b->y_end) && (b->y_start <= a->y_end);
+}
+
+static bool rect_contain(const rect_t *outer, const rect_t *inner)
+{
+	return (outer->x_start <= inner->x_start) && (outer->x_end >= inner->x_end) &&
+	       (outer->y_start <= inner->y_start) && (outer->y_end >= inner->y_end);
+}
+
+static bool cmd_is_opaque(const cmd_t *cmd, const void *payload)
+{
+	/* Fills and images without transparent pixels cover their whole box */
+	if ((cmd->type == CMD_FILL) || (cmd->type == CMD_FILL_RECT))
+	{
+		return true;
+	}
+	if (cmd->type == CMD_BLIT)
+	{
+		/* Queued images are copied right after their command, they may be unaligned */
+		tft_driver_image_t image;
+		memcpy(&image, payload, sizeof(image));
+		return !image.use_color_key;
+	}
+
+	return false;
+}
+
+static err_code_t dl_record(tft_driver_handle_t handle, cmd_t *cmd, const void *payload, uint16_t payload_len)
+{
+	/* Payload follows the command with a terminator for text, records stay word aligned */
+	uint32_t size = sizeof(cmd_t);
+	if (payload != NULL)
+	{
+		size += payload_len + 1;
+	}
+	size = (size + 3) & ~3;
+
+	/* Commands hidden below an opaque one will never be visible again, drop
+	   them. Space is checked against what is left first, a rejected command
+	   must leave the list as it was */
+	bool is_opaque = cmd_is_opaque(cmd, payload);
+	uint32_t len = handle->dl_len;
+	if (is_opaque)
+	{
+		len = 0;
+		for (uint32_t read = 0; read < handle->dl_len; read += ((cmd_t *)(handle->dl + read))->size)
+		{
+			const cmd_t *old = (const cmd_t *)(handle->dl + read);
+			if (!rect_contain(&cmd->bbox, &old->bbox))
+			{
+				len += old->size;
+			}
+		}
+	}
+
+	if (len + size > handle->dl_size)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	if (is_opaque)
+	{
+		uint32_t read = 0;
+		uint32_t write = 0;
+		while (read < handle->dl_len)
+		{
+			cmd_t *old = (cmd_t *)(handle->dl + read);
+			uint16_t old_size = old->size;
+			if (!rect_contain(&cmd->bbox, &old->bbox))
+			{
+				memmove(handle->dl + write, old, old_size);
+				write += old_size;
+			}
+			read += old_size;
+		}
+		handle->dl_len = write;
+	}
+
+	cmd->size = size;
+	memcpy(handle->dl + handle->dl_len, cmd, sizeof(cmd_t));
+	if (payload != NULL)
+	{
+		memcpy(handle->dl + handle->dl_len + sizeof(cmd_t), payload, payload_len);
+		handle->dl[handle->dl_len + sizeof(cmd_t) + payload_len] = '\0';
+	}
+	handle->dl_len += size;
+
+	return ERR_CODE_SUCCESS;
+}
+
+static bool queue_push(cmd_queue_t *queue, const cmd_t *cmd, const void *payload, uint16_t payload_len)
+{
+	/* Text keeps its terminator, there is no room for longer payloads */
+	if ((payload != NULL) && (payload_len + 1 > QUEUE_PAYLOAD_SIZE))
+	{
+		atomic_fetch_add_explicit(&queue->num_dropped, 1, memory_order_relaxed);
+		return false;
+	}
+
+	/* Claim the slot at head. Sequence lags a lap behind while the consumer
+	   has not taken the slot yet, the queue is full then */
+	queue_slot_t *slot;
+	uint32_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	while (true)
+	{
+		slot = &queue->slot[pos & queue->mask];
+		int32_t diff = (int32_t)(atomic_load_explicit(&slot->seq, memory_order_acquire) - pos);
+		if (diff == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1,
+			                                          memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			atomic_fetch_add_explicit(&queue->num_dropped, 1, memory_order_relaxed);
+			return false;
+		}
+		else
+		{
+			pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+		}
+	}
+
+	slot->cmd = *cmd;
+	slot->payload_len = 0;
+	if (payload != NULL)
+	{
+		memcpy(slot->payload, payload, payload_len);
+		slot->payload[payload_len] = '\0';
+		slot->payload_len = payload_len;
+	}
+
+	/* Hand the slot to the consumer */
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+	uint32_t depth = pos + 1 - atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	uint32_t max_depth = atomic_load_explicit(&queue->max_depth, memory_order_relaxed);
+	while ((depth > max_depth) &&
+	       !atomic_compare_exchange_weak_explicit(&queue->max_depth, &max_depth, depth,
+	                                              memory_order_relaxed, memory_order_relaxed))
+	{
+	}
+
+	return true;
+}
+
+static err_code_t record_cmd(tft_driver_handle_t handle, cmd_t *cmd, const void *payload, uint16_t payload_len)
+{
+	/* Producers hand commands over to the task owning the queue */
+	if (handle->is_producer)
+	{
+		return queue_push(handle->queue, cmd, payload, payload_len) ? ERR_CODE_SUCCESS : ERR_CODE_FAIL;
+	}
+
+	return dl_record(handle, cmd, payload, payload_len);
+}
+
+static void exec_queued(tft_driver_handle_t handle, cmd_t *cmd, uint16_t payload_len)
+{
+	/* Blending reads back pixels, panel memory can not be read */
+	if ((handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE) &&
+	    ((cmd->type == CMD_BLEND_RECT) || (cmd->type == CMD_LINE_AA) || (cmd->type == CMD_CIRCLE_AA)))
+	{
+		atomic_fetch_add_explicit(&handle->queue->num_dropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	/* Payload follows the command in the slot as it does in display list */
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+	{
+		if (dl_record(handle, cmd, (payload_len > 0) ? (const void *)(cmd + 1) : NULL, payload_len) != ERR_CODE_SUCCESS)
+		{
+			atomic_fetch_add_explicit(&handle->queue->num_dropped, 1, memory_order_relaxed);
+			return;
+		}
+	}
+	else
+	{
+		/* Bounding box holds the clip rectangle of the producer */
+		handle->target.clip = cmd->bbox;
+		exec_cmd(handle, cmd);
+		handle->target.clip = handle->clip;
+	}
+
+	mark_cmd_dirty(handle, cmd);
+}
+
+static uint32_t drain_queue(tft_driver_handle_t handle, uint32_t max_cmd)
+{
+	cmd_queue_t *queue = handle->queue;
+	uint32_t num_cmd = 0;
+
+	/* Stop at commands queued later, or at a slot still being filled, so a
+	   busy producer can not keep the consumer here */
+	uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	uint32_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	while ((pos != head) && ((max_cmd == 0) || (num_cmd < max_cmd)))
+	{
+		queue_slot_t *slot = &queue->slot[pos & queue->mask];
+		if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1)
+		{
+			break;
+		}
+
+		exec_queued(handle, &slot->cmd, slot->payload_len);
+
+		/* Slot is free for the producer claiming it one lap later */
+		pos++;
+		atomic_store_explicit(&queue->tail, pos, memory_order_relaxed);
+		atomic_store_explicit(&slot->seq, pos + queue->mask, memory_order_release);
+		num_cmd++;
+	}
+
+	return num_cmd;
+}
+
+static void render_area(tft_driver_handle_t handle,
+                        uint16_t x,
+                        uint16_t y,
+                        uint16_t width,
+                        uint16_t height,
+                        uint16_t *data)
+{
+	rect_t area = {x, y, x + width - 1, y + height - 1};
+
+	/* Draw into lines buffer, everything outside of the area is clipped away */
+	handle->target.data = (uint8_t *)data;
+	handle->target.stride = width;
+	handle->target.y_offset = 0;
+	handle->target.area = area;
+
+	/* Background is black, then replay commands touching the area in recorded order */
+	memset(data, 0, (uint32_t)width * height * sizeof(uint16_t));
+
+	uint32_t offset = 0;
+	while (offset < handle->dl_len)
+	{
+		cmd_t *cmd = (cmd_t *)(handle->dl + offset);
+		if (rect_intersect(&cmd->bbox, &area))
+		{
+			/* Bounding box holds the clip rectangle the command was recorded with */
+			handle->target.clip = area;
+			rect_clip(&handle->target.clip, &cmd->bbox);
+			exec_cmd(handle, cmd);
+		}
+		offset += cmd->size;
+	}
+}
+
+static bool cmd_set_bbox(tft_driver_handle_t handle, cmd_t *cmd, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+	/* Keep only the part inside clip rectangle, nothing to draw when it is empty */
+	if (x1 < handle->clip.x_start) x1 = handle->clip.x_start;
+	if (y1 < handle->clip.y_start) y1 = handle->clip.y_start;
+	if (x2 > handle->clip.x_end) x2 = handle->clip.x_end;
+	if (y2 > handle->clip.y_end) y2 = handle->clip.y_end;
+	if ((x1 > x2) || (y1 > y2))
+	{
+		return false;
+	}
+
+	cmd->bbox.x_start = x1;
+	cmd->bbox.y_start = y1;
+	cmd->bbox.x_end = x2;
+	cmd->bbox.y_end = y2;
+
+	return true;
+}
+
+static err_code_t draw_cmd(tft_driver_handle_t handle, cmd_t *cmd, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+	STATS_CALL(handle, cmd->type);
+
+	if (!cmd_set_bbox(handle, cmd, x1, y1, x2, y2))
+	{
+		return ERR_CODE_SUCCESS;
+	}
+
+	/* Display list mode draws later, band by band on refresh */
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+	{
+		err_code_t err = record_cmd(handle, cmd, NULL, 0);
+		if (err != ERR_CODE_SUCCESS)
+		{
+			return err;
+		}
+	}
+	else
+	{
+		exec_cmd(handle, cmd);
+	}
+
+	mark_cmd_dirty(handle, cmd);
+
+	return ERR_CODE_SUCCESS;
+}
+
+static err_code_t draw_string(tft_driver_handle_t handle,
+                              font_size_t font_size,
+                              const uint8_t *str,
+                              bool is_char,
+                              uint32_t color)
+{
+	cmd_t cmd = {.type = CMD_TEXT, .font_size = font_size, .color = color};
+	text_extent_t extent;
+	err_code_t err;
+
+	cmd.args[0] = handle->pos_x;
+	cmd.args[1] = handle->pos_y;
+	cmd.args[2] = is_char;
+	STATS_CALL(handle, CMD_TEXT);
+	STATS_PRIM(handle, CMD_TEXT);
+
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+	{
+		/* Measure now to advance position, glyphs are drawn on refresh */
+		err = draw_text(handle, handle->pos_x, handle->pos_y, font_size, str, is_char, NULL, &extent);
+		if ((extent.num_chr > 0) &&
+		    cmd_set_bbox(handle, &cmd, handle->pos_x, handle->pos_y, extent.x_end, extent.y_end))
+		{
+			err_code_t record_err = record_cmd(handle, &cmd, str, extent.num_chr);
+			if (record_err != ERR_CODE_SUCCESS)
+			{
+				return record_err;
+			}
+		}
+	}
+	else
+	{
+		pattern_t pattern;
+		make_pattern(handle, color, &pattern);
+		err = draw_text(handle, handle->pos_x, handle->pos_y, font_size, str, is_char, &pattern, &extent);
+	}
+
+	/* Characters drawn before a failure still have to reach the screen */
+	mark_dirty(handle, handle->pos_x, handle->pos_y, extent.x_end, extent.y_end);
+	handle->pos_x = extent.x_next;
+
+	return err;
+}
+
+static void write_area(tft_driver_handle_t handle, area_t *area)
+{
+	uint32_t num_pixel = (uint32_t)area->width * area->height;
+	STATS_TIME_START(handle, start);
+
+	/* Display rectangle area to screen */
+	if (area->is_continue)
+	{
+		/* Panel auto increments into the rows below, only data is needed */
+		handle->panel->write_pixels(&handle->io, area->data, num_pixel);
+	}
+	else if ((area->y + area->height - 1 == area->window_y_end) && (handle->panel->write_area != NULL))
+	{
+		/* Whole rectangle in one area, window and data go out together */
+		handle->panel->write_area(&handle->io,
+		                          area->x,
+		                          area->y,
+		                          area->x + area->width - 1,
+		                          area->window_y_end,
+		                          area->data);
+	}
+	else
+	{
+		/* Open window over the whole rectangle, following areas stream into it */
+		handle->panel->write_start(&handle->io,
+		                           area->x,
+		                           area->y,
+		                           area->x + area->width - 1,
+		                           area->window_y_end);
+		handle->panel->write_pixels(&handle->io, area->data, num_pixel);
+	}
+
+	STATS_TIME_ADD(handle, frame_trans_us, start);
+	STATS_ADD(handle, num_area, 1);
+#ifdef TFT_DRIVER_ENABLE_STATS
+	handle->frame_num_pixel += num_pixel;
+#endif
+}
+
+static void write_area_async(tft_driver_handle_t handle, area_t *area)
+{
+	uint32_t num_pixel = (uint32_t)area->width * area->height;
+	STATS_TIME_START(handle, start);
+
+	/* Window commands are short, send them directly. Bus is idle at this point.
+	   Following areas of the rectangle stream into the same window */
+	if (!area->is_continue)
+	{
+		handle->panel->write_start(&handle->io,
+		                           area->x,
+		                           area->y,
+		                           area->x + area->width - 1,
+		                           area->window_y_end);
+	}
+
+	/* Queue pixel data, the caller converts the next area meanwhile */
+	TFT_DRIVER_IO_SET_DC(&handle->io, 1);
+	handle->func_spi_queue_trans((uint8_t *)area->data, num_pixel * sizeof(uint16_t));
+	TFT_DRIVER_IO_COUNT(&handle->io, 1, num_pixel * sizeof(uint16_t));
+
+	STATS_TIME_ADD(handle, frame_trans_us, start);
+	STATS_ADD(handle, num_area, 1);
+#ifdef TFT_DRIVER_ENABLE_STATS
+	handle->frame_num_pixel += num_pixel;
+#endif
+}
+
+static void apply_scroll(tft_driver_handle_t handle)
+{
+	/* Panel shows screen buffer rows from the new top on. Bus must be idle */
+	if (!handle->scroll_pending)
+	{
+		return;
+	}
+
+	handle->panel->set_scroll_start(&handle->io, handle->scroll_offset);
+	handle->scroll_pending = false;
+}
+
+static err_code_t wait_trans(tft_driver_handle_t handle, uint32_t timeout_ms)
+{
+	/* Oldest queued transfer is done, its lines buffer is free again */
+	STATS_TIME_START(handle, start);
+	err_code_t err = handle->func_spi_wait_trans(timeout_ms);
+	STATS_TIME_ADD(handle, frame_trans_us, start);
+	if (err != ERR_CODE_SUCCESS)
+	{
+		return ERR_CODE_FAIL;
+	}
+	handle->in_flight--;
+
+	return ERR_CODE_SUCCESS;
+}
+
+static err_code_t refresh_advance(tft_driver_handle_t handle, uint32_t timeout_ms)
+{
+	band_group_t *cur = &handle->group[handle->group_idx];
+	band_group_t *next = &handle->group[handle->group_idx ^ 1];
+
+	/* Queue areas of the current group. Window commands are sent directly,
+	   so the bus has to be idle before an area opening a new window */
+	while (cur->sent < cur->num)
+	{
+		area_t *area = &cur->area[cur->sent];
+		if (!area->is_continue && (handle->in_flight > 0))
+		{
+			if (wait_trans(handle, timeout_ms) != ERR_CODE_SUCCESS)
+			{
+				return ERR_CODE_FAIL;
+			}
+			continue;
+		}
+
+		write_area_async(handle, area);
+		handle->in_flight++;
+		cur->sent++;
+	}
+
+	/* Draw queued commands while the bus is busy. Later groups may pick them
+	   up, they are marked dirty for the next frame anyway */
+	if ((handle->queue != NULL) && (handle->render_mode != TFT_DRIVER_RENDER_MODE_IMMEDIATE))
+	{
+		drain_queue(handle, QUEUE_DRAIN_BATCH);
+	}
+
+	/* Prepare the next group while the current one is on the bus. Its lines
+	   buffers are free once only transfers of the current group are left */
+	if ((next->num == 0) && (handle->frame_rect_idx < handle->frame_num_rect))
+	{
+		while (handle->in_flight > cur->num)
+		{
+			if (wait_trans(handle, timeout_ms) != ERR_CODE_SUCCESS)
+			{
+				return ERR_CODE_FAIL;
+			}
+		}
+
+		prepare_group(handle, handle->group_idx ^ 1);
+	}
+
+	if (next->num > 0)
+	{
+		cur->num = 0;
+		handle->group_idx ^= 1;
+
+		return ERR_CODE_SUCCESS;
+	}
+
+	/* Everything is queued, frame is done once the bus drains */
+	if (handle->in_flight > 0)
+	{
+		if (wait_trans(handle, timeout_ms) != ERR_CODE_SUCCESS)
+		{
+			return ERR_CODE_FAIL;
+		}
+	}
+
+	if (handle->in_flight == 0)
+	{
+		cur->num = 0;
+		handle->refresh_busy = false;
+#ifdef TFT_DRIVER_ENABLE_STATS
+		end_frame_stats(handle);
+#endif
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+static bool take_te_edges(tft_driver_handle_t handle)
+{
+	/* Count edges which came since the last call without waiting */
+	bool is_seen = false;
+	while (handle->func_wait_te(0) == ERR_CODE_SUCCESS)
+	{
+		if (handle->te_count < handle->frame_divider)
+		{
+			handle->te_count++;
+		}
+		is_seen = true;
+	}
+
+	return is_seen;
+}
+
+static err_code_t present_frame(tft_driver_handle_t handle)
+{
+	handle->te_count = 0;
+	handle->frame_pending = false;
+	handle->num_frame_presented++;
+
+	/* Panel is in vertical blanking, the scan follows areas sent from the top */
+	if (handle->func_spi_queue_trans != NULL)
+	{
+		return tft_driver_screen_refresh_async(handle);
+	}
+
+	return tft_driver_screen_refresh(handle);
+}
+
+static void sort_layers(tft_driver_handle_t handle)
+{
+	/* Insertion sort, layers of equal z order keep index order */
+	for (uint8_t idx = 0; idx < handle->num_layer; idx++)
+	{
+		uint8_t id = idx;
+		uint8_t pos = idx;
+		while ((pos > 0) && (handle->layer[handle->layer_order[pos - 1]].cfg.z_order > handle->layer[id].cfg.z_order))
+		{
+			handle->layer_order[pos] = handle->layer_order[pos - 1];
+			pos--;
+		}
+		handle->layer_order[pos] = id;
+	}
+}
+
+static void mark_layer_dirty(tft_driver_handle_t handle, const layer_t *layer)
+{
+	const tft_driver_layer_t *cfg = &layer->cfg;
+	if (!cfg->visible || (cfg->width == 0) || (cfg->height == 0))
+	{
+		return;
+	}
+
+	mark_dirty(handle, cfg->x, cfg->y, (int32_t)cfg->x + cfg->width - 1, (int32_t)cfg->y + cfg->height - 1);
+
+	/* Screen buffer below may be unchanged, band hashes no longer tell what the panel shows */
+	if (handle->band_hash != NULL)
+	{
+		int32_t y1 = (cfg->y > 0) ? cfg->y : 0;
+		int32_t y2 = ((int32_t)cfg->y + cfg->height < handle->height) ? cfg->y + cfg->height : handle->height;
+		for (int32_t y = y1; y < y2; y++)
+		{
+			handle->band_hash_valid &= ~(1UL << (((y + handle->scroll_offset) % handle->height) / SPI_PARALLEL_LINES));
+		}
+	}
+}
+
+static void free_buffers(tft_driver_handle_t handle, uint8_t num_lines)
+{
+	/* Buffers not allocated yet are NULL, handle was zeroed by init */
+	if (handle->lines != NULL)
+	{
+		for (uint8_t i = 0; i < num_lines; i++)
+		{
+			free(handle->lines[i].data);
+		}
+	}
+	free(handle->lines);
+	free(handle->data);
+	free(handle->index_lut);
+	free(handle->band_hash);
+	free(handle->layer);
+	free(handle->layer_order);
+	if (handle->queue != NULL)
+	{
+		free(handle->queue->slot);
+	}
+	free(handle->queue);
+	free(handle->dl);
+	free(handle->band_ctx);
+	free(handle->glyph_cache);
+
+	handle->lines = NULL;
+	handle->data = NULL;
+	handle->index_lut = NULL;
+	handle->band_hash = NULL;
+	handle->num_hash_band = 0;
+	handle->layer = NULL;
+	handle->layer_order = NULL;
+	handle->num_layer = 0;
+	handle->queue = NULL;
+	handle->dl = NULL;
+	handle->dl_size = 0;
+	handle->band_ctx = NULL;
+	handle->glyph_cache = NULL;
+	handle->glyph_cache_size = 0;
+}
+
+tft_driver_handle_t tft_driver_init(void)
+{
+	tft_driver_handle_t handle = calloc(1, sizeof(tft_driver_t));
+
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return NULL;
+	}
+
+	return handle;
+}
+
+err_code_t tft_driver_set_func(tft_driver_handle_t handle,
+                               tft_driver_spi_trans func_spi_trans,
+                               tft_driver_set_dc func_set_dc,
+                               tft_driver_set_rst func_set_rst,
+                               tft_driver_delay func_delay)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	handle->io.func_spi_trans = func_spi_trans;
+	handle->io.func_set_dc = func_set_dc;
+	handle->io.func_set_rst = func_set_rst;
+	handle->io.func_delay = func_delay;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_set_func_async(tft_driver_handle_t handle,
+                                     tft_driver_spi_queue_trans func_spi_queue_trans,
+                                     tft_driver_spi_wait_trans func_spi_wait_trans)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Transport can not be changed while a frame is on the bus */
+	if (handle->refresh_busy)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	handle->func_spi_queue_trans = func_spi_queue_trans;
+	handle->func_spi_wait_trans = func_spi_wait_trans;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_set_func_parallel(tft_driver_handle_t handle,
+                                        tft_driver_run_parallel func_run_parallel)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Workers can not be changed while a frame is prepared */
+	if (handle->refresh_busy)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	handle->func_run_parallel = func_run_parallel;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_set_func_trans_list(tft_driver_handle_t handle,
+                                          tft_driver_spi_trans_list func_spi_trans_list)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Transport can not be changed while a frame is on the bus */
+	if (handle->refresh_busy)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	handle->io.func_spi_trans_list = func_spi_trans_list;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_set_func_tear(tft_driver_handle_t handle,
+                                    tft_driver_wait_te func_wait_te)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Paced refresh relies on it */
+	if (handle->frame_divider > 0)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	handle->func_wait_te = func_wait_te;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_set_func_clock(tft_driver_handle_t handle,
+                                     tft_driver_get_time_us func_get_time_us)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+#ifdef TFT_DRIVER_ENABLE_STATS
+	handle->func_get_time_us = func_get_time_us;
+
+	return ERR_CODE_SUCCESS;
+#else
+	(void)func_get_time_us;
+
+	return ERR_CODE_FAIL;
+#endif
+}
+
+err_code_t tft_driver_config(tft_driver_handle_t handle, tft_driver_cfg_t config)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* ILI9341 unless another panel is given */
+	const tft_driver_panel_t *panel = (config.panel != NULL) ? config.panel : &ili9341_panel;
+
+	/* Check screen fits the panel in the requested rotation, pixel data is always sent as RGB565 */
+	uint16_t max_width = (config.rotation == TFT_DRIVER_ROTATION_PORTRAIT) ? panel->max_height : panel->max_width;
+	uint16_t max_height = (config.rotation == TFT_DRIVER_ROTATION_PORTRAIT) ? panel->max_width : panel->max_height;
+	if ((config.width > max_width) || (config.height > max_height) ||
+	    !(panel->caps & TFT_DRIVER_PANEL_CAP_RGB565))
+	{
+		return ERR_CODE_FAIL;
+	}
+	if ((config.rotation != TFT_DRIVER_ROTATION_LANDSCAPE) && !(panel->caps & TFT_DRIVER_PANEL_CAP_ROTATION))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Band hashes are bits of the masks, screen has at most one band each */
+	uint32_t num_hash_band = (config.height + SPI_PARALLEL_LINES - 1) / SPI_PARALLEL_LINES;
+	if ((config.render_mode == TFT_DRIVER_RENDER_MODE_FRAMEBUFFER) && config.skip_unchanged &&
+	    (num_hash_band > MAX_HASH_BAND))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Queue positions map to slots by masking, number of slots is a power of two */
+	if (config.cmd_queue_size & (config.cmd_queue_size - 1))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Immediate and display list modes draw in panel format, there is no screen buffer to convert */
+	if (config.render_mode != TFT_DRIVER_RENDER_MODE_FRAMEBUFFER)
+	{
+		config.pixel_format = TFT_DRIVER_PIXEL_FORMAT_RGB565;
+	}
+	uint8_t index_bits = index_bits_of(config.pixel_format);
+	uint8_t bytes_per_pixel = (config.pixel_format == TFT_DRIVER_PIXEL_FORMAT_RGB565) ? 2 : (index_bits > 0) ? 1 : 3;
+
+	/* One band per group unless parallel preparation is requested */
+	uint8_t num_band = config.num_parallel_band;
+	if (num_band == 0)
+	{
+		num_band = 1;
+	}
+	if (num_band > MAX_PARALLEL_BAND)
+	{
+		num_band = MAX_PARALLEL_BAND;
+	}
+
+	if (config.render_mode == TFT_DRIVER_RENDER_MODE_FRAMEBUFFER)
+	{
+		/* Allocate memory for screen data buffer, indexed pixels are packed */
+		if (index_bits > 0)
+		{
+			handle->data = calloc(((uint32_t)config.width * config.height * index_bits + 7) / 8, sizeof(uint8_t));
+		}
+		else
+		{
+			handle->data = calloc(config.width * config.height * bytes_per_pixel, sizeof(uint8_t));
+		}
+		if (handle->data == NULL)
+		{
+			free_buffers(handle, 2 * num_band);
+			return ERR_CODE_FAIL;
+		}
+	}
+
+	if (index_bits > 0)
+	{
+		/* Allocate memory for palette lookup table, panel pixels of every byte value */
+		handle->index_lut = malloc(256 * (8 / index_bits) * sizeof(uint16_t));
+		if (handle->index_lut == NULL)
+		{
+			free_buffers(handle, 2 * num_band);
+			return ERR_CODE_FAIL;
+		}
+	}
+
+	if ((config.render_mode == TFT_DRIVER_RENDER_MODE_FRAMEBUFFER) && config.skip_unchanged)
+	{
+		/* Allocate memory for band hashes, one bit of the masks each */
+		handle->band_hash = calloc(num_hash_band, sizeof(uint32_t));
+		if (handle->band_hash == NULL)
+		{
+			free_buffers(handle, 2 * num_band);
+			return ERR_CODE_FAIL;
+		}
+		handle->num_hash_band = num_hash_band;
+	}
+
+	if ((config.render_mode != TFT_DRIVER_RENDER_MODE_IMMEDIATE) && (config.num_layer > 0))
+	{
+		/* Allocate memory for layers, all hidden until set */
+		handle->layer = calloc(config.num_layer, sizeof(layer_t));
+		handle->layer_order = calloc(config.num_layer, sizeof(uint8_t));
+		if ((handle->layer == NULL) || (handle->layer_order == NULL))
+		{
+			free_buffers(handle, 2 * num_band);
+			return ERR_CODE_FAIL;
+		}
+		handle->num_layer = config.num_layer;
+		sort_layers(handle);
+	}
+
+	if (config.cmd_queue_size > 0)
+	{
+		/* Allocate memory for command queue, every slot waits for its position of the first lap */
+		handle->queue = calloc(1, sizeof(cmd_queue_t));
+		if (handle->queue == NULL)
+		{
+			free_buffers(handle, 2 * num_band);
+			return ERR_CODE_FAIL;
+		}
+		handle->queue->slot = calloc(config.cmd_queue_size, sizeof(queue_slot_t));
+		if (handle->queue->slot == NULL)
+		{
+			free_buffers(handle, 2 * num_band);
+			return ERR_CODE_FAIL;
+		}
+		for (uint32_t i = 0; i < config.cmd_queue_size; i++)
+		{
+			atomic_init(&handle->queue->slot[i].seq, i);
+		}
+		handle->queue->mask = config.cmd_queue_size - 1;
+	}
+
+	if (config.render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+	{
+		/* Allocate memory for display list, commands are recorded instead of drawn */
+		uint32_t dl_size = (config.display_list_size > 0) ? config.display_list_size : DISPLAY_LIST_DEFAULT_SIZE;
+		handle->dl = malloc(dl_size);
+		if (handle->dl == NULL)
+		{
+			free_buffers(handle, 2 * num_band);
+			return ERR_CODE_FAIL;
+		}
+		handle->dl_size = dl_size;
+		handle->dl_len = 0;
+	}
+
+	if (config.render_mode != TFT_DRIVER_RENDER_MODE_IMMEDIATE)
+	{
+		/* Allocate memory for lines buffer. These buffer will be used to store
+		   temporarily data of screen buffer, or to render display list into.
+		   Every band of a group has one buffer on the bus and one being prepared */
+		handle->lines = calloc(2 * num_band, sizeof(lines_t));
+		if (handle->lines == NULL)
+		{
+			free_buffers(handle, 2 * num_band);
+			return ERR_CODE_FAIL;
+		}
+		for (uint8_t i = 0; i < 2 * num_band; i++)
+		{
+			handle->lines[i].data = calloc(config.width * SPI_PARALLEL_LINES, sizeof(uint16_t));
+			if (handle->lines[i].data == NULL)
+			{
+				free_buffers(handle, 2 * num_band);
+				return ERR_CODE_FAIL;
+			}
+		}
+	}
+
+	if ((config.render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST) && (num_band > 1))
+	{
+		/* Allocate memory for handle copies, bands of a group are rendered at the same time */
+		handle->band_ctx = calloc(num_band, sizeof(tft_driver_t));
+	}
+
+	/* Allocate memory for glyph cache, spans of each glyph are allocated on first use */
+	if (config.glyph_cache_size > 0)
+	{
+		handle->glyph_cache = calloc(config.glyph_cache_size, sizeof(glyph_t));
+		handle->glyph_cache_size = (handle->glyph_cache != NULL) ? config.glyph_cache_size : 0;
+	}
+
+	/* Call specific init function of TFT */
+	handle->panel = panel;
+	handle->io.window_valid = false;
+	handle->io.dc_valid = false;
+	panel->init(&handle->io);
+
+	/* Init sequence turns TE output off, refresh is not paced until set again */
+	handle->frame_rate = 0;
+	handle->frame_divider = 0;
+	handle->frame_pending = false;
+
+	/* Panel content is unknown after init, every band is sent */
+	handle->band_hash_valid = 0;
+
+	/* Init sequence sets landscape. Portrait rows run along panel gate lines,
+	   so the screen can be scrolled in hardware */
+	if (config.rotation == TFT_DRIVER_ROTATION_PORTRAIT)
+	{
+		panel->set_rotation(&handle->io, config.rotation);
+		if (panel->caps & TFT_DRIVER_PANEL_CAP_HW_SCROLL)
+		{
+			panel->set_scroll_area(&handle->io, 0, config.height);
+			panel->set_scroll_start(&handle->io, 0);
+		}
+	}
+
+	/* Update handle structure */
+	handle->width = config.width;
+	handle->height = config.height;
+	handle->pixel_format = config.pixel_format;
+	handle->render_mode = config.render_mode;
+	handle->rotation = config.rotation;
+	handle->bytes_per_pixel = bytes_per_pixel;
+	handle->index_bits = index_bits;
+	if (index_bits > 0)
+	{
+		build_index_lut(handle, config.palette);
+	}
+	handle->num_band = num_band;
+	handle->pause = false;
+	handle->is_started = true;
+	handle->pos_x = 0;
+	handle->pos_y = 0;
+	handle->num_dirty = 0;
+	handle->scroll_offset = 0;
+	handle->scroll_pending = false;
+
+	/* Drawing goes to the whole screen buffer until display list replay redirects it */
+	handle->target.data = handle->data;
+	handle->target.stride = handle->width;
+	handle->target.y_offset = 0;
+	handle->target.area.x_start = 0;
+	handle->target.area.y_start = 0;
+	handle->target.area.x_end = handle->width - 1;
+	handle->target.area.y_end = handle->height - 1;
+	handle->target.clip = handle->target.area;
+	handle->clip = handle->target.area;
+	handle->clip_depth = 0;
+
+	/* Panel content is unknown after init, first refresh sends whole screen */
+	mark_dirty(handle, 0, 0, handle->width - 1, handle->height - 1);
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_sleep(tft_driver_handle_t handle, uint8_t enable)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Panel must support it and bus must be idle */
+	if ((handle->panel == NULL) || !(handle->panel->caps & TFT_DRIVER_PANEL_CAP_SLEEP) || handle->refresh_busy)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	return handle->panel->sleep(&handle->io, enable);
+}
+
+err_code_t tft_driver_screen_refresh(tft_driver_handle_t handle)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Producers only queue commands, the screen belongs to the consumer */
+	if (handle->is_producer)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Pipelined refresh when transport can queue transfers */
+	if (handle->func_spi_queue_trans != NULL)
+	{
+		err_code_t err = tft_driver_screen_refresh_async(handle);
+		if (err != ERR_CODE_SUCCESS)
+		{
+			return err;
+		}
+
+		return tft_driver_refresh_wait(handle);
+	}
+
+	/* Display only damaged areas of screen buffer. Every cycle, a group of
+	   areas holding as many rows as fit into one lines buffer each is updated */
+	apply_scroll(handle);
+	begin_frame(handle);
+	while (prepare_group(handle, 0))
+	{
+		for (uint8_t idx = 0; idx < handle->group[0].num; idx++)
+		{
+			write_area(handle, &handle->group[0].area[idx]);
+		}
+	}
+#ifdef TFT_DRIVER_ENABLE_STATS
+	end_frame_stats(handle);
+#endif
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_screen_refresh_async(tft_driver_handle_t handle)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Check if asynchronous transport is set */
+	if ((handle->func_spi_queue_trans == NULL) || (handle->func_spi_wait_trans == NULL) || handle->is_producer)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Finish previous frame first, its lines buffers are still in use */
+	err_code_t err = tft_driver_refresh_wait(handle);
+	if (err != ERR_CODE_SUCCESS)
+	{
+		return err;
+	}
+
+	apply_scroll(handle);
+	begin_frame(handle);
+	handle->refresh_busy = true;
+	handle->group_idx = 0;
+	handle->group[1].num = 0;
+	prepare_group(handle, 0);
+
+	/* Start as far as the bus allows, waiting is left to poll and wait */
+	refresh_advance(handle, 0);
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_refresh_poll(tft_driver_handle_t handle, uint8_t *is_done)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Move on as far as finished transfers allow without blocking */
+	while (handle->refresh_busy)
+	{
+		if (refresh_advance(handle, 0) != ERR_CODE_SUCCESS)
+		{
+			break;
+		}
+	}
+
+	if (is_done != NULL)
+	{
+		*is_done = !handle->refresh_busy;
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_refresh_wait(tft_driver_handle_t handle)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	while (handle->refresh_busy)
+	{
+		err_code_t err = refresh_advance(handle, REFRESH_TRANS_TIMEOUT_MS);
+		if (err != ERR_CODE_SUCCESS)
+		{
+			return err;
+		}
+	}
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_set_frame_rate(tft_driver_handle_t handle, uint8_t frame_rate)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Panel must be configured and signal TE, bus must be idle to send commands */
+	if ((handle->panel == NULL) || !(handle->panel->caps & TFT_DRIVER_PANEL_CAP_TEAR) || handle->refresh_busy)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	if (frame_rate == 0)
+	{
+		handle->frame_rate = 0;
+		handle->frame_divider = 0;
+		handle->frame_pending = false;
+
+		return handle->panel->set_tear(&handle->io, 0);
+	}
+
+	if (handle->func_wait_te == NULL)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Low rates take every n-th frame of a panel scanning fast enough not to flicker */
+	uint8_t divider = (MIN_SCAN_RATE + frame_rate - 1) / frame_rate;
+	uint8_t scan_rate = frame_rate * divider;
+
+	err_code_t err = handle->panel->set_frame_rate(&handle->io, &scan_rate);
+	if (err != ERR_CODE_SUCCESS)
+	{
+		return err;
+	}
+
+	err = handle->panel->set_tear(&handle->io, 1);
+	if (err != ERR_CODE_SUCCESS)
+	{
+		return err;
+	}
+
+	handle->frame_rate = (scan_rate + divider / 2) / divider;
+	handle->frame_divider = divider;
+	handle->te_count = 0;
+
+	/* Edges seen before TE was set up are stale */
+	take_te_edges(handle);
+	handle->te_count = 0;
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_frame_submit(tft_driver_handle_t handle, uint8_t wait)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Not paced, frame goes out right away */
+	if (handle->frame_divider == 0)
+	{
+		return present_frame(handle);
+	}
+
+	/* Frame not presented yet is merged into this one, its damage is still marked */
+	if (handle->frame_pending)
+	{
+		handle->num_frame_dropped++;
+	}
+	handle->frame_pending = true;
+
+	/* Edges which came while drawing count toward the rate, the frame starts on a new one */
+	if (!wait)
+	{
+		take_te_edges(handle);
+		return ERR_CODE_SUCCESS;
+	}
+
+	/* Previous frame must be off the bus when the scan starts */
+	err_code_t err = tft_driver_refresh_wait(handle);
+	if (err != ERR_CODE_SUCCESS)
+	{
+		return err;
+	}
+
+	/* Edges which came while drawing count toward the rate, but refresh starts on a new one */
+	take_te_edges(handle);
+	do
+	{
+		if (handle->func_wait_te(TE_TIMEOUT_MS) != ERR_CODE_SUCCESS)
+		{
+			return ERR_CODE_FAIL;
+		}
+		if (handle->te_count < handle->frame_divider)
+		{
+			handle->te_count++;
+		}
+	} while (handle->te_count < handle->frame_divider);
+
+	return present_frame(handle);
+}
+
+err_code_t tft_driver_frame_poll(tft_driver_handle_t handle, uint8_t *is_presented)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	err_code_t err = ERR_CODE_SUCCESS;
+	bool presented = false;
+
+	/* Keep the previous frame going, the next one can not start before it is done */
+	if (handle->refresh_busy)
+	{
+		tft_driver_refresh_poll(handle, NULL);
+	}
+
+	/* Start only on an edge seen now, an older one may be in the middle of the scan */
+	if ((handle->frame_divider > 0) && take_te_edges(handle) && handle->frame_pending &&
+	    !handle->refresh_busy && (handle->te_count >= handle->frame_divider))
+	{
+		err = present_frame(handle);
+		presented = true;
+	}
+
+	if (is_presented != NULL)
+	{
+		*is_presented = presented;
+	}
+
+	return err;
+}
+
+err_code_t tft_driver_fill(tft_driver_handle_t handle, uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_FILL, .color = color};
+	cmd.args[0] = 0;
+	cmd.args[1] = 0;
+	cmd.args[2] = handle->width;
+	cmd.args[3] = handle->height;
+
+	return draw_cmd(handle, &cmd, 0, 0, handle->width - 1, handle->height - 1);
+}
+
+err_code_t tft_driver_write_char(tft_driver_handle_t handle,
+                                 font_size_t font_size,
+                                 uint8_t chr,
+                                 uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	uint8_t str[2] = {chr, '\0'};
+
+	return draw_string(handle, font_size, str, true, color);
+}
+
+err_code_t tft_driver_write_string(tft_driver_handle_t handle,
+                                   font_size_t font_size,
+                                   uint8_t *str,
+                                   uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	return draw_string(handle, font_size, str, false, color);
+}
+
+err_code_t tft_driver_write_pixel(tft_driver_handle_t handle,
+                                  uint16_t x,
+                                  uint16_t y,
+                                  uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_PIXEL, .color = color};
+	cmd.args[0] = x;
+	cmd.args[1] = y;
+
+	return draw_cmd(handle, &cmd, x, y, x, y);
+}
+
+err_code_t tft_driver_write_line(tft_driver_handle_t handle,
+                                 uint16_t x1,
+                                 uint16_t y1,
+                                 uint16_t x2,
+                                 uint16_t y2,
+                                 uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_LINE, .color = color};
+	cmd.args[0] = x1;
+	cmd.args[1] = y1;
+	cmd.args[2] = x2;
+	cmd.args[3] = y2;
+
+	return draw_cmd(handle,
+	                &cmd,
+	                (x1 < x2) ? x1 : x2,
+	                (y1 < y2) ? y1 : y2,
+	                (x1 < x2) ? x2 : x1,
+	                (y1 < y2) ? y2 : y1);
+}
+
+err_code_t tft_driver_write_rectangle(tft_driver_handle_t handle,
+                                      uint16_t x_origin,
+                                      uint16_t y_origin,
+                                      uint16_t width,
+                                      uint16_t height,
+                                      uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_RECT, .color = color};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = width;
+	cmd.args[3] = height;
+
+	/* Edges span from origin to origin + size, both ends included */
+	return draw_cmd(handle, &cmd, x_origin, y_origin, (int32_t)x_origin + width, (int32_t)y_origin + height);
+}
+
+err_code_t tft_driver_fill_rectangle(tft_driver_handle_t handle,
+                                     uint16_t x_origin,
+                                     uint16_t y_origin,
+                                     uint16_t width,
+                                     uint16_t height,
+                                     uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_FILL_RECT, .color = color};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = width;
+	cmd.args[3] = height;
+
+	return draw_cmd(handle, &cmd, x_origin, y_origin, (int32_t)x_origin + width - 1, (int32_t)y_origin + height - 1);
+}
+
+err_code_t tft_driver_write_circle(tft_driver_handle_t handle,
+                                   uint16_t x_origin,
+                                   uint16_t y_origin,
+                                   uint16_t radius,
+                                   uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_CIRCLE, .color = color};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = radius;
+
+	return draw_cmd(handle,
+	                &cmd,
+	                (int32_t)x_origin - radius,
+	                (int32_t)y_origin - radius,
+	                (int32_t)x_origin + radius,
+	                (int32_t)y_origin + radius);
+}
+
+err_code_t tft_driver_fill_circle(tft_driver_handle_t handle,
+                                  uint16_t x_origin,
+                                  uint16_t y_origin,
+                                  uint16_t radius,
+                                  uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_FILL_CIRCLE, .color = color};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = radius;
+
+	return draw_cmd(handle,
+	                &cmd,
+	                (int32_t)x_origin - radius,
+	                (int32_t)y_origin - radius,
+	                (int32_t)x_origin + radius,
+	                (int32_t)y_origin + radius);
+}
+
+err_code_t tft_driver_write_ellipse(tft_driver_handle_t handle,
+                                    uint16_t x_origin,
+                                    uint16_t y_origin,
+                                    uint16_t x_radius,
+                                    uint16_t y_radius,
+                                    uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_ELLIPSE, .color = color};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = x_radius;
+	cmd.args[3] = y_radius;
+
+	return draw_cmd(handle,
+	                &cmd,
+	                (int32_t)x_origin - x_radius,
+	                (int32_t)y_origin - y_radius,
+	                (int32_t)x_origin + x_radius,
+	                (int32_t)y_origin + y_radius);
+}
+
+err_code_t tft_driver_fill_ellipse(tft_driver_handle_t handle,
+                                   uint16_t x_origin,
+                                   uint16_t y_origin,
+                                   uint16_t x_radius,
+                                   uint16_t y_radius,
+                                   uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	cmd_t cmd = {.type = CMD_FILL_ELLIPSE, .color = color};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = x_radius;
+	cmd.args[3] = y_radius;
+
+	return draw_cmd(handle,
+	                &cmd,
+	                (int32_t)x_origin - x_radius,
+	                (int32_t)y_origin - y_radius,
+	                (int32_t)x_origin + x_radius,
+	                (int32_t)y_origin + y_radius);
+}
+
+err_code_t tft_driver_write_round_rectangle(tft_driver_handle_t handle,
+                                            uint16_t x_origin,
+                                            uint16_t y_origin,
+                                            uint16_t width,
+                                            uint16_t height,
+                                            uint16_t radius,
+                                            uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	if ((width == 0) || (height == 0))
+	{
+		return ERR_CODE_SUCCESS;
+	}
+
+	cmd_t cmd = {.type = CMD_ROUND_RECT, .color = color};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = width;
+	cmd.args[3] = height;
+	cmd.args[4] = clamp_corner_radius(width, height, radius);
+
+	return draw_cmd(handle, &cmd, x_origin, y_origin, (int32_t)x_origin + width - 1, (int32_t)y_origin + height - 1);
+}
+
+err_code_t tft_driver_fill_round_rectangle(tft_driver_handle_t handle,
+                                           uint16_t x_origin,
+                                           uint16_t y_origin,
+                                           uint16_t width,
+                                           uint16_t height,
+                                           uint16_t radius,
+                                           uint32_t color)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	if ((width == 0) || (height == 0))
+	{
+		return ERR_CODE_SUCCESS;
+	}
+
+	cmd_t cmd = {.type = CMD_FILL_ROUND_RECT, .color = color};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = width;
+	cmd.args[3] = height;
+	cmd.args[4] = clamp_corner_radius(width, height, radius);
+
+	return draw_cmd(handle, &cmd, x_origin, y_origin, (int32_t)x_origin + width - 1, (int32_t)y_origin + height - 1);
+}
+
+err_code_t tft_driver_blend_rectangle(tft_driver_handle_t handle,
+                                      uint16_t x_origin,
+                                      uint16_t y_origin,
+                                      uint16_t width,
+                                      uint16_t height,
+                                      uint32_t argb)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Blending reads back pixels, panel memory can not be read */
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	cmd_t cmd = {.type = CMD_BLEND_RECT, .color = argb};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = width;
+	cmd.args[3] = height;
+
+	return draw_cmd(handle, &cmd, x_origin, y_origin, (int32_t)x_origin + width - 1, (int32_t)y_origin + height - 1);
+}
+
+err_code_t tft_driver_write_line_aa(tft_driver_handle_t handle,
+                                    uint16_t x1,
+                                    uint16_t y1,
+                                    uint16_t x2,
+                                    uint16_t y2,
+                                    uint32_t argb)
 {
-	/* Convert pixel data to RGB565 format */
-	for (int idx = 0; idx < (handle->width * SPI_PARALLEL_LINES); idx++) {
-		uint8_t *p_src = handle->data + handle->width * height_idx * 3 + idx * 3;
-		uint16_t *p_desc = handle->lines[handle->line_idx].data + idx;
-
-		uint16_t color_565 = (((uint16_t)p_src[0] & 0x00F8) << 8) |
-		                     (((uint16_t)p_src[1] & 0x00FC) << 3) |
-		                     ((uint16_t)p_src[2] >> 3);
-		uint16_t swap565 = ((color_565 << 8) & 0xFF00) | ((color_565 >> 8) & 0x00FF);
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
 
-		*p_desc = swap565;
+	/* Blending reads back pixels, panel memory can not be read */
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE)
+	{
+		return ERR_CODE_FAIL;
 	}
+
+	cmd_t cmd = {.type = CMD_LINE_AA, .color = argb};
+	cmd.args[0] = x1;
+	cmd.args[1] = y1;
+	cmd.args[2] = x2;
+	cmd.args[3] = y2;
+
+	/* Coverage spills one pixel next to the exact line */
+	return draw_cmd(handle,
+	                &cmd,
+	                ((x1 < x2) ? x1 : x2) - 1,
+	                ((y1 < y2) ? y1 : y2) - 1,
+	                ((x1 < x2) ? x2 : x1) + 1,
+	                ((y1 < y2) ? y2 : y1) + 1);
 }
 
-static void write_pixel(tft_driver_handle_t handle, uint16_t x, uint16_t y, uint32_t color)
+err_code_t tft_driver_write_circle_aa(tft_driver_handle_t handle,
+                                      uint16_t x_origin,
+                                      uint16_t y_origin,
+                                      uint16_t radius,
+                                      uint32_t argb)
 {
-	uint8_t *p = handle->data + (x + y * handle->width) * 3;
-	p[0] = (color >> 16) & 0xFF;
-	p[1] = (color >> 8) & 0xFF;
-	p[2] = (color >> 0) & 0xFF;
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	/* Blending reads back pixels, panel memory can not be read */
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	cmd_t cmd = {.type = CMD_CIRCLE_AA, .color = argb};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	cmd.args[2] = radius;
+
+	/* Coverage spills one pixel outside of the radius */
+	return draw_cmd(handle,
+	                &cmd,
+	                (int32_t)x_origin - radius - 1,
+	                (int32_t)y_origin - radius - 1,
+	                (int32_t)x_origin + radius + 1,
+	                (int32_t)y_origin + radius + 1);
 }
 
-static void write_line(tft_driver_handle_t handle, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint32_t color)
+err_code_t tft_driver_blit(tft_driver_handle_t handle,
+                           uint16_t x_origin,
+                           uint16_t y_origin,
+                           const tft_driver_image_t *image)
 {
-	int32_t deltaX = abs(x2 - x1);
-	int32_t deltaY = abs(y2 - y1);
-	int32_t signX = ((x1 < x2) ? 1 : -1);
-	int32_t signY = ((y1 < y2) ? 1 : -1);
-	int32_t error = deltaX - deltaY;
-	int32_t error2;
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	if ((image == NULL) || (image->data == NULL))
+	{
+		return ERR_CODE_NULL_PTR;
+	}
 
-	write_pixel(handle, x2, y2, color);
+	if (image->format > TFT_DRIVER_IMAGE_FORMAT_RLE565)
+	{
+		return ERR_CODE_FAIL;
+	}
 
-	while ((x1 != x2) || (y1 != y2))
+	/* Indexed screen buffer has no colors to map image pixels to */
+	if ((handle->index_bits > 0) && (image->format != TFT_DRIVER_IMAGE_FORMAT_MONO))
 	{
-		write_pixel(handle, x1, y1, color);
+		return ERR_CODE_FAIL;
+	}
 
-		error2 = error * 2;
-		if (error2 > -deltaY) {
-			error -= deltaY;
-			x1 += signX;
-		} else {
-			/*nothing to do*/
-		}
+	cmd_t cmd = {.type = CMD_BLIT};
+	cmd.args[0] = x_origin;
+	cmd.args[1] = y_origin;
+	STATS_CALL(handle, CMD_BLIT);
 
-		if (error2 < deltaX) {
-			error += deltaX;
-			y1 += signY;
-		} else {
-			/*nothing to do*/
+	if (!cmd_set_bbox(handle, &cmd, x_origin, y_origin,
+	                  (int32_t)x_origin + image->width - 1, (int32_t)y_origin + image->height - 1))
+	{
+		return ERR_CODE_SUCCESS;
+	}
+
+	/* Only the image structure is recorded, pixel data is read on refresh */
+	if (handle->render_mode == TFT_DRIVER_RENDER_MODE_DISPLAY_LIST)
+	{
+		err_code_t err = record_cmd(handle, &cmd, image, sizeof(tft_driver_image_t));
+		if (err != ERR_CODE_SUCCESS)
+		{
+			return err;
 		}
 	}
+	else
+	{
+		STATS_PRIM(handle, CMD_BLIT);
+		blit_image(handle, x_origin, y_origin, image);
+	}
+
+	mark_cmd_dirty(handle, &cmd);
+
+	return ERR_CODE_SUCCESS;
 }
 
-static void write_lines(tft_driver_handle_t handle,
-                        uint16_t ypos,
-                        uint16_t parallel_line,
-                        uint16_t *lines_data)
+err_code_t tft_driver_push_clip(tft_driver_handle_t handle,
+                                uint16_t x_origin,
+                                uint16_t y_origin,
+                                uint16_t width,
+                                uint16_t height)
 {
-	/* Display multi-line data to screen. Every TFT has specific write output operation */
-#ifdef USE_ILI9341
-	ili9341_write_lines(handle->func_spi_trans,
-	                    handle->func_set_dc,
-	                    handle->width,
-	                    ypos,
-	                    parallel_line,
-	                    lines_data);
-#endif
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	if (handle->clip_depth >= MAX_CLIP_DEPTH)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* New clip is inside the current one, it is empty when start ends up past end */
+	rect_t clip = handle->clip;
+	if (x_origin > clip.x_start) clip.x_start = x_origin;
+	if (y_origin > clip.y_start) clip.y_start = y_origin;
+	if ((int32_t)x_origin + width - 1 < clip.x_end) clip.x_end = x_origin + width - 1;
+	if ((int32_t)y_origin + height - 1 < clip.y_end) clip.y_end = y_origin + height - 1;
+	if ((width == 0) || (height == 0))
+	{
+		clip.x_start = 1;
+		clip.x_end = 0;
+	}
+
+	handle->clip_stack[handle->clip_depth++] = handle->clip;
+	handle->clip = clip;
+	handle->target.clip = clip;
+
+	return ERR_CODE_SUCCESS;
 }
 
-tft_driver_handle_t tft_driver_init(void)
+err_code_t tft_driver_pop_clip(tft_driver_handle_t handle)
 {
-	tft_driver_handle_t handle = calloc(1, sizeof(tft_driver_t));
-
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
 	{
-		return NULL;
+		return ERR_CODE_NULL_PTR;
 	}
 
-	return handle;
+	if (handle->clip_depth == 0)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	handle->clip = handle->clip_stack[--handle->clip_depth];
+	handle->target.clip = handle->clip;
+
+	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_set_func(tft_driver_handle_t handle,
-                               tft_driver_spi_trans func_spi_trans,
-                               tft_driver_set_dc func_set_dc,
-                               tft_driver_set_rst func_set_rst,
-                               tft_driver_delay func_delay)
+err_code_t tft_driver_set_position(tft_driver_handle_t handle, uint16_t x, uint16_t y)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -133,15 +4623,13 @@ err_code_t tft_driver_set_func(tft_driver_handle_t handle,
 		return ERR_CODE_NULL_PTR;
 	}
 
-	handle->func_spi_trans = func_spi_trans;
-	handle->func_set_dc = func_set_dc;
-	handle->func_set_rst = func_set_rst;
-	handle->func_delay = func_delay;
+	handle->pos_x = x;
+	handle->pos_y = y;
 
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_config(tft_driver_handle_t handle, tft_driver_cfg_t config)
+err_code_t tft_driver_get_position(tft_driver_handle_t handle, uint16_t *x, uint16_t *y)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -149,37 +4637,35 @@ err_code_t tft_driver_config(tft_driver_handle_t handle, tft_driver_cfg_t config
 		return ERR_CODE_NULL_PTR;
 	}
 
-	/* Allocate memory for screen data buffer */
-	handle->data = calloc(config.width * config.height * 3, sizeof(uint8_t));
+	*x = handle->pos_x;
+	*y = handle->pos_y;
+
+	return ERR_CODE_SUCCESS;
+}
 
-	/* Allocate memory for lines buffer. These buffer will be used to store
-	   temporarily data of screen buffer */
-	for (uint8_t i = 0; i < MAX_LINE_BUF; i++)
+err_code_t tft_driver_mark_dirty(tft_driver_handle_t handle,
+                                 uint16_t x,
+                                 uint16_t y,
+                                 uint16_t width,
+                                 uint16_t height)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
 	{
-		handle->lines[i].data = calloc(config.width * SPI_PARALLEL_LINES, sizeof(uint16_t));
+		return ERR_CODE_NULL_PTR;
 	}
 
-	/* Call specific init function of TFT */
-#ifdef USE_ILI9341
-	ili9341_init(handle->func_spi_trans,
-	             handle->func_set_dc,
-	             handle->func_set_rst,
-	             handle->func_delay);
-#endif
+	if ((width == 0) || (height == 0))
+	{
+		return ERR_CODE_SUCCESS;
+	}
 
-	/* Update handle structure */
-	handle->width = config.width;
-	handle->height = config.height;
-	handle->line_idx = 0;
-	handle->pause = false;
-	handle->is_started = true;
-	handle->pos_x = 0;
-	handle->pos_y = 0;
+	mark_dirty(handle, x, y, (int32_t)x + width - 1, (int32_t)y + height - 1);
 
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_screen_refresh(tft_driver_handle_t handle)
+err_code_t tft_driver_scroll(tft_driver_handle_t handle, int16_t lines)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -187,52 +4673,90 @@ err_code_t tft_driver_screen_refresh(tft_driver_handle_t handle)
 		return ERR_CODE_NULL_PTR;
 	}
 
-	int sending_line;
+	/* Hardware scrolling moves panel memory rows, which are screen rows only in portrait */
+	if ((handle->render_mode != TFT_DRIVER_RENDER_MODE_FRAMEBUFFER) ||
+	    (handle->rotation != TFT_DRIVER_ROTATION_PORTRAIT) ||
+	    !(handle->panel->caps & TFT_DRIVER_PANEL_CAP_HW_SCROLL))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	pattern_t pattern;
+	make_pattern(handle, 0x000000, &pattern);
+
+	/* Cleared rows are stale content of the ring, clip rectangle does not apply */
+	handle->target.clip = handle->target.area;
+	STATS_PRIM(handle, CMD_FILL);
+
+	/* Everything scrolled out, nothing to move */
+	if ((lines >= handle->height) || (-lines >= handle->height))
+	{
+		fill_rect(handle, 0, 0, handle->width, handle->height, &pattern);
+		mark_dirty(handle, 0, 0, handle->width - 1, handle->height - 1);
+		handle->target.clip = handle->clip;
+
+		return ERR_CODE_SUCCESS;
+	}
 
-	/* Display all data from screen buffer to screen. Every cycle, SPI_PARALLEL_LINES
-	   rows will be updated */
-	for (int y = 0; y < handle->height; y += SPI_PARALLEL_LINES)
+	/* Layers stay in place on screen while the panel moves what was sent of them */
+	for (uint8_t idx = 0; idx < handle->num_layer; idx++)
 	{
-		/* Convert buffer data from RGB888 to RGB565 and put to lines buffer */
-		convert_pixel_to_lines(handle, y);
+		mark_layer_dirty(handle, &handle->layer[idx]);
+	}
 
-		/* Get current line buffer index */
-		sending_line = handle->line_idx;
+	/* Rotate screen buffer ring instead of moving its content. Damage already
+	   marked is kept in buffer rows, so it stays valid */
+	handle->scroll_offset = (handle->scroll_offset + lines + handle->height) % handle->height;
+	handle->target.y_offset = handle->scroll_offset;
+	handle->scroll_pending = true;
 
-		/* Display data to screen */
-		write_lines(handle, y, SPI_PARALLEL_LINES, handle->lines[sending_line].data);
+	for (uint8_t idx = 0; idx < handle->num_layer; idx++)
+	{
+		mark_layer_dirty(handle, &handle->layer[idx]);
+	}
 
-		/* Toggle to refer other buffer */
-		handle->line_idx ^= 1;
+	/* Rows scrolled in held content of the other edge, clear them */
+	if (lines > 0)
+	{
+		fill_rect(handle, 0, handle->height - lines, handle->width, lines, &pattern);
+		mark_dirty(handle, 0, handle->height - lines, handle->width - 1, handle->height - 1);
+	}
+	else if (lines < 0)
+	{
+		fill_rect(handle, 0, 0, handle->width, -lines, &pattern);
+		mark_dirty(handle, 0, 0, handle->width - 1, -lines - 1);
 	}
+	handle->target.clip = handle->clip;
 
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_fill(tft_driver_handle_t handle, uint32_t color)
+err_code_t tft_driver_set_layer(tft_driver_handle_t handle, uint8_t layer_id, const tft_driver_layer_t *layer)
 {
 	/* Check if handle structure is NULL */
-	if (handle == NULL)
+	if ((handle == NULL) || (layer == NULL))
 	{
 		return ERR_CODE_NULL_PTR;
 	}
 
-	/* Write RGB888 color to data buffer */
-	for (int idx = 0; idx < (handle->width * handle->height); idx++)
+	/* Layers are read while areas are prepared */
+	if ((layer_id >= handle->num_layer) || (layer->data == NULL) || handle->refresh_busy)
 	{
-		uint8_t *p = handle->data + idx * 3;
-		p[0] = (color >> 16) & 0xFF;
-		p[1] = (color >> 8) & 0xFF;
-		p[2] = (color >> 0) & 0xFF;
+		return ERR_CODE_FAIL;
 	}
 
+	/* Old place shows the screen again, new one shows the layer */
+	layer_t *p_layer = &handle->layer[layer_id];
+	mark_layer_dirty(handle, p_layer);
+	p_layer->cfg = *layer;
+	p_layer->key = color_to_565(layer->color_key);
+	mark_layer_dirty(handle, p_layer);
+	sort_layers(handle);
+
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_write_char(tft_driver_handle_t handle,
-                                 font_size_t font_size,
-                                 uint8_t chr,
-                                 uint32_t color)
+err_code_t tft_driver_move_layer(tft_driver_handle_t handle, uint8_t layer_id, int16_t x, int16_t y)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -240,35 +4764,21 @@ err_code_t tft_driver_write_char(tft_driver_handle_t handle,
 		return ERR_CODE_NULL_PTR;
 	}
 
-	/* Get font data */
-	font_t font;
-	if (get_font(chr, font_size, &font) <= 0)
+	if ((layer_id >= handle->num_layer) || handle->refresh_busy)
 	{
 		return ERR_CODE_FAIL;
 	}
 
-	/* Write character pixel data to buffer */
-	uint16_t num_byte_per_row = font.data_len / font.height;
-	for (uint16_t height_idx = 0; height_idx < font.height; height_idx ++) {
-		for ( uint8_t byte_idx = 0; byte_idx < num_byte_per_row; byte_idx++) {
-			for (uint16_t width_idx = 0; width_idx < 8; width_idx++) {
-				uint16_t x = handle->pos_x + width_idx + byte_idx * 8;
-				uint16_t y = handle->pos_y + height_idx;
-				if (((font.data[height_idx * num_byte_per_row + byte_idx] << width_idx) & 0x80) == 0x80) {
-					write_pixel(handle, x, y, color);
-				}
-			}
-		}
-	}
-	handle->pos_x += font.width + num_byte_per_row;
+	layer_t *p_layer = &handle->layer[layer_id];
+	mark_layer_dirty(handle, p_layer);
+	p_layer->cfg.x = x;
+	p_layer->cfg.y = y;
+	mark_layer_dirty(handle, p_layer);
 
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_write_string(tft_driver_handle_t handle,
-                                   font_size_t font_size,
-                                   uint8_t *str,
-                                   uint32_t color)
+err_code_t tft_driver_show_layer(tft_driver_handle_t handle, uint8_t layer_id, uint8_t visible)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -276,36 +4786,22 @@ err_code_t tft_driver_write_string(tft_driver_handle_t handle,
 		return ERR_CODE_NULL_PTR;
 	}
 
-	while (*str) {
-		font_t font;
-		if (get_font(*str, font_size, &font) <= 0)
-		{
-			return ERR_CODE_FAIL;
-		}
-
-		uint16_t num_byte_per_row = font.data_len / font.height;
-		for (uint16_t height_idx = 0; height_idx < font.height; height_idx ++) {
-			for ( uint16_t byte_idx = 0; byte_idx < num_byte_per_row; byte_idx++) {
-				for (uint16_t width_idx = 0; width_idx < 8; width_idx++) {
-					uint16_t x = handle->pos_x + width_idx + byte_idx * 8;
-					uint16_t y = handle->pos_y + height_idx;
-					if (((font.data[height_idx * num_byte_per_row + byte_idx] << width_idx) & 0x80) == 0x80) {
-						write_pixel(handle, x, y, color);
-					}
-				}
-			}
-		}
-		handle->pos_x += font.width + 1;
-		str++;
+	/* Layer without pixel data was never set */
+	if ((layer_id >= handle->num_layer) || (handle->layer[layer_id].cfg.data == NULL) || handle->refresh_busy)
+	{
+		return ERR_CODE_FAIL;
 	}
 
+	/* Area of the layer changes whether it is shown or hidden */
+	layer_t *p_layer = &handle->layer[layer_id];
+	p_layer->cfg.visible = true;
+	mark_layer_dirty(handle, p_layer);
+	p_layer->cfg.visible = visible;
+
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_write_pixel(tft_driver_handle_t handle,
-                                  uint16_t x,
-                                  uint16_t y,
-                                  uint32_t color)
+err_code_t tft_driver_mark_layer_dirty(tft_driver_handle_t handle, uint8_t layer_id)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -313,17 +4809,59 @@ err_code_t tft_driver_write_pixel(tft_driver_handle_t handle,
 		return ERR_CODE_NULL_PTR;
 	}
 
-	write_pixel(handle, x, y, color);
+	if ((layer_id >= handle->num_layer) || handle->refresh_busy)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	mark_layer_dirty(handle, &handle->layer[layer_id]);
 
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_write_line(tft_driver_handle_t handle,
-                                 uint16_t x1,
-                                 uint16_t y1,
-                                 uint16_t x2,
-                                 uint16_t y2,
-                                 uint32_t color)
+tft_driver_handle_t tft_driver_create_producer(tft_driver_handle_t handle)
+{
+	/* Check if handle structure is NULL */
+	if (handle == NULL)
+	{
+		return NULL;
+	}
+
+	/* Producers need a queue and can not feed another producer */
+	if ((handle->queue == NULL) || handle->is_producer)
+	{
+		return NULL;
+	}
+
+	tft_driver_handle_t producer = calloc(1, sizeof(tft_driver_t));
+	if (producer == NULL)
+	{
+		return NULL;
+	}
+
+	/* Commands are recorded as in display list mode, then queued instead of kept */
+	producer->width = handle->width;
+	producer->height = handle->height;
+	producer->pixel_format = handle->pixel_format;
+	producer->render_mode = TFT_DRIVER_RENDER_MODE_DISPLAY_LIST;
+	producer->rotation = handle->rotation;
+	producer->bytes_per_pixel = handle->bytes_per_pixel;
+	producer->index_bits = handle->index_bits;
+	producer->is_started = true;
+	producer->queue = handle->queue;
+	producer->is_producer = true;
+
+	producer->target.area.x_start = 0;
+	producer->target.area.y_start = 0;
+	producer->target.area.x_end = handle->width - 1;
+	producer->target.area.y_end = handle->height - 1;
+	producer->target.clip = producer->target.area;
+	producer->clip = producer->target.area;
+
+	return producer;
+}
+
+err_code_t tft_driver_queue_drain(tft_driver_handle_t handle, uint32_t max_cmd)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -331,81 +4869,108 @@ err_code_t tft_driver_write_line(tft_driver_handle_t handle,
 		return ERR_CODE_NULL_PTR;
 	}
 
-	write_line(handle, x1, y1, x2, y2, color);
+	/* Immediate mode draws on the panel, the bus must not be in use */
+	if ((handle->queue == NULL) || handle->is_producer ||
+	    ((handle->render_mode == TFT_DRIVER_RENDER_MODE_IMMEDIATE) && handle->refresh_busy))
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	drain_queue(handle, max_cmd);
+
+	return ERR_CODE_SUCCESS;
+}
+
+err_code_t tft_driver_get_queue_stats(tft_driver_handle_t handle, uint32_t *depth, uint32_t *max_depth, uint32_t *dropped)
+{
+	/* Check if handle structure is NULL */
+	if ((handle == NULL) || (depth == NULL) || (max_depth == NULL) || (dropped == NULL))
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+	if (handle->queue == NULL)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	/* Claimed slots count, including those still being filled. Tail is read
+	   first so it can not have passed the head read after it */
+	uint32_t tail = atomic_load_explicit(&handle->queue->tail, memory_order_acquire);
+	*depth = atomic_load_explicit(&handle->queue->head, memory_order_acquire) - tail;
+	*max_depth = atomic_load_explicit(&handle->queue->max_depth, memory_order_relaxed);
+	*dropped = atomic_load_explicit(&handle->queue->num_dropped, memory_order_relaxed);
 
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_write_rectangle(tft_driver_handle_t handle,
-                                      uint16_t x_origin,
-                                      uint16_t y_origin,
-                                      uint16_t width,
-                                      uint16_t height,
-                                      uint32_t color)
+err_code_t tft_driver_get_glyph_cache_stats(tft_driver_handle_t handle, uint32_t *hit, uint32_t *miss)
 {
 	/* Check if handle structure is NULL */
-	if (handle == NULL)
+	if ((handle == NULL) || (hit == NULL) || (miss == NULL))
 	{
 		return ERR_CODE_NULL_PTR;
 	}
 
-	write_line(handle, x_origin, y_origin, x_origin + width, y_origin, color);
-	write_line(handle, x_origin + width, y_origin, x_origin + width, y_origin + height, color);
-	write_line(handle, x_origin + width, y_origin + height, x_origin, y_origin + height, color);
-	write_line(handle, x_origin, y_origin + height, x_origin, y_origin, color);
+	*hit = handle->glyph_cache_hit;
+	*miss = handle->glyph_cache_miss;
 
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_write_circle(tft_driver_handle_t handle,
-                                   uint16_t x_origin,
-                                   uint16_t y_origin,
-                                   uint16_t radius,
-                                   uint32_t color)
+err_code_t tft_driver_get_frame_stats(tft_driver_handle_t handle,
+                                      uint8_t *frame_rate,
+                                      uint32_t *presented,
+                                      uint32_t *dropped)
 {
 	/* Check if handle structure is NULL */
-	if (handle == NULL)
+	if ((handle == NULL) || (frame_rate == NULL) || (presented == NULL) || (dropped == NULL))
 	{
 		return ERR_CODE_NULL_PTR;
 	}
 
-	int32_t x = -radius;
-	int32_t y = 0;
-	int32_t err = 2 - 2 * radius;
-	int32_t e2;
+	*frame_rate = handle->frame_rate;
+	*presented = handle->num_frame_presented;
+	*dropped = handle->num_frame_dropped;
 
-	do {
-		write_pixel(handle, x_origin - x, y_origin + y, color);
-		write_pixel(handle, x_origin + x, y_origin + y, color);
-		write_pixel(handle, x_origin + x, y_origin - y, color);
-		write_pixel(handle, x_origin - x, y_origin - y, color);
+	return ERR_CODE_SUCCESS;
+}
 
-		e2 = err;
-		if (e2 <= y) {
-			y++;
-			err = err + (y * 2 + 1);
-			if (-x == y && e2 <= x) {
-				e2 = 0;
-			}
-			else {
-				/*nothing to do*/
-			}
-		} else {
-			/*nothing to do*/
-		}
+err_code_t tft_driver_get_hash_stats(tft_driver_handle_t handle, uint32_t *hashed, uint32_t *skipped)
+{
+	/* Check if handle structure is NULL */
+	if ((handle == NULL) || (hashed == NULL) || (skipped == NULL))
+	{
+		return ERR_CODE_NULL_PTR;
+	}
 
-		if (e2 > x) {
-			x++;
-			err = err + (x * 2 + 1);
-		} else {
-			/*nothing to do*/
-		}
-	} while (x <= 0);
+	*hashed = handle->num_band_hashed;
+	*skipped = handle->num_band_skipped;
 
 	return ERR_CODE_SUCCESS;
 }
 
-err_code_t tft_driver_set_position(tft_driver_handle_t handle, uint16_t x, uint16_t y)
+err_code_t tft_driver_get_stats(tft_driver_handle_t handle, tft_driver_stats_t *stats)
+{
+	/* Check if handle structure is NULL */
+	if ((handle == NULL) || (stats == NULL))
+	{
+		return ERR_CODE_NULL_PTR;
+	}
+
+#ifdef TFT_DRIVER_ENABLE_STATS
+	/* Transfers are counted by panel IO, commands included */
+	*stats = handle->stats;
+	stats->num_trans = handle->io.num_trans;
+	stats->num_byte = handle->io.num_byte;
+
+	return ERR_CODE_SUCCESS;
+#else
+	return ERR_CODE_FAIL;
+#endif
+}
+
+err_code_t tft_driver_reset_stats(tft_driver_handle_t handle)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -413,13 +4978,18 @@ err_code_t tft_driver_set_position(tft_driver_handle_t handle, uint16_t x, uint1
 		return ERR_CODE_NULL_PTR;
 	}
 
-	handle->pos_x = x;
-	handle->pos_y = y;
+#ifdef TFT_DRIVER_ENABLE_STATS
+	memset(&handle->stats, 0, sizeof(handle->stats));
+	handle->io.num_trans = 0;
+	handle->io.num_byte = 0;
 
 	return ERR_CODE_SUCCESS;
+#else
+	return ERR_CODE_FAIL;
+#endif
 }
 
-err_code_t tft_driver_get_position(tft_driver_handle_t handle, uint16_t *x, uint16_t *y)
+err_code_t tft_driver_set_palette(tft_driver_handle_t handle, const uint32_t *palette)
 {
 	/* Check if handle structure is NULL */
 	if (handle == NULL)
@@ -427,8 +4997,17 @@ err_code_t tft_driver_get_position(tft_driver_handle_t handle, uint16_t *x, uint
 		return ERR_CODE_NULL_PTR;
 	}
 
-	*x = handle->pos_x;
-	*y = handle->pos_y;
+	/* Only indexed formats have a palette, refresh may be reading its table */
+	if ((handle->index_bits == 0) || handle->refresh_busy || handle->is_producer)
+	{
+		return ERR_CODE_FAIL;
+	}
+
+	build_index_lut(handle, palette);
+
+	/* Every pixel may have changed color, panel no longer holds what was hashed */
+	handle->band_hash_valid = 0;
+	mark_dirty(handle, 0, 0, handle->width - 1, handle->height - 1);
 
 	return ERR_CODE_SUCCESS;
 }
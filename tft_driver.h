@@ -36,12 +36,145 @@ extern "C" {
  */
 typedef struct tft_driver* tft_driver_handle_t;
 
+/**
+ * @enum    Screen buffer pixel format.
+ */
+typedef enum {
+    TFT_DRIVER_PIXEL_FORMAT_RGB888 = 0,         /*!< 3 bytes per pixel, R, G, B byte order */
+    TFT_DRIVER_PIXEL_FORMAT_RGB565,             /*!< 2 bytes per pixel, panel native byte swapped RGB565 */
+    TFT_DRIVER_PIXEL_FORMAT_INDEX1,             /*!< 1 bit palette index per pixel, rows packed, most significant bits leftmost */
+    TFT_DRIVER_PIXEL_FORMAT_INDEX2,             /*!< 2 bit palette index per pixel, rows packed, most significant bits leftmost */
+    TFT_DRIVER_PIXEL_FORMAT_INDEX4,             /*!< 4 bit palette index per pixel, rows packed, most significant bits leftmost */
+    TFT_DRIVER_PIXEL_FORMAT_INDEX8,             /*!< 1 byte palette index per pixel */
+} tft_driver_pixel_format_t;
+
+/**
+ * @enum    Render mode.
+ */
+typedef enum {
+    TFT_DRIVER_RENDER_MODE_FRAMEBUFFER = 0,     /*!< Draw into screen buffer, send on refresh */
+    TFT_DRIVER_RENDER_MODE_IMMEDIATE,           /*!< Draw straight to the panel, no screen buffer */
+    TFT_DRIVER_RENDER_MODE_DISPLAY_LIST,        /*!< Record drawing, render it band by band on refresh */
+} tft_driver_render_mode_t;
+
+/**
+ * @enum    Screen rotation.
+ */
+typedef enum {
+    TFT_DRIVER_ROTATION_LANDSCAPE = 0,          /*!< Landscape, width 320 and height 240 */
+    TFT_DRIVER_ROTATION_PORTRAIT,               /*!< Portrait, width 240 and height up to 320, can scroll */
+} tft_driver_rotation_t;
+
+/**
+ * @enum    Image pixel format.
+ */
+typedef enum {
+    TFT_DRIVER_IMAGE_FORMAT_RGB565 = 0,         /*!< 2 bytes per pixel, panel native byte swapped RGB565 */
+    TFT_DRIVER_IMAGE_FORMAT_RGB888,             /*!< 3 bytes per pixel, R, G, B byte order */
+    TFT_DRIVER_IMAGE_FORMAT_MONO,               /*!< 1 bit per pixel, most significant bit leftmost */
+    TFT_DRIVER_IMAGE_FORMAT_RLE565,             /*!< RLE565 stream of codec/rle565.h, stride is unused */
+} tft_driver_image_format_t;
+
+/**
+ * @struct  Image to blit. Pixel data is read in place, it may live in flash
+ *          or mapped memory. Rows in the screen buffer format are copied as is.
+ */
+typedef struct {
+    const uint8_t               *data;
+    uint16_t                    width;
+    uint16_t                    height;
+    uint16_t                    stride;         /*!< Bytes per row, 0 when rows are packed */
+    tft_driver_image_format_t   format;
+    uint32_t                    color;          /*!< Mono only, color of set bits */
+    uint32_t                    bg_color;       /*!< Mono only, color of cleared bits */
+    uint8_t                     use_color_key;  /*!< Skip transparent pixels */
+    uint32_t                    color_key;      /*!< Transparent color, mono skips cleared bits instead */
+} tft_driver_image_t;
+
+/**
+ * @struct  Layer composited over the screen on refresh. Pixel data is read in
+ *          place on every refresh, it has to stay valid while the layer is shown.
+ */
+typedef struct {
+    const uint16_t              *data;          /*!< Panel native byte swapped RGB565, rows packed */
+    int16_t                     x;              /*!< Screen position, may be partly outside of screen */
+    int16_t                     y;
+    uint16_t                    width;
+    uint16_t                    height;
+    uint8_t                     z_order;        /*!< Higher layers are composited over lower ones */
+    uint8_t                     visible;
+    uint8_t                     use_color_key;  /*!< Skip transparent pixels */
+    uint32_t                    color_key;      /*!< Transparent color */
+    uint8_t                     alpha;          /*!< Opacity, 255 for opaque */
+} tft_driver_layer_t;
+
+/**
+ * @enum    Drawing primitive, index of per primitive statistics.
+ */
+typedef enum {
+    TFT_DRIVER_PRIM_FILL = 0,
+    TFT_DRIVER_PRIM_PIXEL,
+    TFT_DRIVER_PRIM_LINE,
+    TFT_DRIVER_PRIM_RECT,
+    TFT_DRIVER_PRIM_FILL_RECT,
+    TFT_DRIVER_PRIM_CIRCLE,
+    TFT_DRIVER_PRIM_FILL_CIRCLE,
+    TFT_DRIVER_PRIM_ELLIPSE,
+    TFT_DRIVER_PRIM_FILL_ELLIPSE,
+    TFT_DRIVER_PRIM_ROUND_RECT,
+    TFT_DRIVER_PRIM_FILL_ROUND_RECT,
+    TFT_DRIVER_PRIM_TEXT,
+    TFT_DRIVER_PRIM_BLEND_RECT,
+    TFT_DRIVER_PRIM_LINE_AA,
+    TFT_DRIVER_PRIM_CIRCLE_AA,
+    TFT_DRIVER_PRIM_BLIT,
+    TFT_DRIVER_PRIM_MAX,
+} tft_driver_prim_t;
+
+/**
+ * @struct  Statistics of one drawing primitive.
+ */
+typedef struct {
+    uint32_t                    num_call;       /*!< API calls */
+    uint64_t                    num_pixel;      /*!< Pixels written, display list mode writes them on every refresh */
+} tft_driver_prim_stats_t;
+
+/**
+ * @struct  Driver statistics. Times need a clock, see tft_driver_set_func_clock.
+ */
+typedef struct {
+    uint32_t                    num_refresh;    /*!< Refreshes completed */
+    uint32_t                    refresh_time_us; /*!< Last refresh, from start until the last transfer is done */
+    uint32_t                    max_refresh_time_us; /*!< Slowest refresh */
+    uint32_t                    prepare_time_us; /*!< Last refresh, converting or rendering areas */
+    uint32_t                    trans_time_us;  /*!< Last refresh, sending or waiting for transfers */
+    uint32_t                    frame_interval_us; /*!< Between starts of the last two refreshes */
+    uint32_t                    fps;            /*!< Average refreshes per second */
+    uint32_t                    num_area;       /*!< Areas sent, each is at most one band of lines buffer */
+    uint64_t                    num_pixel_sent; /*!< Pixels sent by refreshes */
+    uint64_t                    num_pixel_skipped; /*!< Pixels not sent by refreshes as they did not change */
+    uint32_t                    num_trans;      /*!< SPI transfers, commands included */
+    uint64_t                    num_byte;       /*!< SPI bytes, commands included */
+    tft_driver_prim_stats_t     prim[TFT_DRIVER_PRIM_MAX];
+} tft_driver_stats_t;
+
 /**
  * @struct  TFT driver configuration structure.
  */
 typedef struct {
-    uint16_t height;
-    uint16_t width;
+    uint16_t                    height;
+    uint16_t                    width;
+    tft_driver_pixel_format_t   pixel_format;   /*!< Screen buffer pixel format */
+    uint16_t                    glyph_cache_size; /*!< Number of cached glyphs, 0 to disable */
+    tft_driver_render_mode_t    render_mode;    /*!< Render mode, pixel_format is only used in framebuffer mode */
+    uint32_t                    display_list_size; /*!< Bytes of display list, 0 for default */
+    tft_driver_rotation_t       rotation;       /*!< Screen rotation */
+    const tft_driver_panel_t    *panel;         /*!< Panel backend, NULL for ILI9341 */
+    uint8_t                     num_parallel_band; /*!< Areas prepared together on workers, 0 for one */
+    const uint32_t              *palette;       /*!< Indexed formats only, RGB888 color of every index, NULL for gray levels */
+    uint8_t                     skip_unchanged; /*!< Framebuffer mode only, skip refresh of rows whose content is already on the panel */
+    uint8_t                     num_layer;      /*!< Layers composited on refresh, not available in immediate mode */
+    uint16_t                    cmd_queue_size; /*!< Slots of drawing command queue fed by producer handles, power of two, 0 to disable */
 } tft_driver_cfg_t;
 
 /*
@@ -78,9 +211,99 @@ err_code_t tft_driver_set_func(tft_driver_handle_t handle,
                                tft_driver_set_rst func_set_rst,
                                tft_driver_delay func_delay);
 
+/*
+ * @brief   Set asynchronous communication function.
+ *
+ * @note    When set, refresh overlaps conversion of the next areas with SPI
+ *          transfer of the previous ones. Transport must be able to queue
+ *          two transfers per parallel band. Pass NULL to disable.
+ *
+ * @param   handle Handle structure.
+ * @param   func_spi_queue_trans Function queue SPI transfer.
+ * @param   func_spi_wait_trans Function wait queued SPI transfer.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_set_func_async(tft_driver_handle_t handle,
+                                     tft_driver_spi_queue_trans func_spi_queue_trans,
+                                     tft_driver_spi_wait_trans func_spi_wait_trans);
+
+/*
+ * @brief   Set parallel run function.
+ *
+ * @note    When set and num_parallel_band of the configuration is greater
+ *          than one, refresh converts screen buffer areas, or renders
+ *          display list areas, of one band group on all workers at the same
+ *          time. SPI transfers stay in order on the calling thread. Pass
+ *          NULL to disable.
+ *
+ * @param   handle Handle structure.
+ * @param   func_run_parallel Function run job on workers.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_set_func_parallel(tft_driver_handle_t handle,
+                                        tft_driver_run_parallel func_run_parallel);
+
+/*
+ * @brief   Set transfer list communication function.
+ *
+ * @note    When set, window setup, memory write command and pixel data are
+ *          handed over as one list, so the port can send them as one DMA
+ *          chain. Pass NULL to disable.
+ *
+ * @param   handle Handle structure.
+ * @param   func_spi_trans_list Function send SPI transfer list.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_set_func_trans_list(tft_driver_handle_t handle,
+                                          tft_driver_spi_trans_list func_spi_trans_list);
+
+/*
+ * @brief   Set clock function used to time refreshes for statistics.
+ *
+ * @param   handle Handle structure.
+ * @param   func_get_time_us Function get microsecond clock.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_set_func_clock(tft_driver_handle_t handle,
+                                     tft_driver_get_time_us func_get_time_us);
+
+/*
+ * @brief   Set function waiting for panel TE output, needed for paced refresh.
+ *
+ * @param   handle Handle structure.
+ * @param   func_wait_te Function wait TE rising edge.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_set_func_tear(tft_driver_handle_t handle,
+                                    tft_driver_wait_te func_wait_te);
+
 /*
  * @brief   Configure TFT ready for display.
  *
+ * @note    In indexed pixel formats, colors given to drawing functions are
+ *          palette indices. Blending draws pixels of at least half coverage
+ *          opaque and only mono images can be blitted.
+ *
+ * @note    With skip_unchanged set, changed areas are hashed in bands of
+ *          SPI_PARALLEL_LINES rows on refresh. Bands hashing the same as
+ *          when last sent are not transmitted. Screen height is limited to
+ *          32 bands.
+ *
  * @param   handle Handle structure.
  * @param   config Config structure.
  *
@@ -90,9 +313,27 @@ err_code_t tft_driver_set_func(tft_driver_handle_t handle,
  */
 err_code_t tft_driver_config(tft_driver_handle_t handle, tft_driver_cfg_t config);
 
+/*
+ * @brief   Enter or leave panel sleep mode.
+ *
+ * @note    Screen buffer is kept, refresh after leaving sleep mode is not needed.
+ *
+ * @param   handle Handle structure.
+ * @param   enable 1 to enter sleep mode, 0 to leave it.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_sleep(tft_driver_handle_t handle, uint8_t enable);
+
 /*
  * @brief   Refresh screen.
  *
+ * @note    Only areas changed by drawing functions since the last refresh
+ *          are transmitted. Call tft_driver_mark_dirty after writing to
+ *          the screen buffer directly.
+ *
  * @param   handle Handle structure.
  *
  * @return
@@ -101,9 +342,99 @@ err_code_t tft_driver_config(tft_driver_handle_t handle, tft_driver_cfg_t config
  */
 err_code_t tft_driver_screen_refresh(tft_driver_handle_t handle);
 
+/*
+ * @brief   Start refreshing screen without waiting.
+ *
+ * @note    Requires asynchronous communication function. Drawing after this
+ *          call is transmitted with the next frame. Call tft_driver_refresh_poll
+ *          to keep the transfer going and to know when the frame is done.
+ *
+ * @param   handle Handle structure.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_screen_refresh_async(tft_driver_handle_t handle);
+
+/*
+ * @brief   Continue asynchronous refresh without blocking.
+ *
+ * @param   handle Handle structure.
+ * @param   is_done Pointer references to the frame done flag. Can be NULL.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_refresh_poll(tft_driver_handle_t handle, uint8_t *is_done);
+
+/*
+ * @brief   Wait asynchronous refresh to complete.
+ *
+ * @param   handle Handle structure.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_refresh_wait(tft_driver_handle_t handle);
+
+/*
+ * @brief   Pace refresh of submitted frames to panel TE output.
+ *
+ * @note    Panel TE output is enabled and the panel scans at the rate, or at
+ *          a multiple of it for rates below 50 Hz. Frames start at vertical
+ *          blanking and damaged rectangles go out in scan order, so writes
+ *          stay ahead of the scan. Configuring the panel again turns pacing off.
+ *
+ * @param   handle Handle structure.
+ * @param   frame_rate Frames per second, 0 to stop pacing.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_set_frame_rate(tft_driver_handle_t handle, uint8_t frame_rate);
+
+/*
+ * @brief   Submit frame drawn since the last one.
+ *
+ * @note    Frame goes out on the next TE edge its rate allows. A frame
+ *          submitted before the previous one went out is merged into it and
+ *          counted as dropped. Without pacing, frame is refreshed right away.
+ *
+ * @param   handle Handle structure.
+ * @param   wait 1 to wait until frame starts going out, 0 to leave it to tft_driver_frame_poll.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_frame_submit(tft_driver_handle_t handle, uint8_t wait);
+
+/*
+ * @brief   Start submitted frame if its TE edge came, without blocking.
+ *
+ * @note    Call it at least once per panel frame, a frame only starts on an
+ *          edge seen by this call. Asynchronous refresh is kept going too.
+ *
+ * @param   handle Handle structure.
+ * @param   is_presented Pointer references to the frame started flag. Can be NULL.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_frame_poll(tft_driver_handle_t handle, uint8_t *is_presented);
+
 /**
  * @brief   Fill screen with color.
  *
+ * @note    In display list render mode this also discards all recorded
+ *          drawing, it is hidden below the fill. Drawing functions fail
+ *          when the display list is full.
+ *
  * @param   handle Handle structure.
  * @param   color Color.
  *
@@ -206,6 +537,27 @@ err_code_t tft_driver_write_rectangle(tft_driver_handle_t handle,
                                       uint16_t height,
                                       uint32_t color);
 
+/**
+ * @brief   Fill rectangle.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin Origin horizontal position.
+ * @param   y_origin Origin vertical position.
+ * @param   width Width in pixel.
+ * @param   height Height in pixel.
+ * @param   color Color.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_fill_rectangle(tft_driver_handle_t handle,
+                                     uint16_t x_origin,
+                                     uint16_t y_origin,
+                                     uint16_t width,
+                                     uint16_t height,
+                                     uint32_t color);
+
 /**
  * @brief   Write Circle.
  *
@@ -225,6 +577,239 @@ err_code_t tft_driver_write_circle(tft_driver_handle_t handle,
                                    uint16_t radius,
                                    uint32_t color);
 
+/**
+ * @brief   Fill circle.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin Origin horizontal position.
+ * @param   y_origin Origin vertical position.
+ * @param   radius Radius in pixel.
+ * @param   color Color.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_fill_circle(tft_driver_handle_t handle,
+                                  uint16_t x_origin,
+                                  uint16_t y_origin,
+                                  uint16_t radius,
+                                  uint32_t color);
+
+/**
+ * @brief   Write ellipse.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin Origin horizontal position.
+ * @param   y_origin Origin vertical position.
+ * @param   x_radius Horizontal radius in pixel.
+ * @param   y_radius Vertical radius in pixel.
+ * @param   color Color.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_write_ellipse(tft_driver_handle_t handle,
+                                    uint16_t x_origin,
+                                    uint16_t y_origin,
+                                    uint16_t x_radius,
+                                    uint16_t y_radius,
+                                    uint32_t color);
+
+/**
+ * @brief   Fill ellipse.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin Origin horizontal position.
+ * @param   y_origin Origin vertical position.
+ * @param   x_radius Horizontal radius in pixel.
+ * @param   y_radius Vertical radius in pixel.
+ * @param   color Color.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_fill_ellipse(tft_driver_handle_t handle,
+                                   uint16_t x_origin,
+                                   uint16_t y_origin,
+                                   uint16_t x_radius,
+                                   uint16_t y_radius,
+                                   uint32_t color);
+
+/**
+ * @brief   Write rounded rectangle.
+ *
+ * @note    Radius is limited to half of the shorter side.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin Origin horizontal position.
+ * @param   y_origin Origin vertical position.
+ * @param   width Width in pixel.
+ * @param   height Height in pixel.
+ * @param   radius Corner radius in pixel.
+ * @param   color Color.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_write_round_rectangle(tft_driver_handle_t handle,
+                                            uint16_t x_origin,
+                                            uint16_t y_origin,
+                                            uint16_t width,
+                                            uint16_t height,
+                                            uint16_t radius,
+                                            uint32_t color);
+
+/**
+ * @brief   Fill rounded rectangle.
+ *
+ * @note    Radius is limited to half of the shorter side.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin Origin horizontal position.
+ * @param   y_origin Origin vertical position.
+ * @param   width Width in pixel.
+ * @param   height Height in pixel.
+ * @param   radius Corner radius in pixel.
+ * @param   color Color.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_fill_round_rectangle(tft_driver_handle_t handle,
+                                           uint16_t x_origin,
+                                           uint16_t y_origin,
+                                           uint16_t width,
+                                           uint16_t height,
+                                           uint16_t radius,
+                                           uint32_t color);
+
+/**
+ * @brief   Blend rectangle over screen content.
+ *
+ * @note    Not available in immediate render mode. RGB565 uses 32 alpha levels.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin X origin.
+ * @param   y_origin Y origin.
+ * @param   width Width.
+ * @param   height Height.
+ * @param   argb Color with alpha in the top byte, 0xFF is opaque.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_blend_rectangle(tft_driver_handle_t handle,
+                                      uint16_t x_origin,
+                                      uint16_t y_origin,
+                                      uint16_t width,
+                                      uint16_t height,
+                                      uint32_t argb);
+
+/**
+ * @brief   Write anti-aliased line.
+ *
+ * @note    Not available in immediate render mode.
+ *
+ * @param   handle Handle structure.
+ * @param   x1 The first horizontal position.
+ * @param   y1 The first vertical postion.
+ * @param   x2 The second horizontal position.
+ * @param   y2 The second vertical position.
+ * @param   argb Color with alpha in the top byte, 0xFF is opaque.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_write_line_aa(tft_driver_handle_t handle,
+                                    uint16_t x1,
+                                    uint16_t y1,
+                                    uint16_t x2,
+                                    uint16_t y2,
+                                    uint32_t argb);
+
+/**
+ * @brief   Write anti-aliased circle.
+ *
+ * @note    Not available in immediate render mode.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin X origin.
+ * @param   y_origin Y origin.
+ * @param   radius Radius.
+ * @param   argb Color with alpha in the top byte, 0xFF is opaque.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_write_circle_aa(tft_driver_handle_t handle,
+                                      uint16_t x_origin,
+                                      uint16_t y_origin,
+                                      uint16_t radius,
+                                      uint32_t argb);
+
+/**
+ * @brief   Draw image.
+ *
+ * @note    Part outside of screen is clipped. In display list mode pixel data
+ *          is read again on every refresh, it has to stay valid and unchanged
+ *          while the image is on screen. RLE565 images are decoded from their
+ *          first pixel for every band they touch.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin X origin.
+ * @param   y_origin Y origin.
+ * @param   image Image, the structure itself may be released after the call.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_blit(tft_driver_handle_t handle,
+                           uint16_t x_origin,
+                           uint16_t y_origin,
+                           const tft_driver_image_t *image);
+
+/**
+ * @brief   Limit drawing to a rectangle inside the current clip rectangle.
+ *
+ * @note    Every drawing function including tft_driver_fill only touches
+ *          pixels inside the clip rectangle. Clip rectangles nest up to 8 deep.
+ *
+ * @param   handle Handle structure.
+ * @param   x_origin X origin.
+ * @param   y_origin Y origin.
+ * @param   width Width, 0 to drop all drawing.
+ * @param   height Height, 0 to drop all drawing.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_push_clip(tft_driver_handle_t handle,
+                                uint16_t x_origin,
+                                uint16_t y_origin,
+                                uint16_t width,
+                                uint16_t height);
+
+/**
+ * @brief   Restore clip rectangle active before the last push.
+ *
+ * @param   handle Handle structure.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_pop_clip(tft_driver_handle_t handle);
+
 /**
  * @brief   Set current position.
  *
@@ -251,9 +836,240 @@ err_code_t tft_driver_set_position(tft_driver_handle_t handle, uint16_t x, uint1
  */
 err_code_t tft_driver_get_position(tft_driver_handle_t handle, uint16_t *x, uint16_t *y);
 
+/**
+ * @brief   Mark area as changed so it is transmitted on next refresh.
+ *
+ * @param   handle Handle structure.
+ * @param   x Horizontal position.
+ * @param   y Vertical position.
+ * @param   width Width in pixel.
+ * @param   height Height in pixel.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_mark_dirty(tft_driver_handle_t handle,
+                                 uint16_t x,
+                                 uint16_t y,
+                                 uint16_t width,
+                                 uint16_t height);
+
+/**
+ * @brief   Scroll screen vertically.
+ *
+ * @note    Screen buffer is not moved, only the row shown at the top of
+ *          screen changes. Next refresh sends one command and the rows
+ *          scrolled in, which are cleared to black. Only available in
+ *          framebuffer render mode with portrait rotation, on panels with
+ *          hardware scroll capability. After scrolling, screen row y is
+ *          stored at row (y + scrolled lines) % height of the screen buffer.
+ *
+ * @param   handle Handle structure.
+ * @param   lines Number of lines content moves up, negative to move down.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_scroll(tft_driver_handle_t handle, int16_t lines);
+
+/*
+ * @brief   Set layer.
+ *
+ * @note    Layers are composited while areas are converted for transmission,
+ *          the screen buffer is not changed. Moving or hiding a layer needs
+ *          no redraw of what is below it.
+ *
+ * @param   handle Handle structure.
+ * @param   layer_id Layer index, below num_layer of the configuration.
+ * @param   layer Layer, the structure itself may be released after the call.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_set_layer(tft_driver_handle_t handle, uint8_t layer_id, const tft_driver_layer_t *layer);
+
+/*
+ * @brief   Move layer.
+ *
+ * @param   handle Handle structure.
+ * @param   layer_id Layer index.
+ * @param   x X position.
+ * @param   y Y position.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_move_layer(tft_driver_handle_t handle, uint8_t layer_id, int16_t x, int16_t y);
+
+/*
+ * @brief   Show or hide layer.
+ *
+ * @param   handle Handle structure.
+ * @param   layer_id Layer index.
+ * @param   visible 1 to show the layer, 0 to hide it.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_show_layer(tft_driver_handle_t handle, uint8_t layer_id, uint8_t visible);
+
+/*
+ * @brief   Mark layer to be refreshed after its pixel data was changed.
+ *
+ * @param   handle Handle structure.
+ * @param   layer_id Layer index.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_mark_layer_dirty(tft_driver_handle_t handle, uint8_t layer_id);
+
+/*
+ * @brief   Create producer handle drawing through the queue of a configured
+ *          driver.
+ *
+ * @note    Drawing functions called on a producer never block, commands are
+ *          queued lock free and drawn by the task owning the driver when it
+ *          drains the queue, which asynchronous refresh does between
+ *          transfers. A full queue drops the command and the function fails.
+ *          Every producing task needs its own producer, which keeps its own
+ *          position and clip rectangle. Strings longer than 47 characters
+ *          can not be queued, image data must stay valid until drawn.
+ *
+ * @param   handle Handle structure configured with cmd_queue_size.
+ *
+ * @return
+ *      - Producer handle structure.
+ *      - NULL: Fail.
+ */
+tft_driver_handle_t tft_driver_create_producer(tft_driver_handle_t handle);
+
+/*
+ * @brief   Draw commands queued by producers.
+ *
+ * @note    Commands queued after the call started are left for the next one.
+ *          Refresh only sends them once they were drained.
+ *
+ * @param   handle Handle structure.
+ * @param   max_cmd Maximum number of commands to draw, 0 for all.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_queue_drain(tft_driver_handle_t handle, uint32_t max_cmd);
+
+/*
+ * @brief   Get drawing command queue statistics.
+ *
+ * @param   handle Handle structure or one of its producers.
+ * @param   depth Pointer references to the number of queued commands.
+ * @param   max_depth Pointer references to the highest number of queued commands.
+ * @param   dropped Pointer references to the number of commands dropped,
+ *          because the queue or display list was full or the command can
+ *          not be drawn in the render mode.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_get_queue_stats(tft_driver_handle_t handle, uint32_t *depth, uint32_t *max_depth, uint32_t *dropped);
+
+/**
+ * @brief   Get glyph cache statistics.
+ *
+ * @param   handle Handle structure.
+ * @param   hit Pointer references to the number of glyphs drawn from cache.
+ * @param   miss Pointer references to the number of glyphs rasterized from font.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_get_glyph_cache_stats(tft_driver_handle_t handle, uint32_t *hit, uint32_t *miss);
+
+/*
+ * @brief   Get paced refresh rate and frame counters.
+ *
+ * @param   handle Handle structure.
+ * @param   frame_rate Pointer references to the frame rate in use, 0 when not paced.
+ * @param   presented Pointer references to the number of frames sent.
+ * @param   dropped Pointer references to the number of frames merged into a later one.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_get_frame_stats(tft_driver_handle_t handle,
+                                      uint8_t *frame_rate,
+                                      uint32_t *presented,
+                                      uint32_t *dropped);
+
+/*
+ * @brief   Get counters of bands hashed on refresh.
+ *
+ * @param   handle Handle structure.
+ * @param   hashed Pointer references to the number of bands hashed.
+ * @param   skipped Pointer references to the number of bands not sent as unchanged.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_get_hash_stats(tft_driver_handle_t handle, uint32_t *hashed, uint32_t *skipped);
+
+/**
+ * @brief   Get driver statistics.
+ *
+ * @note    Statistics are collected only when the component is built with
+ *          TFT_DRIVER_ENABLE_STATS defined, otherwise this fails.
+ *
+ * @param   handle Handle structure.
+ * @param   stats Pointer references to the statistics.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_get_stats(tft_driver_handle_t handle, tft_driver_stats_t *stats);
+
+/**
+ * @brief   Clear driver statistics.
+ *
+ * @param   handle Handle structure.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_reset_stats(tft_driver_handle_t handle);
+
+/*
+ * @brief   Set palette of indexed pixel formats.
+ *
+ * @note    Whole screen is sent with the next refresh.
+ *
+ * @param   handle Handle structure.
+ * @param   palette RGB888 color of every index, NULL for gray levels.
+ *
+ * @return
+ *      - ERR_CODE_SUCCESS: Success.
+ *      - Others:           Fail.
+ */
+err_code_t tft_driver_set_palette(tft_driver_handle_t handle, const uint32_t *palette);
+
 /*
  * @brief   Get screen buffer.
  *
+ * @note    Buffer layout follows pixel_format of the configuration. There
+ *          is no buffer in immediate and display list render mode.
+ *
  * @param   handle Handle structure.
  *
  * @return